@@ -104,6 +104,9 @@ void updateSpitball(WO* wo) {
 
 void GLViewNewModule::updateWorld()
 {
+   //everything traced since the last call is the previous frame in the Vtk View's trace summary
+   VTK_TRACE_FRAME();
+   VTK_TRACE_ZONE( "GLViewNewModule::updateWorld" );
    GLView::updateWorld(); //Just call the parent's update world first.
                           //If you want to add additional functionality, do it after
                           //this call.
@@ -137,6 +140,14 @@ void GLViewNewModule::onMouseUp( const SDL_MouseButtonEvent& e )
 void GLViewNewModule::onMouseMove( const SDL_MouseMotionEvent& e )
 {
    GLView::onMouseMove( e );
+
+   //probe the streamline under the mouse unless it is over an ImGui window
+   if( !ImGui::GetIO().WantCaptureMouse )
+   {
+      int width = 0, height = 0;
+      SDL_GetWindowSize( SDL_GetWindowFromID( e.windowID ), &width, &height );
+      openFoamRenderer.probeTracks( *this->cam, e.x, e.y, width, height );
+   }
 }
 
 
@@ -185,11 +196,14 @@ void GLViewNewModule::onKeyUp( const SDL_KeyboardEvent& key )
 
 
 void initVtkRenderer(vtkOFRenderer* renderer) {
-    renderer->parseTracksFiles();
+    // returns once the first timestamp is parsed, the rest load in the background
+    renderer->parseTracksFiles(true);
 }
 
 void Aftr::GLViewNewModule::loadMap()
 {
+   VTK_TRACE_THREAD( "render" );
+   VTK_TRACE_ZONE( "GLViewNewModule::loadMap" );
    
    // open foam case directory (obviously this is different between computers)
    /*OpenFOAM parser/renderer initialization!*/
@@ -0,0 +1,414 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+/* vtkBench: throughput of the engine free half of the module, the tracks
+ * parser, the streamline mesh builder / spatial index and the parse pipeline
+ * the renderer runs on its thread pool. Results are written as JSON so two
+ * runs (I.E. two releases) can be compared by a script.
+ *
+ *   vtkBench [--case DIR] [--scale N] [--points N] [--threads N] [--repeat N] [--out FILE] [--trace FILE]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "vtkParser.hpp"
+#include "vtkThreadPool.hpp"
+#include "vtkStreamlineMesh.hpp"
+#include "vtkBVH.hpp"
+#include "vtkCaseGen.hpp"
+
+#ifndef VTK_BENCH_CASE_DIR
+#define VTK_BENCH_CASE_DIR "../pitzDailySteady"
+#endif
+
+/* Every allocation of the process goes through these, counted so a stage
+ * can report how many it made. Relaxed atomics, only totals are read.
+ */
+namespace {
+	std::atomic<size_t> allocCount{ 0 };
+	std::atomic<size_t> allocBytes{ 0 };
+
+	void* countedAlloc(size_t size) {
+		allocCount.fetch_add(1, std::memory_order_relaxed);
+		allocBytes.fetch_add(size, std::memory_order_relaxed);
+		void* p = std::malloc(size != 0 ? size : 1);
+		if (p == nullptr) throw std::bad_alloc();
+		return p;
+	}
+}
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+	struct options {
+		std::string caseDir = VTK_BENCH_CASE_DIR;
+		int scale = 20; // the synthetic input is the last timestamp's tracks repeated this many times
+		size_t points = 0; // points of a vtkCaseGenerator tracks file added to the inputs, 0 = none
+		unsigned threads = 0; // pipeline runs on 1, 2, 4 ... up to this, 0 = hardware_concurrency
+		int repeat = 5;
+		std::string out; // empty = stdout
+		std::string trace; // Chrome trace of the whole run, needs a VTK_TRACE build
+	};
+
+	struct input {
+		std::string name;
+		std::string path;
+		size_t bytes = 0;
+		int points = 0;
+		size_t lines = 0;
+	};
+
+	struct result {
+		std::string stage;
+		std::string input;
+		unsigned threads = 1;
+		double bestMs = 0.0, medianMs = 0.0;
+		size_t bytes = 0; // input bytes one run reads
+		size_t points = 0; // points one run produces
+		size_t allocs = 0, allocBytes = 0; // per run
+		size_t peakRssKB = 0; // of the process, after the stage
+	};
+
+	size_t peakRssKB() {
+#if defined _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+		return counters.PeakWorkingSetSize / 1024;
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined __APPLE__
+		return (size_t)usage.ru_maxrss / 1024; // bytes on macOS
+#else
+		return (size_t)usage.ru_maxrss;
+#endif
+#endif
+	}
+
+	double nowMs() {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/* Runs setup + fn repeat times, only fn is timed. Allocations are counted
+	 * over the last run, setup's excluded.
+	 */
+	result measure(const std::string& stage, const std::string& inputName, int repeat,
+		const std::function<void()>& setup, const std::function<void()>& fn) {
+		std::vector<double> times;
+		result r;
+		for (int i = 0; i < repeat; i++) {
+			if (setup) setup();
+			size_t count = allocCount.load(), bytes = allocBytes.load();
+			double start = nowMs();
+			fn();
+			times.push_back(nowMs() - start);
+			r.allocs = allocCount.load() - count;
+			r.allocBytes = allocBytes.load() - bytes;
+		}
+		std::sort(times.begin(), times.end());
+		r.stage = stage;
+		r.input = inputName;
+		r.bestMs = times.front();
+		r.medianMs = times[times.size() / 2];
+		r.peakRssKB = peakRssKB();
+		return r;
+	}
+
+	// init + parseOpenFoam with the cache off, what the renderer's parse tasks do on a first load
+	vtkParser::openFoamVtkFileData parseTracks(const std::string& path, bool decodeArrays) {
+		vtkParser parser;
+		parser.setVtkFile(path);
+		parser.setCache(false);
+		if (!parser.init() || !parser.parseOpenFoam()) {
+			fmt::print(stderr, "vtkBench: failed to parse {}\n", path);
+			std::exit(1);
+		}
+		vtkParser::openFoamVtkFileData data = parser.releaseOpenFoamData();
+		parser.freeVtkData();
+		if (decodeArrays) {
+			for (const vtkParser::vtkSection& sec : data.index->sections)
+				if (sec.scope == vtkParser::POINT_DATA) vtkParser::getVtkData(data, vtkParser::POINT_DATA, sec.name);
+		}
+		return data;
+	}
+
+	/* Legacy ascii tracks made of source's lines copies times over, each copy
+	 * shifted so they don't land on top of each other, with every point array.
+	 */
+	bool writeScaledTracks(const std::string& source, const std::string& path, int copies) {
+		vtkParser::openFoamVtkFileData data = parseTracks(source, true);
+		std::vector<const vtkParser::vtkSection*> arrays;
+		for (const vtkParser::vtkSection& sec : data.index->sections)
+			if (sec.scope == vtkParser::POINT_DATA) arrays.push_back(&sec);
+
+		FILE* out = std::fopen(path.c_str(), "wb");
+		if (out == nullptr) return false;
+		int points = data.points.size;
+		size_t lines = data.lines.size();
+		fmt::print(out, "# vtk DataFile Version 2.0\nvtkBench x{}\nASCII\nDATASET POLYDATA\nPOINTS {} float\n",
+			copies, (size_t)points * copies);
+		for (int c = 0; c < copies; c++) {
+			float shift = 0.01f * c;
+			for (int i = 0; i < points; i++) {
+				vtkParser::vtkPoint p = data.points.point(i);
+				fmt::print(out, "{} {} {}\n", (float)p.x, (float)p.y, (float)p.z + shift);
+			}
+		}
+		fmt::print(out, "LINES {} {}\n", lines * copies, (lines + data.lines.totalPoints()) * copies);
+		for (int c = 0; c < copies; c++) {
+			for (vtkParser::vtkLine line : data.lines) {
+				fmt::print(out, "{}", line.size());
+				for (int idx : line) fmt::print(out, " {}", idx + c * points);
+				fmt::print(out, "\n");
+			}
+		}
+		fmt::print(out, "POINT_DATA {}\nFIELD attributes {}\n", (size_t)points * copies, arrays.size());
+		for (const vtkParser::vtkSection* sec : arrays) {
+			const vtkParser::vtkDataArray* array = vtkParser::getVtkData(data, vtkParser::POINT_DATA, sec->name);
+			fmt::print(out, "{} {} {} float\n", sec->name, array->numComponents, (size_t)array->numTuples * copies);
+			for (int c = 0; c < copies; c++) {
+				for (int t = 0; t < array->numTuples; t++) {
+					fmt::print(out, "{}", (float)array->value(t, 0));
+					for (int k = 1; k < array->numComponents; k++) fmt::print(out, " {}", (float)array->value(t, k));
+					fmt::print(out, "\n");
+				}
+			}
+		}
+		return std::fclose(out) == 0;
+	}
+
+	std::vector<input> findInputs(const options& opts, const std::string& scratchDir) {
+		std::vector<input> inputs;
+		std::error_code err;
+		std::string streamlines = opts.caseDir + "/postProcessing/streamlines";
+		std::vector<std::string> times;
+		for (const auto& entry : std::filesystem::directory_iterator(streamlines, err))
+			if (entry.is_directory()) times.push_back(entry.path().filename().string());
+		std::sort(times.begin(), times.end(), [](const std::string& a, const std::string& b) {
+			return std::stod(a) < std::stod(b);
+		});
+		for (const std::string& time : times) {
+			for (const char* name : { "tracks.vtk", "tracks.vtp", "tracks.vtk.gz", "tracks.vtp.gz" }) {
+				std::string path = streamlines + "/" + time + "/" + name;
+				if (std::filesystem::exists(path, err)) {
+					inputs.push_back({ "case/" + time, path });
+					break;
+				}
+			}
+		}
+		if (inputs.empty()) return inputs;
+
+		if (opts.scale > 1) {
+			std::string path = scratchDir + "/tracks_x" + std::to_string(opts.scale) + ".vtk";
+			if (writeScaledTracks(inputs.back().path, path, opts.scale))
+				inputs.push_back({ "synthetic/x" + std::to_string(opts.scale), path });
+			else fmt::print(stderr, "vtkBench: could not write {}, skipping the synthetic input\n", path);
+		}
+		if (opts.points > 0) {
+			vtkCaseGenerator::options gen;
+			gen.trackPoints = opts.points;
+			gen.streamlines = (int)std::max<size_t>(1, opts.points / 10000);
+			std::string path = scratchDir + "/tracks_generated.vtk";
+			if (vtkCaseGenerator::writeTracks(gen, path, 1))
+				inputs.push_back({ "generated/" + std::to_string(opts.points), path });
+			else fmt::print(stderr, "vtkBench: could not write {}, skipping the generated input\n", path);
+		}
+		for (input& in : inputs) {
+			in.bytes = (size_t)std::filesystem::file_size(in.path, err);
+			vtkParser::openFoamVtkFileData data = parseTracks(in.path, false);
+			in.points = data.points.size;
+			in.lines = data.lines.size();
+		}
+		return inputs;
+	}
+
+	// JSON string escaping for names and paths
+	std::string quoted(const std::string& text) {
+		std::string out = "\"";
+		for (char c : text) {
+			if (c == '"' || c == '\\') out += '\\';
+			if ((unsigned char)c < ' ') out += fmt::format("\\u{:04x}", (int)c);
+			else out += c;
+		}
+		return out + "\"";
+	}
+
+	void writeJson(FILE* out, const options& opts, const std::vector<input>& inputs, const std::vector<result>& results) {
+		fmt::print(out, "{{\n  \"benchmark\": \"vtkBench\",\n  \"version\": 1,\n");
+		fmt::print(out, "  \"hardwareThreads\": {},\n  \"repeat\": {},\n  \"scale\": {},\n",
+			std::thread::hardware_concurrency(), opts.repeat, opts.scale);
+		fmt::print(out, "  \"inputs\": [\n");
+		for (size_t i = 0; i < inputs.size(); i++) {
+			const input& in = inputs[i];
+			fmt::print(out, "    {{ \"name\": {}, \"path\": {}, \"bytes\": {}, \"points\": {}, \"lines\": {} }}{}\n",
+				quoted(in.name), quoted(in.path), in.bytes, in.points, in.lines, i + 1 < inputs.size() ? "," : "");
+		}
+		fmt::print(out, "  ],\n  \"results\": [\n");
+		for (size_t i = 0; i < results.size(); i++) {
+			const result& r = results[i];
+			double seconds = r.bestMs / 1000.0;
+			double mbPerSec = (seconds > 0.0) ? r.bytes / 1e6 / seconds : 0.0;
+			double pointsPerSec = (seconds > 0.0) ? r.points / seconds : 0.0;
+			fmt::print(out, "    {{ \"stage\": {}, \"input\": {}, \"threads\": {}, \"bestMs\": {:.3f}, \"medianMs\": {:.3f}, "
+				"\"MBps\": {:.1f}, \"pointsPerSec\": {:.0f}, \"allocs\": {}, \"allocBytes\": {}, \"peakRssKB\": {} }}{}\n",
+				quoted(r.stage), quoted(r.input), r.threads, r.bestMs, r.medianMs, mbPerSec, pointsPerSec,
+				r.allocs, r.allocBytes, r.peakRssKB, i + 1 < results.size() ? "," : "");
+		}
+		fmt::print(out, "  ]\n}}\n");
+	}
+
+	int usage() {
+		fmt::print(stderr,
+			"usage: vtkBench [--case DIR] [--scale N] [--points N] [--threads N] [--repeat N] [--out FILE] [--trace FILE]\n"
+			"  --case     OpenFOAM case with postProcessing/streamlines (default {})\n"
+			"  --scale    copies of the last tracks file in the synthetic input, 1 = none (default 20)\n"
+			"  --points   also bench a generated tracks file of N points, 10000 per line (default none)\n"
+			"  --threads  most pipeline threads, scaling runs 1, 2, 4 ... up to it (default all)\n"
+			"  --repeat   runs per measurement, best and median are reported (default 5)\n"
+			"  --out      JSON results file (default stdout)\n"
+			"  --trace    also write the run's VTK_TRACE_ZONEs as a Chrome trace (VTK_ENABLE_TRACE builds)\n", VTK_BENCH_CASE_DIR);
+		return 2;
+	}
+}
+
+int main(int argc, char** argv) {
+	options opts;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h" || i + 1 >= argc) return usage();
+		std::string value = argv[++i];
+		if (arg == "--case") opts.caseDir = value;
+		else if (arg == "--scale") opts.scale = std::max(1, std::atoi(value.c_str()));
+		else if (arg == "--points") opts.points = std::strtoull(value.c_str(), nullptr, 10);
+		else if (arg == "--threads") opts.threads = (unsigned)std::max(0, std::atoi(value.c_str()));
+		else if (arg == "--repeat") opts.repeat = std::max(1, std::atoi(value.c_str()));
+		else if (arg == "--out") opts.out = value;
+		else if (arg == "--trace") opts.trace = value;
+		else return usage();
+	}
+	if (opts.threads == 0) opts.threads = vtkThreadPool::defaultThreadCount();
+	if (!opts.trace.empty() && !vtkTrace::compiledIn)
+		fmt::print(stderr, "vtkBench: built without VTK_TRACE, {} will hold no zones\n", opts.trace);
+	VTK_TRACE_THREAD("vtkBench");
+
+	std::error_code err;
+	std::string scratchDir = (std::filesystem::temp_directory_path(err) / "vtkBench").string();
+	std::filesystem::create_directories(scratchDir, err);
+	std::vector<input> inputs = findInputs(opts, scratchDir);
+	if (inputs.empty()) {
+		fmt::print(stderr, "vtkBench: no tracks files under {}/postProcessing/streamlines\n", opts.caseDir);
+		return 1;
+	}
+
+	std::vector<result> results;
+	auto add = [&results](result r, const input& in, size_t points) {
+		r.bytes = in.bytes;
+		r.points = points;
+		fmt::print(stderr, "{:<14} {:<16} {:>2} threads {:>9.2f} ms best {:>9.2f} median {:>8} allocs\n",
+			r.stage, r.input, r.threads, r.bestMs, r.medianMs, r.allocs);
+		results.push_back(r);
+	};
+
+	for (const input& in : inputs) {
+		/* init alone maps the file (a .gz is inflated into its temporary file),
+		 * nothing is scanned yet, the section scan is timed as part of parse
+		 */
+		add(measure("open", in.name, opts.repeat, nullptr, [&in]() {
+			vtkParser parser;
+			parser.setVtkFile(in.path);
+			parser.setCache(false);
+			parser.init();
+			parser.freeVtkData();
+		}), in, 0);
+		add(measure("parse", in.name, opts.repeat, nullptr, [&in]() { parseTracks(in.path, false); }), in, in.points);
+		add(measure("parse+arrays", in.name, opts.repeat, nullptr, [&in]() { parseTracks(in.path, true); }), in, in.points);
+
+		// a warm load maps the sidecar cache instead of parsing
+		std::string cacheDir = scratchDir + "/cache";
+		std::filesystem::create_directories(cacheDir, err);
+		auto cachedLoad = [&in, &cacheDir]() {
+			vtkParser parser;
+			parser.setVtkFile(in.path);
+			parser.setCache(true, cacheDir);
+			parser.init();
+			parser.parseOpenFoam();
+			vtkParser::openFoamVtkFileData data = parser.releaseOpenFoamData();
+			parser.freeVtkData();
+		};
+		cachedLoad();
+		add(measure("cache_load", in.name, opts.repeat, nullptr, cachedLoad), in, in.points);
+
+		vtkParser::openFoamVtkFileData data = parseTracks(in.path, true);
+		vtkStreamlineMeshBuilder::options meshOpts;
+		add(measure("mesh_tube", in.name, opts.repeat, nullptr, [&data, &meshOpts]() {
+			vtkStreamlineMesh mesh = vtkStreamlineMeshBuilder::build(data, meshOpts);
+		}), in, in.points);
+		add(measure("spatial_index", in.name, opts.repeat, nullptr, [&data]() {
+			vtkStreamlineSpatialIndex::build(data, data.lines, 1.0f);
+		}), in, in.points);
+	}
+
+	/* The renderer's parseTracksFiles: one task per timestamp on the pool, every
+	 * bundled timestamp plus the synthetic input, at 1, 2, 4 ... threads.
+	 */
+	input all{ "pipeline", "", 0, 0, 0 };
+	for (const input& in : inputs) {
+		all.bytes += in.bytes;
+		all.points += in.points;
+	}
+	std::vector<unsigned> threadCounts;
+	for (unsigned t = 1; t < opts.threads; t *= 2) threadCounts.push_back(t);
+	threadCounts.push_back(opts.threads);
+	for (unsigned threads : threadCounts) {
+		std::unique_ptr<vtkThreadPool> pool;
+		result r = measure("pipeline", all.name, opts.repeat,
+			[&pool, threads]() { pool = std::make_unique<vtkThreadPool>(threads); },
+			[&pool, &inputs]() {
+				std::vector<vtkParser::openFoamVtkFileData> slots(inputs.size());
+				std::vector<std::future<void> > tasks;
+				for (size_t i = 0; i < inputs.size(); i++) {
+					tasks.push_back(pool->enqueue([&slots, &inputs, i]() {
+						slots[i] = parseTracks(inputs[i].path, false);
+					}, inputs[i].bytes * 2));
+				}
+				for (std::future<void>& task : tasks) task.wait();
+			});
+		r.threads = threads;
+		add(r, all, all.points);
+	}
+
+	FILE* out = opts.out.empty() ? stdout : std::fopen(opts.out.c_str(), "w");
+	if (out == nullptr) {
+		fmt::print(stderr, "vtkBench: could not open {}\n", opts.out);
+		return 1;
+	}
+	writeJson(out, opts, inputs, results);
+	if (out != stdout) std::fclose(out);
+	if (!opts.trace.empty()) vtkTrace::writeChromeTrace(opts.trace);
+	std::filesystem::remove_all(scratchDir, err);
+	return 0;
+}
@@ -0,0 +1,66 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+/* vtkGenerateCase: writes a synthetic OpenFOAM case (vtkCaseGenerator) for
+ * scale testing, I.E. 20 million track points over 200 time steps:
+ *
+ *   vtkGenerateCase --out /tmp/big --points 20000000 --lines 2000 --times 200 --cells 1000000
+ *   vtkBench --case /tmp/big
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <chrono>
+
+#include "vtkCaseGen.hpp"
+#include "vtkParser.hpp"
+
+namespace {
+	int usage() {
+		fmt::print(stderr,
+			"usage: vtkGenerateCase --out DIR [--points N] [--lines N] [--times N] [--cells N]\n"
+			"                       [--fields p,U:3,k] [--binary]\n"
+			"  --points  track points per time step, 0 = no tracks (default 100000)\n"
+			"  --lines   streamlines the points are split between (default 100)\n"
+			"  --times   time directories 1 .. N (default 3)\n"
+			"  --cells   hex cells of the polyMesh, rounded to a cube, 0 = no mesh or fields (default 27000)\n"
+			"  --fields  fields written per time step and per track point, name[:components] (default p,U:3,k)\n"
+			"  --binary  BINARY tracks.vtk and binary FoamFiles instead of ascii\n");
+		return 2;
+	}
+}
+
+int main(int argc, char** argv) {
+	vtkCaseGenerator::options opts;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--binary") {
+			opts.binary = true;
+			continue;
+		}
+		if (arg == "--help" || arg == "-h" || i + 1 >= argc) return usage();
+		std::string value = argv[++i];
+		if (arg == "--out") opts.caseDir = value;
+		else if (arg == "--points") opts.trackPoints = std::strtoull(value.c_str(), nullptr, 10);
+		else if (arg == "--lines") opts.streamlines = std::atoi(value.c_str());
+		else if (arg == "--times") opts.timeSteps = std::atoi(value.c_str());
+		else if (arg == "--cells") opts.cells = std::strtoull(value.c_str(), nullptr, 10);
+		else if (arg == "--fields") opts.fields = vtkCaseGenerator::parseFields(value);
+		else return usage();
+	}
+	if (opts.caseDir.empty() || opts.fields.empty() || opts.streamlines < 1 || opts.timeSteps < 1) return usage();
+	// the readers index points and cells with int
+	if (opts.trackPoints > 2000000000u || opts.cells > 500000000u) {
+		fmt::print(stderr, "vtkGenerateCase: --points / --cells is past what the readers can index\n");
+		return 2;
+	}
+
+	int side = vtkCaseGenerator::blockSide(opts.cells);
+	fmt::print(stderr, "writing {}: {} time steps, {} track points on {} lines, {} cells ({}^3), {}\n",
+		opts.caseDir, opts.timeSteps, opts.trackPoints, opts.streamlines,
+		opts.cells > 0 ? (size_t)side * side * side : 0, opts.cells > 0 ? side : 0, opts.binary ? "binary" : "ascii");
+	auto start = std::chrono::steady_clock::now();
+	if (!vtkCaseGenerator::write(opts)) return 1;
+	fmt::print(stderr, "done in {:.1f} s\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	return 0;
+}
@@ -8,6 +8,27 @@
 #include <algorithm>
 #include "AftrUtilities.h"
 #include <string>
+#include "vtkParser.hpp"
+#include "vtkThreadPool.hpp"
+#include "vtkStreamlineMesh.hpp"
+#include "vtkDecimate.hpp"
+#include "vtkTimeStampCache.hpp"
+#include "vtkPlayback.hpp"
+#include "vtkBVH.hpp"
+#include "vtkFoamMesh.hpp"
+#include "vtkFoamField.hpp"
+#include "vtkCaseGen.hpp"
+#include "vtkTrace.hpp"
+#include <filesystem>
+#include <bit>
+#include <random>
+#include <atomic>
+#include <thread>
+#include <cstdio>
+#include <cmath>
+#ifdef VTK_HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 using namespace Aftr;
 namespace
@@ -69,4 +90,936 @@ namespace
          EXPECT_TRUE( *maxElem == *v.begin() );
       }
    }
-}
\ No newline at end of file
+
+   //small legacy vtk file shaped like the streamline writer's tracks.vtk
+   const char* smallTracksVtk =
+      "# vtk DataFile Version 2.0\n"
+      "tracks\n"
+      "ASCII\n"
+      "DATASET POLYDATA\n"
+      "POINTS 5 float\n"
+      "0 0 0 1 0 0 2 0\n"
+      "0 0 1 0 0 2 1e-05\n"
+      "LINES 2 7\n"
+      "3 0 1 2\n"
+      "2 3 4\n";
+
+   void writeTestFile( const std::string& path, const std::string& body )
+   {
+      std::ofstream fout( path, std::ios::binary );
+      fout << body;
+   }
+
+   TEST( vtkParser, points_and_lines_csr )
+   {
+      writeTestFile( "./vtkParser_points_and_lines.vtk", smallTracksVtk );
+      vtkParser parser;
+      parser.setVtkFile( "./vtkParser_points_and_lines.vtk" );
+      ASSERT_TRUE( parser.init() );
+      ASSERT_TRUE( parser.parseOpenFoam() );
+      vtkParser::openFoamVtkFileData data = parser.getOpenFoamData();
+      parser.freeVtkData();
+
+      EXPECT_EQ( data.points.size, 5 );
+      EXPECT_EQ( data.points.type, vtkParser::TYPE_FLOAT );
+      EXPECT_EQ( data.points.packed<float>().size(), 15u );
+      EXPECT_FLOAT_EQ( data.points.x<float>()[2], 2.0f );
+      EXPECT_FLOAT_EQ( data.points.y<float>()[3], 1.0f );
+      EXPECT_FLOAT_EQ( data.points.z<float>()[4], 1e-05f );
+
+      ASSERT_EQ( data.lines.size(), 2u );
+      EXPECT_EQ( data.lines.offsets, ( std::vector<int>{ 0, 3, 5 } ) );
+      EXPECT_EQ( data.lines.indices, ( std::vector<int>{ 0, 1, 2, 3, 4 } ) );
+      size_t total = 0;
+      for( vtkParser::vtkLine line : data.lines )
+         total += line.size();
+      EXPECT_EQ( total, data.lines.totalPoints() );
+   }
+
+   TEST( vtkParser, point_count_mismatch_is_rejected )
+   {
+      std::string body( smallTracksVtk );
+      body.replace( body.find( "POINTS 5" ), 8, "POINTS 6" );
+      writeTestFile( "./vtkParser_point_count_mismatch.vtk", body );
+      vtkParser parser;
+      parser.setVtkFile( "./vtkParser_point_count_mismatch.vtk" );
+      ASSERT_TRUE( parser.init() );
+      parser.parseOpenFoam();
+      EXPECT_TRUE( parser.getOpenFoamData().points.empty() );
+      parser.freeVtkData();
+   }
+
+   TEST( vtkParser, point_data_fields )
+   {
+      std::string body( smallTracksVtk );
+      body += "POINT_DATA 5\n"
+              "FIELD attributes 2\n"
+              "p 1 5 float\n"
+              "1 2 3 4 5\n"
+              "U 3 5 float\n"
+              "3 4 0 0 0 0 1 1 1\n"
+              "0 0 2 6 8 0\n"
+              "SCALARS id int 1\n"
+              "LOOKUP_TABLE default\n"
+              "10 11 12 13 14\n";
+      writeTestFile( "./vtkParser_point_data_fields.vtk", body );
+      vtkParser parser;
+      parser.setVtkFile( "./vtkParser_point_data_fields.vtk" );
+      ASSERT_TRUE( parser.init() );
+      ASSERT_TRUE( parser.parseOpenFoam() );
+
+      const vtkParser::vtkDataArray* p = parser.getVtkData( vtkParser::POINT_DATA, "p" );
+      ASSERT_NE( p, nullptr );
+      EXPECT_EQ( p->values<float>().size(), 5u );
+      EXPECT_FLOAT_EQ( p->values<float>()[4], 5.0f );
+
+      const vtkParser::vtkDataArray* U = parser.getVtkData( vtkParser::FIELD, "U" );
+      ASSERT_NE( U, nullptr );
+      EXPECT_EQ( U->numComponents, 3 );
+      EXPECT_DOUBLE_EQ( U->magnitude( 0 ), 5.0 );
+      EXPECT_DOUBLE_EQ( U->magnitude( 4 ), 10.0 );
+
+      const vtkParser::vtkDataArray* id = parser.getVtkData( vtkParser::POINT_DATA, "id" );
+      ASSERT_NE( id, nullptr );
+      EXPECT_EQ( id->type, vtkParser::TYPE_INT );
+      EXPECT_EQ( id->values<int>()[2], 12 );
+
+      EXPECT_EQ( parser.getVtkData( vtkParser::POINT_DATA, "k" ), nullptr );
+      EXPECT_EQ( parser.getOpenFoamData().lines.size(), 2u );
+      parser.freeVtkData();
+   }
+
+   TEST( vtkParser, binary_cache_round_trip )
+   {
+      std::string body( smallTracksVtk );
+      body += "POINT_DATA 5\n"
+              "FIELD attributes 1\n"
+              "p 1 5 double\n"
+              "1 2 3 4 5\n";
+      const std::string path = "./vtkParser_binary_cache.vtk";
+      const std::string cachePath = vtkParser::cachePathFor( path );
+      writeTestFile( path, body );
+      std::remove( cachePath.c_str() );
+
+      {
+         vtkParser parser;
+         parser.setVtkFile( path );
+         parser.setCache( true );
+         ASSERT_TRUE( parser.init() );
+         ASSERT_TRUE( parser.parseOpenFoam() );
+         parser.freeVtkData();
+      }
+      ASSERT_TRUE( std::ifstream( cachePath ).good() );
+
+      vtkParser parser;
+      parser.setVtkFile( path );
+      parser.setCache( true );
+      ASSERT_TRUE( parser.init() );
+      ASSERT_TRUE( parser.parseOpenFoam() );
+      vtkParser::openFoamVtkFileData data = parser.releaseOpenFoamData();
+      parser.freeVtkData();
+
+      //loaded from the cache, not the text
+      ASSERT_FALSE( data.index->sections.empty() );
+      EXPECT_EQ( data.index->sections[0].encoding, vtkParser::ENCODING_RAW );
+      EXPECT_EQ( data.points.type, vtkParser::TYPE_FLOAT );
+      EXPECT_FLOAT_EQ( data.points.z<float>()[4], 1e-05f );
+      EXPECT_EQ( data.lines.offsets, ( std::vector<int>{ 0, 3, 5 } ) );
+      EXPECT_EQ( data.lines.indices, ( std::vector<int>{ 0, 1, 2, 3, 4 } ) );
+      const vtkParser::vtkDataArray* p = vtkParser::getVtkData( data, vtkParser::POINT_DATA, "p" );
+      ASSERT_NE( p, nullptr );
+      EXPECT_DOUBLE_EQ( p->values<double>()[3], 4.0 );
+
+      //a rewritten source makes the cache stale
+      body.replace( body.find( "2 1e-05" ), 7, "2 3e-05" );
+      body += "\n";
+      writeTestFile( path, body );
+      vtkParser reparsed;
+      reparsed.setVtkFile( path );
+      reparsed.setCache( true );
+      ASSERT_TRUE( reparsed.init() );
+      ASSERT_TRUE( reparsed.parseOpenFoam() );
+      EXPECT_FLOAT_EQ( reparsed.getOpenFoamData().points.z<float>()[4], 3e-05f );
+      reparsed.freeVtkData();
+
+      //writers caching the same source at once each use their own temp file
+      std::remove( cachePath.c_str() );
+      std::vector<std::thread> writers;
+      std::atomic<int> parsed{ 0 };
+      for( int i = 0; i < 4; i++ )
+         writers.emplace_back( [&]() {
+            vtkParser writer;
+            writer.setVtkFile( path );
+            writer.setCache( true );
+            if( writer.init() && writer.parseOpenFoam() ) parsed++;
+            writer.freeVtkData();
+         } );
+      for( std::thread& writer : writers ) writer.join();
+      EXPECT_EQ( parsed, 4 );
+      for( const auto& entry : std::filesystem::directory_iterator( "." ) )
+         EXPECT_NE( entry.path().extension(), ".tmp" ) << entry.path();
+      vtkParser cached;
+      cached.setVtkFile( path );
+      cached.setCache( true );
+      ASSERT_TRUE( cached.init() );
+      ASSERT_TRUE( cached.parseOpenFoam() );
+      EXPECT_EQ( cached.getOpenFoamData().index->sections[0].encoding, vtkParser::ENCODING_RAW );
+      EXPECT_FLOAT_EQ( cached.getOpenFoamData().points.z<float>()[4], 3e-05f );
+      cached.freeVtkData();
+   }
+
+   TEST( vtkStreamlineMesh, tube_and_line_geometry )
+   {
+      writeTestFile( "./vtkStreamlineMesh_geometry.vtk", smallTracksVtk );
+      vtkParser parser;
+      parser.setVtkFile( "./vtkStreamlineMesh_geometry.vtk" );
+      ASSERT_TRUE( parser.init() );
+      ASSERT_TRUE( parser.parseOpenFoam() );
+      vtkParser::openFoamVtkFileData data = parser.releaseOpenFoamData();
+      parser.freeVtkData();
+
+      vtkStreamlineMeshBuilder::options opts;
+      opts.style = vtkStreamlineMeshBuilder::STYLE_TUBE;
+      opts.sides = 4;
+      opts.radius = 0.5f;
+      opts.colourField = nullptr;
+      vtkStreamlineMesh tube = vtkStreamlineMeshBuilder::build( data, opts );
+
+      //lines of 3 and 2 points: 4 vertices per point, 2 triangles per facet per segment
+      EXPECT_EQ( tube.primitive, vtkStreamlineMesh::MESH_TRIANGLES );
+      ASSERT_EQ( tube.vertexCount(), 20u );
+      EXPECT_EQ( tube.indices.size(), 3u * 2 * 4 * 3 );
+      EXPECT_EQ( tube.normals.size(), tube.positions.size() );
+      EXPECT_EQ( tube.colours.size(), tube.vertexCount() * 4 );
+      for( unsigned int idx : tube.indices )
+         EXPECT_LT( idx, tube.vertexCount() );
+
+      //first line runs along x, its rings sit radius away from the axis with unit outward normals
+      for( size_t v = 0; v < 12; v++ )
+      {
+         float y = tube.positions[v * 3 + 1], z = tube.positions[v * 3 + 2];
+         EXPECT_NEAR( std::sqrt( y * y + z * z ), 0.5f, 1e-5f );
+         float nx = tube.normals[v * 3 + 0], ny = tube.normals[v * 3 + 1], nz = tube.normals[v * 3 + 2];
+         EXPECT_NEAR( nx * nx + ny * ny + nz * nz, 1.0f, 1e-5f );
+         EXPECT_NEAR( ny * 0.5f, y, 1e-5f );
+      }
+
+      opts.style = vtkStreamlineMeshBuilder::STYLE_LINES;
+      vtkStreamlineMesh lines = vtkStreamlineMeshBuilder::build( data, opts );
+      EXPECT_EQ( lines.primitive, vtkStreamlineMesh::MESH_LINES );
+      EXPECT_EQ( lines.vertexCount(), 5u );
+      EXPECT_EQ( lines.indices, ( std::vector<unsigned int>{ 0, 1, 1, 2, 3, 4 } ) );
+   }
+
+   TEST( vtkPolylineDecimator, keeps_bends_and_field_detail )
+   {
+      //line 0 is straight along x, line 1 turns a right angle at point 7
+      writeTestFile( "./vtkPolylineDecimator.vtk",
+         "# vtk DataFile Version 2.0\n"
+         "tracks\n"
+         "ASCII\n"
+         "DATASET POLYDATA\n"
+         "POINTS 10 float\n"
+         "0 0 0 1 0 0 2 0 0 3 0 0 4 0 0\n"
+         "0 1 0 1 1 0 2 1 0 2 2 0 2 3 0\n"
+         "LINES 2 12\n"
+         "5 0 1 2 3 4\n"
+         "5 5 6 7 8 9\n"
+         "POINT_DATA 10\n"
+         "FIELD attributes 1\n"
+         "U 1 10 float\n"
+         "0 0 5 0 0 0 0 0 0 0\n" );
+      vtkParser parser;
+      parser.setVtkFile( "./vtkPolylineDecimator.vtk" );
+      ASSERT_TRUE( parser.init() );
+      ASSERT_TRUE( parser.parseOpenFoam() );
+      vtkParser::openFoamVtkFileData data = parser.releaseOpenFoamData();
+      parser.freeVtkData();
+
+      vtkPolylineDecimator::options opts;
+      opts.tolerance = 0.1;
+      vtkParser::vtkPolylineIndex lines = vtkPolylineDecimator::decimate( data, opts );
+      EXPECT_EQ( lines.offsets, ( std::vector<int>{ 0, 2, 5 } ) );
+      EXPECT_EQ( lines.indices, ( std::vector<int>{ 0, 4, 5, 7, 9 } ) );
+
+      //once |U| is checked the spike at point 2 and its flanks survive on the straight line
+      opts.field = "U";
+      opts.fieldTolerance = 0.1;
+      lines = vtkPolylineDecimator::decimate( data, opts );
+      EXPECT_EQ( lines.indices, ( std::vector<int>{ 0, 1, 2, 3, 4, 5, 7, 9 } ) );
+
+      vtkThreadPool pool( 4 );
+      vtkParser::vtkPolylineIndex parallel = vtkPolylineDecimator::decimate( data, opts, &pool );
+      EXPECT_EQ( parallel.offsets, lines.offsets );
+      EXPECT_EQ( parallel.indices, lines.indices );
+
+      opts.tolerance = 0.0;
+      EXPECT_EQ( vtkPolylineDecimator::decimate( data, opts ).indices, data.lines.indices );
+   }
+
+   TEST( vtkThreadPool, memory_budget_limits_concurrency )
+   {
+      std::atomic<int> active{ 0 }, peak{ 0 }, done{ 0 };
+      {
+         //every task holds 40 of a 100 budget, so at most two may run together
+         vtkThreadPool pool( 8, 100 );
+         for( int i = 0; i < 32; i++ )
+            pool.submit( [&]()
+               {
+                  int now = ++active;
+                  int prev = peak.load();
+                  while( now > prev && !peak.compare_exchange_weak( prev, now ) );
+                  std::this_thread::sleep_for( std::chrono::milliseconds( 2 ) );
+                  --active;
+                  ++done;
+               }, 40 );
+         pool.wait();
+         EXPECT_EQ( done.load(), 32 );
+      }
+      EXPECT_LE( peak.load(), 2 );
+      EXPECT_GE( peak.load(), 1 );
+   }
+
+   TEST( vtkTimeStampCache, evicts_least_recently_used_unpinned )
+   {
+      vtkTimeStampCache cache( 5, 100 );
+      EXPECT_TRUE( cache.insert( 0, 40 ).empty() );
+      EXPECT_TRUE( cache.insert( 1, 40 ).empty() );
+      cache.touch( 0 );
+
+      //1 is now the oldest
+      EXPECT_EQ( cache.insert( 2, 40 ), ( std::vector<int>{ 1 } ) );
+      EXPECT_TRUE( cache.contains( 0 ) );
+      EXPECT_FALSE( cache.contains( 1 ) );
+      EXPECT_EQ( cache.getUsedBytes(), 80u );
+
+      //pinned entries stay even when that leaves the cache over budget
+      cache.pin( 0, true );
+      cache.pin( 2, true );
+      EXPECT_FALSE( cache.canFit( 40 ) );
+      EXPECT_TRUE( cache.insert( 3, 40 ).empty() );
+      EXPECT_EQ( cache.getUsedBytes(), 120u );
+      EXPECT_EQ( cache.insert( 4, 10 ), ( std::vector<int>{ 3 } ) );
+
+      cache.clearPins();
+      EXPECT_TRUE( cache.canFit( 100 ) );
+      cache.erase( 4 );
+      EXPECT_EQ( cache.getCount(), 2u );
+
+      vtkTimeStampCache unlimited( 3, 0 );
+      unlimited.insert( 0, 1000 );
+      EXPECT_TRUE( unlimited.insert( 1, 1000 ).empty() );
+   }
+
+   TEST( vtkPlaybackClock, advances_wraps_and_interpolates )
+   {
+      vtkPlaybackClock playback( 4, 2.0 );
+      playback.advance( 0.75 );
+      EXPECT_EQ( playback.getIndex(), 1 );
+      EXPECT_NEAR( playback.getFraction(), 0.5f, 1e-6f );
+      playback.advance( 1.5 ); //4.5 wraps to 0.5
+      EXPECT_EQ( playback.getIndex(), 0 );
+      playback.step( -1 );
+      EXPECT_DOUBLE_EQ( playback.getPosition(), 3.0 );
+      playback.scrub( -0.25 );
+      EXPECT_DOUBLE_EQ( playback.getPosition(), 3.75 );
+
+      //odd length so the SIMD body and the scalar tail both run
+      std::vector<float> a( 7, 1.0f ), b( 7, 3.0f ), out( 7 );
+      vtkLerp( a.data(), b.data(), 0.25f, out.data(), out.size() );
+      for( float v : out )
+         EXPECT_FLOAT_EQ( v, 1.5f );
+
+      auto makeStep = []( float x, float u )
+         {
+            vtkParser::openFoamVtkFileData data{};
+            data.points.assign( std::vector<float>{ 0, 0, 0, x, 0, 0, x * 2, 0, 0 } );
+            data.lines.offsets = { 0, 3 };
+            data.lines.indices = { 0, 1, 2 };
+            vtkParser::vtkDataArray& field = data.pointData["U"];
+            field.name = "U";
+            field.type = vtkParser::TYPE_FLOAT;
+            field.numComponents = 1;
+            field.numTuples = 3;
+            field.storage<float>() = { u, u, u };
+            return data;
+         };
+      vtkParser::openFoamVtkFileData from = makeStep( 1.0f, 0.0f ), to = makeStep( 3.0f, 4.0f ), blended{};
+      ASSERT_TRUE( vtkInterpolateTimeStamps( from, to, 0.5f, "U", blended ) );
+      EXPECT_FLOAT_EQ( blended.points.x<float>()[2], 4.0f );
+      const vtkParser::vtkDataArray* u = vtkParser::getVtkData( blended, vtkParser::POINT_DATA, "U" );
+      ASSERT_NE( u, nullptr );
+      EXPECT_DOUBLE_EQ( u->value( 1 ), 2.0 );
+
+      to.lines.indices = { 0, 2, 1 };
+      EXPECT_FALSE( vtkInterpolateTimeStamps( from, to, 0.5f, "U", blended ) );
+
+      //meshes built along the same lines blend vertex for vertex, the indices stay
+      vtkStreamlineMeshBuilder::options opts;
+      opts.colourMin = 0.0;
+      opts.colourMax = 4.0;
+      to.lines.indices = { 0, 1, 2 };
+      vtkStreamlineMesh meshFrom = vtkStreamlineMeshBuilder::build( from, opts );
+      vtkStreamlineMesh meshTo = vtkStreamlineMeshBuilder::build( to, opts );
+      vtkStreamlineMesh meshBlend;
+      ASSERT_TRUE( vtkLerpMeshVertices( meshFrom, meshTo, 0.5f, meshBlend ) );
+      ASSERT_EQ( meshBlend.positions.size(), meshFrom.positions.size() );
+      for( size_t i = 0; i < meshBlend.positions.size(); i++ )
+         EXPECT_FLOAT_EQ( meshBlend.positions[i], ( meshFrom.positions[i] + meshTo.positions[i] ) * 0.5f );
+      for( size_t i = 0; i < meshBlend.colours.size(); i++ )
+         EXPECT_NEAR( meshBlend.colours[i], ( meshFrom.colours[i] + meshTo.colours[i] ) / 2.0, 1.0 );
+      EXPECT_TRUE( meshBlend.indices.empty() );
+
+      meshTo.positions.resize( meshTo.positions.size() - 3 );
+      EXPECT_FALSE( vtkLerpMeshVertices( meshFrom, meshTo, 0.5f, meshBlend ) );
+   }
+
+   TEST( vtkListTimeStamps, root_and_streamline_times_listed_once )
+   {
+      //solver output at the case root, streamlines under postProcessing, the way pitzDailySteady is laid out
+      const std::string caseDir = "./vtkListTimeStamps_case";
+      std::filesystem::remove_all( caseDir );
+      for( const char* dir : { "0", "100", "200", "287", "constant/polyMesh", "system",
+                               "postProcessing/streamlines/100", "postProcessing/streamlines/200",
+                               "postProcessing/streamlines/287", "postProcessing/streamlines/0.5",
+                               "postProcessing/streamlines/200.0", "postProcessing/streamlines/1e2x" } )
+         std::filesystem::create_directories( caseDir + "/" + dir );
+
+      std::vector<std::string> times = vtkListTimeStamps( caseDir );
+      ASSERT_EQ( times.size(), 5u );
+      EXPECT_EQ( times[0], "0" );
+      EXPECT_EQ( times[1], "0.5" );
+      EXPECT_EQ( times[2], "100" );
+      EXPECT_DOUBLE_EQ( std::stod( times[3] ), 200.0 );
+      EXPECT_EQ( times[4], "287" );
+      EXPECT_TRUE( vtkListTimeStamps( caseDir + "/missing" ).empty() );
+      std::filesystem::remove_all( caseDir );
+   }
+
+   TEST( vtkBVH, queries_match_brute_force )
+   {
+      std::mt19937 rng( 7 );
+      std::uniform_real_distribution<float> coord( -10.0f, 10.0f );
+      std::vector<vtkAABB> boxes( 20000 );
+      for( vtkAABB& box : boxes )
+      {
+         float p[3] = { coord( rng ), coord( rng ), coord( rng ) };
+         float q[3] = { p[0] + 0.1f, p[1] + 0.1f, p[2] + 0.1f };
+         box.expand( p );
+         box.expand( q );
+      }
+
+      vtkBVH serial, parallel;
+      serial.build( boxes );
+      vtkThreadPool pool( 4 );
+      parallel.build( boxes, &pool );
+      EXPECT_EQ( parallel.itemCount(), boxes.size() );
+
+      float centre[3] = { 1.0f, -2.0f, 3.0f };
+      std::vector<int> expected;
+      for( int i = 0; i < (int)boxes.size(); i++ )
+      {
+         float d2 = 0.0f;
+         for( int a = 0; a < 3; a++ )
+         {
+            float d = std::max( { boxes[i].min[a] - centre[a], 0.0f, centre[a] - boxes[i].max[a] } );
+            d2 += d * d;
+         }
+         if( d2 <= 4.0f )
+            expected.push_back( i );
+      }
+      for( vtkBVH* tree : { &serial, &parallel } )
+      {
+         std::vector<int> found;
+         tree->querySphere( centre, 2.0f, found );
+         std::sort( found.begin(), found.end() );
+         EXPECT_EQ( found, expected );
+      }
+
+      //the identity matrix's frustum is the clip cube
+      float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+      vtkFrustum cube = vtkFrustum::fromMatrix( identity );
+      std::vector<int> inView;
+      parallel.queryFrustum( cube, inView );
+      size_t inside = std::count_if( boxes.begin(), boxes.end(), []( const vtkAABB& b )
+         {
+            for( int a = 0; a < 3; a++ )
+               if( b.max[a] < -1.0f || b.min[a] > 1.0f )
+                  return false;
+            return true;
+         } );
+      EXPECT_EQ( inView.size(), inside );
+   }
+
+   TEST( vtkStreamlineSpatialIndex, chunks_and_picking )
+   {
+      writeTestFile( "./vtkParser_spatial.vtk", smallTracksVtk );
+      vtkParser parser;
+      parser.setVtkFile( "./vtkParser_spatial.vtk" );
+      ASSERT_TRUE( parser.init() );
+      ASSERT_TRUE( parser.parseOpenFoam() );
+      vtkParser::openFoamVtkFileData data = parser.getOpenFoamData();
+      parser.freeVtkData();
+
+      //one segment per chunk so each line is its own chunk
+      auto index = vtkStreamlineSpatialIndex::build( data, data.lines, 1.0f, 1 );
+      ASSERT_EQ( index->getChunks().size(), 2u );
+      EXPECT_EQ( index->getChunks()[1].firstLine, 1 );
+
+      vtkParser::vtkPoint target = data.points.point( 3 );
+      float near[3] = { target.x + 0.01f, target.y, target.z };
+      EXPECT_EQ( index->nearestPoint( near, 0.1f ), 3 );
+      float far[3] = { 100.0f, 100.0f, 100.0f };
+      EXPECT_EQ( index->nearestPoint( far, 0.1f ), -1 );
+
+      //straight down onto point 2
+      vtkParser::vtkPoint p2 = data.points.point( 2 );
+      float origin[3] = { p2.x, p2.y, p2.z + 5.0f }, down[3] = { 0.0f, 0.0f, -1.0f };
+      EXPECT_EQ( index->pickRay( origin, down, 0.05f, 100.0f ), 2 );
+
+      //a matrix scaling world space by 0.5 and moving it 1 along x, the ray through the
+      //centre of the screen starts at world (-2, 0, -2) and runs 4 units along z
+      float mvp[16] = { 0.5f, 0, 0, 0, 0, 0.5f, 0, 0, 0, 0, 0.5f, 0, 1.0f, 0, 0, 1 };
+      float rayOrigin[3], rayDir[3], length = 0.0f;
+      ASSERT_TRUE( vtkUnprojectRay( mvp, 0.0f, 0.0f, rayOrigin, rayDir, length ) );
+      EXPECT_NEAR( rayOrigin[0], -2.0f, 1e-5f );
+      EXPECT_NEAR( rayOrigin[2], -2.0f, 1e-5f );
+      EXPECT_NEAR( rayDir[2], 1.0f, 1e-5f );
+      EXPECT_NEAR( length, 4.0f, 1e-5f );
+   }
+
+   TEST( vtkFoamMesh, reads_polymesh_into_csr )
+   {
+      //two tetrahedra sharing face 0, just enough topology to check the CSR
+      const std::string header = "FoamFile\n{\n    version 2.0;\n    format ascii;\n    class %s;\n"
+                                 "    note \"nCells:2 nFaces:7\";\n    object %s;\n}\n// * * //\n\n";
+      auto foamFile = [&header]( const char* cls, const char* obj, const std::string& body ) {
+         char buf[256];
+         std::snprintf( buf, sizeof( buf ), header.c_str(), cls, obj );
+         return std::string( buf ) + body;
+      };
+      std::filesystem::create_directories( "./vtkFoamMesh_case" );
+      writeTestFile( "./vtkFoamMesh_case/points", foamFile( "vectorField", "points",
+         "5\n(\n(0 0 0)\n(1 0 0)\n(0 1 0)\n(0 0 1)\n(0 0 -1.5e-1)\n)\n" ) );
+      writeTestFile( "./vtkFoamMesh_case/faces", foamFile( "faceList", "faces",
+         "7\n(\n3(0 1 2)\n3(0 3 1)\n3(1 3 2)\n3(0 2 3)\n3(0 4 1) /* bottom */\n3(1 4 2)\n3(0 2 4)\n)\n" ) );
+      writeTestFile( "./vtkFoamMesh_case/owner", foamFile( "labelList", "owner", "7(0 0 0 0 1 1 1)\n" ) );
+      writeTestFile( "./vtkFoamMesh_case/neighbour", foamFile( "labelList", "neighbour", "1{1}\n" ) );
+      writeTestFile( "./vtkFoamMesh_case/boundary", foamFile( "polyBoundaryMesh", "boundary",
+         "2\n(\n    walls\n    {\n        type wall;\n        inGroups List<word> 1(wall);\n"
+         "        nFaces 4;\n        startFace 1;\n    }\n    bottom\n    {\n        type patch;\n"
+         "        nFaces 2;\n        startFace 5;\n    }\n)\n" ) );
+
+      vtkThreadPool pool( 2 );
+      vtkFoamMesh::polyMesh mesh;
+      ASSERT_TRUE( vtkFoamMesh::readPolyMesh( "./vtkFoamMesh_case", mesh, &pool ) );
+      EXPECT_EQ( mesh.pointCount(), 5u );
+      EXPECT_DOUBLE_EQ( mesh.points[14], -0.15 );
+      ASSERT_EQ( mesh.faceCount(), 7u );
+      EXPECT_EQ( mesh.internalFaceCount(), 1u );
+      EXPECT_EQ( mesh.face( 4 )[1], 4 );
+      ASSERT_EQ( mesh.patches.size(), 2u );
+      EXPECT_EQ( mesh.patches[0].name, "walls" );
+      EXPECT_EQ( mesh.patches[0].type, "wall" );
+      EXPECT_EQ( mesh.patches[1].startFace, 5 );
+
+      //the shared face belongs to both cells, every other face to one
+      ASSERT_EQ( mesh.cellCount, 2 );
+      std::vector<int> cell0( mesh.cell( 0 ).begin(), mesh.cell( 0 ).end() );
+      std::vector<int> cell1( mesh.cell( 1 ).begin(), mesh.cell( 1 ).end() );
+      EXPECT_EQ( cell0, ( std::vector<int>{ 0, 1, 2, 3 } ) );
+      EXPECT_EQ( cell1, ( std::vector<int>{ 0, 4, 5, 6 } ) );
+
+      //a face pointing past the points is refused
+      writeTestFile( "./vtkFoamMesh_case/owner", foamFile( "labelList", "owner", "6(0 0 0 0 1 1)\n" ) );
+      EXPECT_FALSE( vtkFoamMesh::readPolyMesh( "./vtkFoamMesh_case", mesh ) );
+
+      //labels fill int32, one past it is refused rather than wrapped to a valid cell
+      std::vector<int> labels;
+      writeTestFile( "./vtkFoamMesh_case/owner", foamFile( "labelList", "owner", "3(-1 0 2147483647)\n" ) );
+      ASSERT_TRUE( vtkFoamMesh::readLabels( "./vtkFoamMesh_case/owner", labels ) );
+      EXPECT_EQ( labels, ( std::vector<int>{ -1, 0, 2147483647 } ) );
+      writeTestFile( "./vtkFoamMesh_case/owner", foamFile( "labelList", "owner", "3(0 1 4294967297)\n" ) );
+      EXPECT_FALSE( vtkFoamMesh::readLabels( "./vtkFoamMesh_case/owner", labels ) );
+
+      //a negative face count is refused before anything is sized from it
+      std::vector<int> offsets, indices;
+      writeTestFile( "./vtkFoamMesh_case/faces", foamFile( "faceList", "faces", "-1\n(\n)\n" ) );
+      EXPECT_FALSE( vtkFoamMesh::readFaces( "./vtkFoamMesh_case/faces", offsets, indices ) );
+
+      //compact offsets have to start at 0 and never go back
+      writeTestFile( "./vtkFoamMesh_case/faces", foamFile( "faceCompactList", "faces", "3(0 3 6)\n6(0 1 2 0 3 1)\n" ) );
+      ASSERT_TRUE( vtkFoamMesh::readFaces( "./vtkFoamMesh_case/faces", offsets, indices ) );
+      EXPECT_EQ( offsets, ( std::vector<int>{ 0, 3, 6 } ) );
+      for( const char* bad : { "3(0 5 3)\n3(0 1 2)\n", "2(1 3)\n3(0 1 2)\n" } ) {
+         writeTestFile( "./vtkFoamMesh_case/faces", foamFile( "faceCompactList", "faces", bad ) );
+         EXPECT_FALSE( vtkFoamMesh::readFaces( "./vtkFoamMesh_case/faces", offsets, indices ) ) << bad;
+      }
+   }
+
+   TEST( vtkFoamField, reads_internal_and_patch_values )
+   {
+      std::filesystem::create_directories( "./vtkFoamField_case/1" );
+      writeTestFile( "./vtkFoamField_case/1/U",
+         "FoamFile\n{\n    format ascii;\n    class volVectorField;\n    object U;\n}\n"
+         "dimensions [0 1 -1 0 0 0 0];\n\n"
+         "internalField nonuniform List<vector> 2((1 2 3) (4 5 -6e-1));\n\n"
+         "boundaryField\n{\n"
+         "    inlet { type fixedValue; value uniform (10 0 0); }\n"
+         "    outlet { type zeroGradient; }\n"
+         "    walls { type calculated; inletValue uniform (0 0 0); value nonuniform List<vector> 2((1 1 1)(2 2 2)); }\n}\n" );
+      writeTestFile( "./vtkFoamField_case/1/p",
+         "FoamFile\n{\n    format ascii;\n    class volScalarField;\n    object p;\n}\n"
+         "dimensions [0 2 -2 0 0 0 0];\ninternalField uniform 7;\nboundaryField\n{\n"
+         "    inlet { type fixedValue; value $internalField; }\n"
+         "    outlet { type fixedValue; value #calc \"$pOut * 2\"; }\n}\n" );
+      writeTestFile( "./vtkFoamField_case/1/notes", "not a field\n" );
+
+      vtkFoamMesh::polyMesh mesh;
+      mesh.cellCount = 2;
+      mesh.patches = { { "inlet", "patch", 0, 3 }, { "outlet", "patch", 3, 1 }, { "walls", "wall", 4, 2 } };
+
+      EXPECT_EQ( vtkFoamField::listFields( "./vtkFoamField_case/1" ), ( std::vector<std::string>{ "U", "p" } ) );
+
+      vtkThreadPool pool( 2 );
+      std::vector<std::vector<vtkFoamField::field>> steps;
+      ASSERT_TRUE( vtkFoamField::readTimeSteps( { "./vtkFoamField_case/1" }, { "U", "p" }, steps, &mesh, &pool ) );
+      const vtkFoamField::field& U = steps[0][0];
+      EXPECT_EQ( U.name, "U" );
+      EXPECT_EQ( U.components, 3 );
+      ASSERT_EQ( U.size(), 2u );
+      EXPECT_DOUBLE_EQ( U.internal[5], -0.6 );
+      ASSERT_EQ( U.patches.size(), 3u );
+      //the uniform inlet value is expanded over the patch's 3 faces
+      EXPECT_EQ( U.patches[0].values.size(), 9u );
+      EXPECT_FALSE( U.patches[1].hasValue );
+      EXPECT_DOUBLE_EQ( U.patches[2].values[3], 2.0 );
+
+      const vtkFoamField::field& p = steps[0][1];
+      EXPECT_EQ( p.internal, ( std::vector<double>{ 7.0, 7.0 } ) );
+      //$internalField takes the internal value, forms the reader doesn't know leave the patch without one
+      ASSERT_EQ( p.patches.size(), 2u );
+      EXPECT_EQ( p.patches[0].values, ( std::vector<double>{ 7.0, 7.0, 7.0 } ) );
+      EXPECT_FALSE( p.patches[1].hasValue );
+
+      //a nonuniform field of the wrong size is refused
+      mesh.cellCount = 3;
+      vtkFoamField::field wrong;
+      EXPECT_FALSE( vtkFoamField::readField( "./vtkFoamField_case/1/U", wrong, &mesh ) );
+   }
+
+   TEST( vtkFoamField, reads_bundled_case_initial_fields )
+   {
+      //the bundled case sits at the repository root, the tests may run from the build tree
+      std::filesystem::path caseDir;
+      for( std::filesystem::path dir : { std::filesystem::path( __FILE__ ).parent_path() / "../..", std::filesystem::path( ".." ),
+                                         std::filesystem::path( "../.." ), std::filesystem::path( "." ) } )
+         if( std::filesystem::exists( dir / "pitzDailySteady/0/omega" ) ) { caseDir = dir / "pitzDailySteady"; break; }
+      if( caseDir.empty() )
+         GTEST_SKIP() << "pitzDailySteady not found";
+
+      //every patch value is "value $internalField;"
+      vtkFoamField::field omega;
+      ASSERT_TRUE( vtkFoamField::readField( ( caseDir / "0/omega" ).string(), omega ) );
+      ASSERT_TRUE( omega.uniform );
+      EXPECT_EQ( omega.internal, ( std::vector<double>{ 440.15 } ) );
+      auto inlet = std::find_if( omega.patches.begin(), omega.patches.end(),
+         []( const vtkFoamField::patchField& patch ) { return patch.name == "inlet"; } );
+      ASSERT_NE( inlet, omega.patches.end() );
+      EXPECT_TRUE( inlet->hasValue );
+      EXPECT_EQ( inlet->values, omega.internal );
+
+      for( const char* name : { "U", "epsilon", "f", "k", "nuTilda", "nut", "p", "v2" } ) {
+         vtkFoamField::field field;
+         EXPECT_TRUE( vtkFoamField::readField( ( caseDir / "0" / name ).string(), field ) ) << name;
+      }
+   }
+
+   TEST( vtkParser, binary_vtk_and_vtp_match_ascii )
+   {
+      const float points[15] = { 0, 0, 0, 1, 0, 0, 2, 0, 0, 0, 1, 0, 0, 2, 1e-05f };
+      const double pressure[5] = { 1.5, -2.0, 3.25, 0.0, 1e-3 };
+
+      //every value big endian, the way legacy BINARY is written
+      auto bigEndian = []( std::string& out, const void* value, size_t size ) {
+         for( size_t i = 0; i < size; i++ )
+            out += ( (const char*)value )[size - 1 - i];
+      };
+      std::string legacy = "# vtk DataFile Version 2.0\ntracks\nBINARY\nDATASET POLYDATA\nPOINTS 5 float\n";
+      for( float v : points ) bigEndian( legacy, &v, 4 );
+      legacy += "\nLINES 2 7\n";
+      for( int v : { 3, 0, 1, 2, 2, 3, 4 } ) bigEndian( legacy, &v, 4 );
+      legacy += "\nPOINT_DATA 5\nFIELD attributes 1\np 1 5 double\n";
+      for( double v : pressure ) bigEndian( legacy, &v, 8 );
+      legacy += "\n";
+      writeTestFile( "./vtkParser_binary.vtk", legacy );
+
+      //raw appended Int64 connectivity plus an inline base64 array, header and values encoded apart
+      auto base64 = []( const std::string& bytes ) {
+         const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+         std::string out;
+         for( size_t i = 0; i < bytes.size(); i += 3 ) {
+            uint32_t q = 0;
+            size_t n = std::min<size_t>( 3, bytes.size() - i );
+            for( size_t j = 0; j < 3; j++ ) q = ( q << 8 ) | ( j < n ? (uint8_t)bytes[i + j] : 0 );
+            for( size_t j = 0; j < 4; j++ ) out += ( j <= n ) ? chars[( q >> ( 18 - 6 * j ) ) & 63] : '=';
+         }
+         return out;
+      };
+      auto block = []( const void* values, size_t bytes ) {
+         uint32_t length = (uint32_t)bytes;
+         return std::string( (const char*)&length, 4 ) + std::string( (const char*)values, bytes );
+      };
+      const int64_t connectivity[5] = { 0, 1, 2, 3, 4 };
+      const int32_t offsets[2] = { 3, 5 };
+      std::string appended = block( points, sizeof( points ) );
+      size_t connectivityAt = appended.size();
+      appended += block( connectivity, sizeof( connectivity ) );
+      size_t offsetsAt = appended.size();
+      appended += block( offsets, sizeof( offsets ) );
+      uint32_t pressureBytes = sizeof( pressure );
+      std::string vtp = fmt::format(
+         "<?xml version=\"1.0\"?>\n<VTKFile type=\"PolyData\" version=\"1.0\" byte_order=\"{}\" header_type=\"UInt32\">\n"
+         "<PolyData>\n<Piece NumberOfPoints=\"5\" NumberOfLines=\"2\">\n"
+         "<PointData>\n<DataArray type=\"Float64\" Name=\"p\" format=\"binary\">\n{}{}\n</DataArray>\n</PointData>\n"
+         "<Points>\n<DataArray type=\"Float32\" NumberOfComponents=\"3\" format=\"appended\" offset=\"0\"/>\n</Points>\n"
+         "<Lines>\n<DataArray type=\"Int64\" Name=\"connectivity\" format=\"appended\" offset=\"{}\"/>\n"
+         "<DataArray type=\"Int32\" Name=\"offsets\" format=\"appended\" offset=\"{}\"/>\n</Lines>\n"
+         "</Piece>\n</PolyData>\n<AppendedData encoding=\"raw\">\n_",
+         std::endian::native == std::endian::little ? "LittleEndian" : "BigEndian",
+         base64( std::string( (const char*)&pressureBytes, 4 ) ), base64( std::string( (const char*)pressure, sizeof( pressure ) ) ),
+         connectivityAt, offsetsAt );
+      writeTestFile( "./vtkParser_appended.vtp", vtp + appended + "\n</AppendedData>\n</VTKFile>\n" );
+
+      for( const char* path : { "./vtkParser_binary.vtk", "./vtkParser_appended.vtp" } ) {
+         SCOPED_TRACE( path );
+         vtkParser parser;
+         parser.setVtkFile( path );
+         ASSERT_TRUE( parser.init() );
+         ASSERT_TRUE( parser.parseOpenFoam() );
+         vtkParser::openFoamVtkFileData data = parser.releaseOpenFoamData();
+         parser.freeVtkData();
+
+         ASSERT_EQ( data.points.size, 5 );
+         EXPECT_EQ( data.points.type, vtkParser::TYPE_FLOAT );
+         EXPECT_FLOAT_EQ( data.points.point( 4 ).z, 1e-05f );
+         EXPECT_EQ( data.lines.offsets, ( std::vector<int>{ 0, 3, 5 } ) );
+         EXPECT_EQ( data.lines.indices, ( std::vector<int>{ 0, 1, 2, 3, 4 } ) );
+         const vtkParser::vtkDataArray* p = vtkParser::getVtkData( data, vtkParser::POINT_DATA, "p" );
+         ASSERT_NE( p, nullptr );
+         ASSERT_EQ( p->type, vtkParser::TYPE_DOUBLE );
+         EXPECT_DOUBLE_EQ( p->value( 2 ), 3.25 );
+         EXPECT_DOUBLE_EQ( p->value( 4 ), 1e-3 );
+      }
+
+      //an array longer than NumberOfPoints is cut to the declared tuples, in the cache too
+      const double longPressure[7] = { 1.5, -2.0, 3.25, 0.0, 1e-3, 7.0, 8.0 };
+      std::string longAppended = appended + block( longPressure, sizeof( longPressure ) );
+      std::string longVtp = vtp;
+      longVtp.replace( longVtp.find( "format=\"binary\">" ), std::string( "format=\"binary\">" ).size(),
+         fmt::format( "format=\"appended\" offset=\"{}\">", appended.size() ) );
+      const std::string longPath = "./vtkParser_long.vtp";
+      writeTestFile( longPath, longVtp + longAppended + "\n</AppendedData>\n</VTKFile>\n" );
+      std::remove( vtkParser::cachePathFor( longPath ).c_str() );
+      for( int pass = 0; pass < 2; pass++ ) {
+         SCOPED_TRACE( pass );
+         vtkParser parser;
+         parser.setVtkFile( longPath );
+         parser.setCache( true );
+         ASSERT_TRUE( parser.init() );
+         ASSERT_TRUE( parser.parseOpenFoam() );
+         vtkParser::openFoamVtkFileData data = parser.releaseOpenFoamData();
+         parser.freeVtkData();
+         EXPECT_EQ( data.index->sections[0].encoding, pass ? vtkParser::ENCODING_RAW : vtkParser::ENCODING_BINARY );
+         const vtkParser::vtkDataArray* p = vtkParser::getVtkData( data, vtkParser::POINT_DATA, "p" );
+         ASSERT_NE( p, nullptr );
+         EXPECT_EQ( p->values<double>().size(), 5u );
+         EXPECT_DOUBLE_EQ( p->value( 4 ), 1e-3 );
+      }
+
+      //the SSE2 swap and its scalar tail agree with a plain reverse
+      std::vector<uint32_t> words( 13 );
+      for( size_t i = 0; i < words.size(); i++ ) words[i] = 0x01020304u * (uint32_t)( i + 1 );
+      std::vector<uint32_t> swapped( words );
+      vtkByteSwap( swapped.data(), 4, swapped.size() );
+      for( size_t i = 0; i < words.size(); i++ ) {
+         uint32_t w = words[i];
+         EXPECT_EQ( swapped[i], ( w >> 24 ) | ( ( w >> 8 ) & 0xff00u ) | ( ( w << 8 ) & 0xff0000u ) | ( w << 24 ) );
+      }
+   }
+
+#ifdef VTK_HAVE_ZLIB
+   TEST( vtkInflateStream, reads_gzip_fields_and_tracks )
+   {
+      //written as two gzip members, the way concatenated output looks
+      auto writeGzip = []( const std::string& path, const std::string& body ) {
+         size_t half = body.size() / 2;
+         for( int member = 0; member < 2; member++ ) {
+            gzFile gz = gzopen( path.c_str(), member == 0 ? "wb" : "ab" );
+            std::string part = member == 0 ? body.substr( 0, half ) : body.substr( half );
+            gzwrite( gz, part.data(), (unsigned)part.size() );
+            gzclose( gz );
+         }
+      };
+
+      //big enough that the list runs across several refills of the window
+      const int cells = 60000;
+      std::string U = "FoamFile\n{\n    format ascii;\n    class volVectorField;\n    object U;\n}\n"
+         "// * * * * //\ndimensions [0 1 -1 0 0 0 0];\n/* a\nlong comment */\n"
+         "internalField nonuniform List<vector>\n" + std::to_string( cells ) + "\n(\n";
+      for( int i = 0; i < cells; i++ ) U += fmt::format( "({} {} -1.25e-3)\n", i, i * 0.5 );
+      U += ")\n;\nboundaryField\n{\n    walls { type fixedValue; value uniform (0 0 0); }\n}\n";
+      std::filesystem::create_directories( "./vtkInflate_case/2" );
+      std::filesystem::remove( "./vtkInflate_case/2/U" );
+      writeGzip( "./vtkInflate_case/2/U.gz", U );
+
+      EXPECT_EQ( vtkFoamField::listFields( "./vtkInflate_case/2" ), ( std::vector<std::string>{ "U" } ) );
+      vtkFoamField::field field;
+      //U is missing so U.gz is read in its place
+      ASSERT_TRUE( vtkFoamField::readField( "./vtkInflate_case/2/U", field ) );
+      ASSERT_EQ( field.size(), (size_t)cells );
+      EXPECT_EQ( field.dimensions, "[0 1 -1 0 0 0 0]" );
+      EXPECT_DOUBLE_EQ( field.internal[3 * ( cells - 1 )], cells - 1 );
+      EXPECT_DOUBLE_EQ( field.internal[3 * 4321 + 1], 4321 * 0.5 );
+      EXPECT_DOUBLE_EQ( field.internal[3 * cells - 1], -1.25e-3 );
+      ASSERT_EQ( field.patches.size(), 1u );
+      EXPECT_EQ( field.patches[0].type, "fixedValue" );
+
+      //a cut short file fails instead of reading as a shorter one
+      std::string whole;
+      {
+         std::ifstream fin( "./vtkInflate_case/2/U.gz", std::ios::binary );
+         whole.assign( std::istreambuf_iterator<char>( fin ), std::istreambuf_iterator<char>() );
+      }
+      writeTestFile( "./vtkInflate_cut.gz", whole.substr( 0, whole.size() / 3 ) );
+      EXPECT_FALSE( vtkFoamField::readField( "./vtkInflate_cut.gz", field ) );
+
+      writeGzip( "./vtkInflate_tracks.vtk.gz", smallTracksVtk );
+      EXPECT_EQ( vtkInflateStream::sizeHint( "./vtkInflate_tracks.vtk.gz" ), std::string( smallTracksVtk ).size() - std::string( smallTracksVtk ).size() / 2 );
+      //a garbage trailer can't claim more than deflate could have expanded to
+      writeTestFile( "./vtkInflate_bogus.gz", std::string( "\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\x03\x03\x00\x00\x00\x00\x00\xff\xff\xff\xff", 20 ) );
+      EXPECT_LE( vtkInflateStream::sizeHint( "./vtkInflate_bogus.gz" ), 20u * 1032u );
+      vtkParser parser;
+      parser.setVtkFile( "./vtkInflate_tracks.vtk.gz" );
+      ASSERT_TRUE( parser.init() );
+      ASSERT_TRUE( parser.parseOpenFoam() );
+      vtkParser::openFoamVtkFileData data = parser.releaseOpenFoamData();
+      parser.freeVtkData();
+      ASSERT_EQ( data.points.size, 5 );
+      EXPECT_FLOAT_EQ( data.points.point( 4 ).z, 1e-05f );
+      EXPECT_EQ( data.lines.offsets, ( std::vector<int>{ 0, 3, 5 } ) );
+   }
+#endif
+
+   TEST( vtkCaseGenerator, ascii_and_binary_cases_read_back )
+   {
+      //more points than the old MAXPOLY limit, a little polyMesh and two time steps
+      vtkCaseGenerator::options opts;
+      opts.trackPoints = 150001;
+      opts.streamlines = 7;
+      opts.cells = 64;
+      opts.timeSteps = 2;
+      opts.fields = vtkCaseGenerator::parseFields( "p,U,T:1" );
+      ASSERT_EQ( opts.fields.size(), 3u );
+      EXPECT_EQ( opts.fields[1].components, 3 );
+      EXPECT_TRUE( vtkCaseGenerator::parseFields( "p,U:2" ).empty() );
+
+      std::vector<vtkParser::openFoamVtkFileData> tracks;
+      std::vector<vtkFoamField::field> fields;
+      for( bool binary : { false, true } ) {
+         SCOPED_TRACE( binary ? "binary" : "ascii" );
+         opts.binary = binary;
+         opts.caseDir = binary ? "./vtkCaseGen_binary" : "./vtkCaseGen_ascii";
+         std::filesystem::remove_all( opts.caseDir );
+         ASSERT_TRUE( vtkCaseGenerator::write( opts ) );
+
+         vtkFoamMesh::polyMesh mesh;
+         ASSERT_TRUE( vtkFoamMesh::readPolyMesh( opts.caseDir + "/constant/polyMesh", mesh ) );
+         EXPECT_EQ( mesh.cellCount, 64 );
+         EXPECT_EQ( mesh.pointCount(), 125u );
+         EXPECT_EQ( mesh.internalFaceCount(), 144u );
+         ASSERT_EQ( mesh.patches.size(), 3u );
+         EXPECT_EQ( mesh.patches[2].nFaces, 64 );
+         //every cell of the block is a hex
+         for( int c = 0; c < mesh.cellCount; c++ )
+            EXPECT_EQ( mesh.cellOffsets[c + 1] - mesh.cellOffsets[c], 6 );
+
+         EXPECT_EQ( vtkFoamField::listFields( opts.caseDir + "/2" ), ( std::vector<std::string>{ "T", "U", "p" } ) );
+         fields.emplace_back();
+         ASSERT_TRUE( vtkFoamField::readField( opts.caseDir + "/2/U", fields.back(), &mesh ) );
+         EXPECT_EQ( fields.back().size(), 64u );
+         EXPECT_EQ( fields.back().patches[0].values.size(), 48u );
+
+         vtkParser parser;
+         parser.setVtkFile( opts.caseDir + "/postProcessing/streamlines/2/tracks.vtk" );
+         ASSERT_TRUE( parser.init() );
+         ASSERT_TRUE( parser.parseOpenFoam() );
+         tracks.push_back( parser.releaseOpenFoamData() );
+         parser.freeVtkData();
+         EXPECT_EQ( tracks.back().points.size, 150001 );
+         EXPECT_EQ( tracks.back().lines.size(), 7u );
+         EXPECT_EQ( tracks.back().lines.offsets.back(), 150001 );
+         const vtkParser::vtkDataArray* U = vtkParser::getVtkData( tracks.back(), vtkParser::POINT_DATA, "U" );
+         ASSERT_NE( U, nullptr );
+         EXPECT_EQ( U->numComponents, 3 );
+         EXPECT_NE( vtkParser::getVtkData( tracks.back(), vtkParser::POINT_DATA, "age" ), nullptr );
+      }
+
+      //both encodings hold the same case
+      EXPECT_EQ( fields[0].internal, fields[1].internal );
+      EXPECT_EQ( tracks[0].lines.offsets, tracks[1].lines.offsets );
+      for( int i = 0; i < tracks[0].points.size; i += 997 )
+         EXPECT_FLOAT_EQ( tracks[0].points.point( i ).y, tracks[1].points.point( i ).y );
+      EXPECT_FLOAT_EQ( vtkParser::getVtkData( tracks[0], vtkParser::POINT_DATA, "T" )->value( 12345 ),
+         vtkParser::getVtkData( tracks[1], vtkParser::POINT_DATA, "T" )->value( 12345 ) );
+   }
+
+   TEST( vtkTrace, zones_summary_and_chrome_export )
+   {
+      //the recorder works whether or not the VTK_TRACE_* macros are compiled in
+      vtkTrace::clear();
+      vtkTrace::setEnabled( true );
+      vtkTrace::frameMark();
+      {
+         vtkTraceZone outer( "test::outer" );
+         for( int i = 0; i < 3; i++ )
+            vtkTraceZone inner( "test::inner" );
+      }
+      std::thread worker( []() {
+         vtkTrace::setThreadName( "test worker" );
+         vtkTraceZone zone( "test::worker" );
+      } );
+      worker.join();
+      vtkTrace::setEnabled( false );
+      {
+         vtkTraceZone ignored( "test::ignored" );
+      }
+      vtkTrace::setEnabled( true );
+      vtkTrace::frameMark();
+
+      vtkTrace::frameSummary frame = vtkTrace::lastFrame();
+      EXPECT_GT( frame.frameMs, 0.0 );
+      auto find = [&frame]( const std::string& name ) {
+         for( const vtkTrace::zoneStat& zone : frame.zones )
+            if( name == zone.name ) return zone;
+         return vtkTrace::zoneStat{ nullptr };
+      };
+      EXPECT_EQ( find( "test::inner" ).calls, 3 );
+      EXPECT_EQ( find( "test::outer" ).calls, 1 );
+      EXPECT_EQ( find( "test::worker" ).calls, 1 );
+      EXPECT_EQ( find( "test::ignored" ).calls, 0 );
+      //the outer zone holds the inner ones
+      EXPECT_GE( find( "test::outer" ).totalMs, find( "test::inner" ).totalMs );
+      EXPECT_GE( frame.zones.front().totalMs, frame.zones.back().totalMs );
+
+      ASSERT_TRUE( vtkTrace::writeChromeTrace( "./vtkTrace_test.json" ) );
+      std::ifstream fin( "./vtkTrace_test.json" );
+      std::string json( ( std::istreambuf_iterator<char>( fin ) ), std::istreambuf_iterator<char>() );
+      EXPECT_NE( json.find( "\"traceEvents\"" ), std::string::npos );
+      EXPECT_NE( json.find( "{\"name\":\"test::worker\",\"ph\":\"X\"" ), std::string::npos );
+      EXPECT_NE( json.find( "\"args\":{\"name\":\"test worker\"}" ), std::string::npos );
+      EXPECT_EQ( json.find( "test::ignored" ), std::string::npos );
+      EXPECT_EQ( json.back(), '\n' );
+      vtkTrace::clear();
+   }
+}
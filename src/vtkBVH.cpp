@@ -0,0 +1,376 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+#include <algorithm>
+#include <cmath>
+#include <future>
+
+#include "vtkBVH.hpp"
+
+#define BVH_LEAF_ITEMS 4
+
+void vtkAABB::expand(const float p[3]) {
+	for (int a = 0; a < 3; a++) {
+		min[a] = std::min(min[a], p[a]);
+		max[a] = std::max(max[a], p[a]);
+	}
+}
+
+void vtkAABB::expand(const vtkAABB& box) {
+	for (int a = 0; a < 3; a++) {
+		min[a] = std::min(min[a], box.min[a]);
+		max[a] = std::max(max[a], box.max[a]);
+	}
+}
+
+vtkFrustum vtkFrustum::fromMatrix(const float* m) {
+	// row r of a column major matrix is m[r], m[4 + r], m[8 + r], m[12 + r]
+	auto row = [m](int r, int c) { return m[c * 4 + r]; };
+	vtkFrustum f;
+	for (int p = 0; p < 6; p++) {
+		int r = p / 2;
+		float sign = (p % 2 == 0) ? 1.0f : -1.0f; // left/bottom/near then right/top/far
+		for (int c = 0; c < 4; c++) f.planes[p][c] = row(3, c) + sign * row(r, c);
+	}
+	return f;
+}
+
+bool vtkFrustum::intersects(const vtkAABB& box) const {
+	for (int p = 0; p < 6; p++) {
+		// the box corner furthest along the plane normal
+		float x = planes[p][0] >= 0.0f ? box.max[0] : box.min[0];
+		float y = planes[p][1] >= 0.0f ? box.max[1] : box.min[1];
+		float z = planes[p][2] >= 0.0f ? box.max[2] : box.min[2];
+		if (planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3] < 0.0f) return false;
+	}
+	return true;
+}
+
+namespace {
+	// inverse of a column major 4x4 matrix by cofactors, false when it is singular
+	bool invert4(const float* m, float* inv) {
+		inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+		inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+		inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+		inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+		inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+		inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+		inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+		inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+		inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+		inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+		inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+		inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+		inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+		inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+		inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+		inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+		double det = (double)m[0] * inv[0] + (double)m[1] * inv[4] + (double)m[2] * inv[8] + (double)m[3] * inv[12];
+		if (std::fabs(det) < 1e-30) return false;
+		float scale = (float)(1.0 / det);
+		for (int i = 0; i < 16; i++) inv[i] *= scale;
+		return true;
+	}
+
+	// clip space point x y z through the column major inverse, divided by w
+	bool toWorld(const float* inv, float x, float y, float z, float out[3]) {
+		float v[4];
+		for (int r = 0; r < 4; r++) v[r] = inv[r] * x + inv[4 + r] * y + inv[8 + r] * z + inv[12 + r];
+		if (std::fabs(v[3]) < 1e-30f) return false;
+		for (int r = 0; r < 3; r++) out[r] = v[r] / v[3];
+		return true;
+	}
+}
+
+int vtkUnprojectRay(const float* mvp, float x, float y, float origin[3], float dir[3], float& length) {
+	float inv[16], far[3];
+	if (!invert4(mvp, inv) || !toWorld(inv, x, y, -1.0f, origin) || !toWorld(inv, x, y, 1.0f, far)) return 0;
+	for (int a = 0; a < 3; a++) dir[a] = far[a] - origin[a];
+	length = std::sqrt(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+	if (length < 1e-12f) return 0;
+	for (int a = 0; a < 3; a++) dir[a] /= length;
+	return 1;
+}
+
+struct vtkBVH::buildContext {
+	const std::vector<vtkAABB>* boxes;
+	std::vector<float> centroids; // x y z per item
+	std::vector<int>* order;
+	int splitDepth;
+};
+
+struct vtkBVH::subtreeTask {
+	int nodeIndex;
+	int begin, end;
+	std::vector<node> nodes; // nodes[0] becomes nodeIndex
+};
+
+void vtkBVH::buildRange(buildContext& ctx, std::vector<node>& out, int nodeIndex, int begin, int end,
+	int depth, std::vector<subtreeTask>* deferred) {
+
+	std::vector<int>& order = *ctx.order;
+	vtkAABB box, centres;
+	for (int i = begin; i < end; i++) {
+		box.expand(ctx.boxes->at(order[i]));
+		centres.expand(&ctx.centroids[order[i] * 3]);
+	}
+	out[nodeIndex].box = box;
+
+	int axis = 0;
+	for (int a = 1; a < 3; a++)
+		if (centres.max[a] - centres.min[a] > centres.max[axis] - centres.min[axis]) axis = a;
+
+	// items sharing one centroid can't be split any further
+	if (end - begin <= BVH_LEAF_ITEMS || centres.max[axis] <= centres.min[axis]) {
+		out[nodeIndex].first = begin;
+		out[nodeIndex].count = end - begin;
+		return;
+	}
+	if (deferred != nullptr && depth >= ctx.splitDepth) {
+		deferred->push_back({ nodeIndex, begin, end, {} });
+		return;
+	}
+
+	int mid = begin + (end - begin) / 2;
+	const float* centroids = ctx.centroids.data();
+	std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+		[centroids, axis](int a, int b) { return centroids[a * 3 + axis] < centroids[b * 3 + axis]; });
+
+	int left = (int)out.size();
+	out.resize(out.size() + 2);
+	out[nodeIndex].first = left;
+	out[nodeIndex].count = 0;
+	buildRange(ctx, out, left, begin, mid, depth + 1, deferred);
+	buildRange(ctx, out, left + 1, mid, end, depth + 1, deferred);
+}
+
+void vtkBVH::build(const std::vector<vtkAABB>& boxes, vtkThreadPool* pool) {
+	clear();
+	if (boxes.empty()) return;
+
+	buildContext ctx;
+	ctx.boxes = &boxes;
+	ctx.centroids.resize(boxes.size() * 3);
+	for (size_t i = 0; i < boxes.size(); i++)
+		for (int a = 0; a < 3; a++) ctx.centroids[i * 3 + a] = boxes[i].centre(a);
+	order.resize(boxes.size());
+	for (size_t i = 0; i < boxes.size(); i++) order[i] = (int)i;
+	ctx.order = &order;
+
+	nodes.reserve(boxes.size() * 2 / BVH_LEAF_ITEMS + 1);
+	nodes.resize(1);
+
+	// small trees aren't worth the tasks
+	if (pool == nullptr || pool->size() < 2 || boxes.size() < 4096) {
+		ctx.splitDepth = 0;
+		buildRange(ctx, nodes, 0, 0, (int)boxes.size(), 0, nullptr);
+	}
+	else {
+		buildParallel(ctx, pool);
+	}
+
+	leafBoxes.resize(order.size());
+	for (size_t i = 0; i < order.size(); i++) leafBoxes[i] = boxes[order[i]];
+}
+
+void vtkBVH::buildParallel(buildContext& ctx, vtkThreadPool* pool) {
+	// the top levels are split here, about four subtrees per worker are built on the pool
+	ctx.splitDepth = (int)std::ceil(std::log2((double)pool->size() * 4));
+	std::vector<subtreeTask> deferred;
+	buildRange(ctx, nodes, 0, 0, (int)order.size(), 0, &deferred);
+
+	// each task works on its own run of order and its own node array
+	std::vector<std::future<void> > results;
+	for (subtreeTask& task : deferred) {
+		results.push_back(pool->enqueue([&ctx, &task]() {
+			task.nodes.resize(1);
+			buildRange(ctx, task.nodes, 0, task.begin, task.end, 0, nullptr);
+		}));
+	}
+	for (std::future<void>& result : results) result.get();
+
+	for (subtreeTask& task : deferred) {
+		// local node i > 0 lands at offset + i - 1
+		int offset = (int)nodes.size() - 1;
+		for (node& n : task.nodes)
+			if (n.count == 0) n.first += offset;
+		nodes[task.nodeIndex] = task.nodes[0];
+		nodes.insert(nodes.end(), task.nodes.begin() + 1, task.nodes.end());
+	}
+}
+
+void vtkBVH::clear() {
+	nodes.clear();
+	order.clear();
+	leafBoxes.clear();
+}
+
+template<typename F>
+void vtkBVH::traverse(F&& hits, std::vector<int>& items) const {
+	if (nodes.empty()) return;
+	int stack[64];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const node& n = nodes[stack[--top]];
+		if (!hits(n.box)) continue;
+		if (n.count > 0) {
+			for (int i = n.first; i < n.first + n.count; i++)
+				if (hits(leafBoxes[i])) items.push_back(order[i]);
+		}
+		else {
+			// median splits keep the depth near log2 of the item count
+			stack[top++] = n.first + 1;
+			stack[top++] = n.first;
+		}
+	}
+}
+
+void vtkBVH::queryFrustum(const vtkFrustum& frustum, std::vector<int>& items) const {
+	traverse([&frustum](const vtkAABB& box) { return frustum.intersects(box); }, items);
+}
+
+void vtkBVH::querySphere(const float centre[3], float radius, std::vector<int>& items) const {
+	float r2 = radius * radius;
+	traverse([centre, r2](const vtkAABB& box) {
+		float d2 = 0.0f;
+		for (int a = 0; a < 3; a++) {
+			float d = std::max({ box.min[a] - centre[a], 0.0f, centre[a] - box.max[a] });
+			d2 += d * d;
+		}
+		return d2 <= r2;
+	}, items);
+}
+
+void vtkBVH::queryRay(const float origin[3], const float dir[3], float maxT, float pad, std::vector<int>& items) const {
+	traverse([origin, dir, maxT, pad](const vtkAABB& box) {
+		// slab test
+		float t0 = 0.0f, t1 = maxT;
+		for (int a = 0; a < 3; a++) {
+			float lo = box.min[a] - pad, hi = box.max[a] + pad;
+			if (std::fabs(dir[a]) < 1e-12f) {
+				if (origin[a] < lo || origin[a] > hi) return false;
+				continue;
+			}
+			float inv = 1.0f / dir[a];
+			float near = (lo - origin[a]) * inv, far = (hi - origin[a]) * inv;
+			if (near > far) std::swap(near, far);
+			t0 = std::max(t0, near);
+			t1 = std::min(t1, far);
+			if (t0 > t1) return false;
+		}
+		return true;
+	}, items);
+}
+
+std::shared_ptr<vtkStreamlineSpatialIndex> vtkStreamlineSpatialIndex::build(vtkParser::openFoamVtkFileData& data,
+	const vtkParser::vtkPolylineIndex& lines, float posScale, int chunkSegments, vtkThreadPool* pool) {
+	VTK_TRACE_ZONE("vtkStreamlineSpatialIndex::build");
+
+	auto index = std::make_shared<vtkStreamlineSpatialIndex>();
+	if (lines.empty() || data.points.empty()) return index;
+
+	index->pointIndices = lines.indices;
+	index->positions.resize(lines.totalPoints() * 3);
+	for (size_t s = 0; s < lines.totalPoints(); s++) {
+		vtkParser::vtkPoint p = data.points.point(lines.indices[s]);
+		index->positions[s * 3 + 0] = p.x * posScale;
+		index->positions[s * 3 + 1] = p.y * posScale;
+		index->positions[s * 3 + 2] = p.z * posScale;
+	}
+	const float* pos = index->positions.data();
+
+	std::vector<vtkAABB> segmentBoxes, chunkBoxes;
+	segmentBoxes.reserve(lines.totalPoints());
+	vtkAABB chunkBox;
+	int chunkStart = 0, chunkSize = 0;
+	for (size_t l = 0; l < lines.size(); l++) {
+		int first = lines.offsets[l], n = lines.offsets[l + 1] - first;
+		// one point lines still get a segment so the point can be found
+		bool single = (n == 1);
+		int count = single ? 1 : std::max(n - 1, 0);
+		for (int s = first; s < first + count; s++) {
+			vtkAABB box;
+			box.expand(pos + s * 3);
+			if (!single) box.expand(pos + (s + 1) * 3);
+			index->segments.push_back(s);
+			index->singlePoint.push_back(single ? 1 : 0);
+			segmentBoxes.push_back(box);
+			chunkBox.expand(box);
+			chunkSize++;
+		}
+		if (chunkSize >= chunkSegments || l + 1 == lines.size()) {
+			index->chunks.push_back({ chunkStart, (int)l + 1 });
+			chunkBoxes.push_back(chunkBox);
+			chunkBox = vtkAABB();
+			chunkStart = (int)l + 1;
+			chunkSize = 0;
+		}
+	}
+	index->segmentTree.build(segmentBoxes, pool);
+	index->chunkTree.build(chunkBoxes, pool);
+	return index;
+}
+
+void vtkStreamlineSpatialIndex::visibleChunks(const vtkFrustum& frustum, std::vector<int>& out) const {
+	out.clear();
+	chunkTree.queryFrustum(frustum, out);
+	std::sort(out.begin(), out.end());
+}
+
+int vtkStreamlineSpatialIndex::nearestPoint(const float centre[3], float radius) const {
+	std::vector<int> candidates;
+	segmentTree.querySphere(centre, radius, candidates);
+	int best = -1;
+	float bestD2 = radius * radius;
+	for (int k : candidates) {
+		for (int end = 0; end < (singlePoint[k] ? 1 : 2); end++) {
+			int slot = segments[k] + end;
+			const float* p = &positions[slot * 3];
+			float dx = p[0] - centre[0], dy = p[1] - centre[1], dz = p[2] - centre[2];
+			float d2 = dx * dx + dy * dy + dz * dz;
+			if (d2 <= bestD2) {
+				bestD2 = d2;
+				best = pointIndices[slot];
+			}
+		}
+	}
+	return best;
+}
+
+int vtkStreamlineSpatialIndex::pickRay(const float origin[3], const float dir[3], float radius, float maxT) const {
+	float len = std::sqrt(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+	if (len < 1e-12f) return -1;
+	float d[3] = { dir[0] / len, dir[1] / len, dir[2] / len };
+
+	std::vector<int> candidates;
+	segmentTree.queryRay(origin, d, maxT, radius, candidates);
+
+	int best = -1;
+	float bestT = maxT;
+	for (int k : candidates) {
+		int slot = segments[k];
+		const float* a = &positions[slot * 3];
+		const float* b = singlePoint[k] ? a : &positions[(slot + 1) * 3];
+		// closest approach of the ray o + t d and the segment a + s (b - a)
+		float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float w[3] = { origin[0] - a[0], origin[1] - a[1], origin[2] - a[2] };
+		float uu = u[0] * u[0] + u[1] * u[1] + u[2] * u[2];
+		float du = d[0] * u[0] + d[1] * u[1] + d[2] * u[2];
+		float dw = d[0] * w[0] + d[1] * w[1] + d[2] * w[2];
+		float uw = u[0] * w[0] + u[1] * w[1] + u[2] * w[2];
+		float denom = uu - du * du;
+		float s = (uu > 1e-12f && denom > 1e-12f) ? std::clamp((uw - du * dw) / denom, 0.0f, 1.0f) : 0.0f;
+		float t = std::max(0.0f, du * s - dw);
+		float c[3];
+		for (int i = 0; i < 3; i++) c[i] = origin[i] + d[i] * t - (a[i] + u[i] * s);
+		if (c[0] * c[0] + c[1] * c[1] + c[2] * c[2] > radius * radius || t > bestT) continue;
+		bestT = t;
+		best = pointIndices[(s > 0.5f && !singlePoint[k]) ? slot + 1 : slot];
+	}
+	return best;
+}
+
+size_t vtkStreamlineSpatialIndex::byteSize() const {
+	return positions.size() * sizeof(float) + (pointIndices.size() + segments.size()) * sizeof(int) +
+		singlePoint.size() + chunks.size() * sizeof(chunk) + segmentTree.byteSize() + chunkTree.byteSize();
+}
@@ -0,0 +1,126 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#ifndef VTK_BVH_HPP
+#define VTK_BVH_HPP
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+
+#include "vtkParser.hpp"
+#include "vtkThreadPool.hpp"
+
+struct vtkAABB {
+	float min[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+	float max[3] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+
+	void expand(const float p[3]);
+	void expand(const vtkAABB& box);
+	bool empty() const { return min[0] > max[0]; }
+	float centre(int axis) const { return (min[axis] + max[axis]) * 0.5f; }
+};
+
+// six planes, a point is inside when a x + b y + c z + d >= 0 for all of them
+struct vtkFrustum {
+	float planes[6][4];
+
+	// planes of a column major OpenGL model view projection matrix
+	static vtkFrustum fromMatrix(const float* mvp);
+	// false only when box is entirely outside one plane
+	bool intersects(const vtkAABB& box) const;
+};
+
+/* Ray through normalised device coordinates x, y (each in [-1, 1], y up) from
+ * the near plane to the far plane of a column major model view projection
+ * matrix. dir is unit length and length the distance between the planes.
+ * Returns 0 when mvp can't be inverted.
+ */
+int vtkUnprojectRay(const float* mvp, float x, float y, float origin[3], float dir[3], float& length);
+
+/* Bounding volume hierarchy over a set of boxes (I.E. streamline segments).
+ * Nodes split at the median centroid of their longest axis down to a few
+ * items per leaf. With a pool the subtrees below the top levels are built as
+ * separate tasks and stitched together, the caller must not be one of the
+ * pool's own workers. Queries append the items whose boxes pass the test.
+ */
+class vtkBVH {
+public:
+	void build(const std::vector<vtkAABB>& boxes, vtkThreadPool* pool = nullptr);
+	void clear();
+
+	void queryFrustum(const vtkFrustum& frustum, std::vector<int>& items) const;
+	void querySphere(const float centre[3], float radius, std::vector<int>& items) const;
+	// boxes grown by pad that the ray origin + t * dir hits for t in [0, maxT]
+	void queryRay(const float origin[3], const float dir[3], float maxT, float pad, std::vector<int>& items) const;
+
+	bool empty() const { return nodes.empty(); }
+	size_t itemCount() const { return order.size(); }
+	size_t nodeCount() const { return nodes.size(); }
+	vtkAABB bounds() const { return nodes.empty() ? vtkAABB() : nodes.front().box; }
+	size_t byteSize() const {
+		return nodes.size() * sizeof(node) + order.size() * sizeof(int) + leafBoxes.size() * sizeof(vtkAABB);
+	}
+
+private:
+	struct node {
+		vtkAABB box;
+		int first = 0; // leaf: first slot in order, inner: left child (right is first + 1)
+		int count = 0; // items in a leaf, 0 for inner nodes
+	};
+	std::vector<node> nodes; // nodes[0] is the root
+	std::vector<int> order; // item indices, every leaf owns a contiguous run
+	std::vector<vtkAABB> leafBoxes; // box of order[i], tested one by one inside a leaf
+
+	struct buildContext;
+	struct subtreeTask;
+	// fills out[nodeIndex] from order[begin, end), below depth splitDepth ranges go to deferred when it is set
+	static void buildRange(buildContext& ctx, std::vector<node>& out, int nodeIndex, int begin, int end,
+		int depth, std::vector<subtreeTask>* deferred);
+	// builds the top levels here and the subtrees below them on pool
+	void buildParallel(buildContext& ctx, vtkThreadPool* pool);
+
+	template<typename F>
+	void traverse(F&& hits, std::vector<int>& items) const;
+};
+
+/* Where the streamlines of one timestamp are in world space.
+ * Lines are grouped into chunks of consecutive lines, each roughly
+ * chunkSegments segments, so a renderer can draw only the chunks in view as
+ * index ranges of a mesh built in line order. Segments get their own tree
+ * for radius and ray queries against the individual points.
+ */
+class vtkStreamlineSpatialIndex {
+public:
+	struct chunk {
+		int firstLine, lastLine; // lines [firstLine, lastLine)
+	};
+
+	static std::shared_ptr<vtkStreamlineSpatialIndex> build(vtkParser::openFoamVtkFileData& data,
+		const vtkParser::vtkPolylineIndex& lines, float posScale, int chunkSegments = 256,
+		vtkThreadPool* pool = nullptr);
+
+	// chunks at least partly inside frustum, in line order
+	void visibleChunks(const vtkFrustum& frustum, std::vector<int>& out) const;
+	const std::vector<chunk>& getChunks() const { return chunks; }
+
+	// data point nearest centre (world space) within radius, -1 when there is none
+	int nearestPoint(const float centre[3], float radius) const;
+	// data point at the first place the ray passes within radius of a streamline, -1 for a miss
+	int pickRay(const float origin[3], const float dir[3], float radius, float maxT) const;
+
+	vtkAABB bounds() const { return chunkTree.bounds(); }
+	size_t byteSize() const;
+
+private:
+	std::vector<float> positions; // world x y z of every slot of lines.indices
+	std::vector<int> pointIndices; // slot -> data point index
+	std::vector<int> segments; // segment k joins slot segments[k] and segments[k] + 1 (or itself for one point lines)
+	std::vector<uint8_t> singlePoint; // segment k is a line of one point
+	std::vector<chunk> chunks;
+	vtkBVH segmentTree;
+	vtkBVH chunkTree;
+};
+
+#endif
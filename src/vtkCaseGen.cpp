@@ -0,0 +1,380 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <fmt/format.h>
+
+#include "vtkCaseGen.hpp"
+#include "vtkParser.hpp"
+
+namespace {
+	/* Output file written through one growing text/bytes buffer, handed to
+	 * the file a few MB at a time.
+	 */
+	class caseFile {
+	public:
+		static constexpr size_t FLUSH_BYTES = 1 << 22;
+
+		fmt::memory_buffer buf;
+
+		~caseFile() { close(); }
+
+		bool open(const std::string& path) {
+			file = std::fopen(path.c_str(), "wb");
+			if (file == nullptr) VTKLOG("ERROR:: Failed to create {}", path);
+			ok = (file != nullptr);
+			return ok;
+		}
+		// after every entry, writes the buffer out once it is big enough
+		void next() {
+			if (buf.size() >= FLUSH_BYTES) flush();
+		}
+		void raw(const void* data, size_t bytes) {
+			buf.append((const char*)data, (const char*)data + bytes);
+		}
+		// legacy vtk BINARY is big endian whatever the machine
+		template<typename T>
+		void bigEndian(T value) {
+			char bytes[sizeof(T)];
+			std::memcpy(bytes, &value, sizeof(T));
+			if constexpr (std::endian::native == std::endian::little) std::reverse(bytes, bytes + sizeof(T));
+			raw(bytes, sizeof(T));
+		}
+		int close() {
+			if (file == nullptr) return ok ? 1 : 0;
+			flush();
+			ok = (std::fclose(file) == 0) && ok;
+			file = nullptr;
+			return ok ? 1 : 0;
+		}
+
+	private:
+		FILE* file = nullptr;
+		bool ok = false;
+
+		void flush() {
+			if (file != nullptr && buf.size() > 0 && std::fwrite(buf.data(), 1, buf.size(), file) != buf.size()) ok = false;
+			buf.clear();
+		}
+	};
+
+	template<typename... Args>
+	void put(caseFile& out, const char* format, const Args&... args) {
+		fmt::vformat_to(std::back_inserter(out.buf), format, fmt::make_format_args(args...));
+	}
+
+	// smooth made up values, different per field, component, position and time
+	double fieldValue(int field, int component, double x, double y, double z, int timeIndex) {
+		double phase = 0.7 * field + 1.3 * component + 0.25 * timeIndex;
+		return std::sin(3.0 * x + phase) * std::cos(2.0 * y - phase) + 0.5 * z + 0.1 * field;
+	}
+
+	void foamHeader(caseFile& out, bool binary, const char* className, const char* location, const std::string& object) {
+		put(out, "/*--------------------------------*- C++ -*----------------------------------*\\\n"
+			"  vtkCaseGenerator synthetic case\n"
+			"\\*---------------------------------------------------------------------------*/\n"
+			"FoamFile\n{{\n    version     2.0;\n    format      {};\n"
+			"    arch        \"{};label=32;scalar=64\";\n    class       {};\n"
+			"    location    \"{}\";\n    object      {};\n}}\n"
+			"// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * //\n\n",
+			binary ? "binary" : "ascii", std::endian::native == std::endian::little ? "LSB" : "MSB",
+			className, location, object);
+	}
+
+	/* The hex block: side^3 unit cells over [0,1]^3, point (i,j,k) is
+	 * i + (side+1) * (j + (side+1) * k), cell (i,j,k) likewise with side.
+	 */
+	struct block {
+		int side;
+		int point(int i, int j, int k) const { return i + (side + 1) * (j + (side + 1) * k); }
+		int cell(int i, int j, int k) const { return i + side * (j + side * k); }
+		size_t cellCount() const { return (size_t)side * side * side; }
+		size_t pointCount() const { return (size_t)(side + 1) * (side + 1) * (side + 1); }
+		size_t internalFaces() const { return 3 * (size_t)side * side * (side - 1); }
+		size_t faceCount() const { return internalFaces() + 6 * (size_t)side * side; }
+	};
+
+	/* Every face in polyMesh order with its points, owner and neighbour (-1 on
+	 * the boundary): internal faces by owner then neighbour, then the inlet
+	 * (x = 0), outlet (x = 1) and walls patches. Points go counter clockwise
+	 * seen from the owner, so normals point out of it.
+	 */
+	template<typename F>
+	void forEachFace(const block& b, F&& face) {
+		int n = b.side;
+		for (int k = 0; k < n; k++) {
+			for (int j = 0; j < n; j++) {
+				for (int i = 0; i < n; i++) {
+					int c = b.cell(i, j, k);
+					if (i + 1 < n) face(b.point(i + 1, j, k), b.point(i + 1, j + 1, k), b.point(i + 1, j + 1, k + 1), b.point(i + 1, j, k + 1), c, c + 1);
+					if (j + 1 < n) face(b.point(i, j + 1, k), b.point(i, j + 1, k + 1), b.point(i + 1, j + 1, k + 1), b.point(i + 1, j + 1, k), c, c + n);
+					if (k + 1 < n) face(b.point(i, j, k + 1), b.point(i + 1, j, k + 1), b.point(i + 1, j + 1, k + 1), b.point(i, j + 1, k + 1), c, c + n * n);
+				}
+			}
+		}
+		for (int k = 0; k < n; k++)
+			for (int j = 0; j < n; j++)
+				face(b.point(0, j, k), b.point(0, j, k + 1), b.point(0, j + 1, k + 1), b.point(0, j + 1, k), b.cell(0, j, k), -1);
+		for (int k = 0; k < n; k++)
+			for (int j = 0; j < n; j++)
+				face(b.point(n, j, k), b.point(n, j + 1, k), b.point(n, j + 1, k + 1), b.point(n, j, k + 1), b.cell(n - 1, j, k), -1);
+		for (int k = 0; k < n; k++) {
+			for (int i = 0; i < n; i++) {
+				face(b.point(i, 0, k), b.point(i + 1, 0, k), b.point(i + 1, 0, k + 1), b.point(i, 0, k + 1), b.cell(i, 0, k), -1);
+				face(b.point(i, n, k), b.point(i, n, k + 1), b.point(i + 1, n, k + 1), b.point(i + 1, n, k), b.cell(i, n - 1, k), -1);
+			}
+		}
+		for (int j = 0; j < n; j++) {
+			for (int i = 0; i < n; i++) {
+				face(b.point(i, j, 0), b.point(i, j + 1, 0), b.point(i + 1, j + 1, 0), b.point(i + 1, j, 0), b.cell(i, j, 0), -1);
+				face(b.point(i, j, n), b.point(i + 1, j, n), b.point(i + 1, j + 1, n), b.point(i, j + 1, n), b.cell(i, j, n - 1), -1);
+			}
+		}
+	}
+
+	// N ( ... ) of labels, ascii or raw
+	template<typename F>
+	void labelList(caseFile& out, bool binary, size_t count, F&& label) {
+		put(out, "{}\n(", count);
+		for (size_t i = 0; i < count; i++) {
+			int v = label(i);
+			if (binary) out.raw(&v, sizeof(v));
+			else put(out, "\n{}", v);
+			out.next();
+		}
+		put(out, binary ? ")\n" : "\n)\n");
+	}
+}
+
+int vtkCaseGenerator::blockSide(size_t cells) {
+	int side = (int)std::llround(std::cbrt((double)cells));
+	return std::max(side, 2);
+}
+
+std::vector<vtkCaseGenerator::fieldSpec> vtkCaseGenerator::parseFields(const std::string& list) {
+	std::vector<fieldSpec> fields;
+	size_t start = 0;
+	while (start <= list.size()) {
+		size_t stop = std::min(list.find(',', start), list.size());
+		std::string item = list.substr(start, stop - start);
+		start = stop + 1;
+		if (item.empty()) continue;
+		fieldSpec field;
+		size_t colon = item.find(':');
+		field.name = item.substr(0, colon);
+		field.components = (field.name == "U") ? 3 : 1;
+		if (colon != std::string::npos) field.components = std::atoi(item.c_str() + colon + 1);
+		if (field.name.empty() || (field.components != 1 && field.components != 3)) return {};
+		fields.push_back(field);
+	}
+	return fields;
+}
+
+int vtkCaseGenerator::writeTracks(const options& opts, const std::string& path, int timeIndex) {
+	caseFile out;
+	if (!out.open(path)) return 0;
+	size_t lines = (size_t)std::max(1, opts.streamlines);
+	size_t points = std::max(opts.trackPoints, lines * 2);
+	// line l holds base points, the first (points % lines) one more
+	size_t base = points / lines, extra = points % lines;
+	auto lineLength = [&](size_t l) { return base + (l < extra ? 1 : 0); };
+	int across = (int)std::ceil(std::sqrt((double)lines));
+
+	// seeds spread over the inlet, each line wiggles down the block in x
+	auto position = [&](size_t l, size_t p, float xyz[3]) {
+		double s = (double)p / (double)(lineLength(l) - 1);
+		double y0 = ((double)(l % across) + 0.5) / across, z0 = ((double)(l / across) + 0.5) / across;
+		xyz[0] = (float)s;
+		xyz[1] = (float)(y0 + 0.2 / across * std::sin(12.0 * s + 0.3 * timeIndex + l));
+		xyz[2] = (float)(z0 + 0.2 / across * std::cos(9.0 * s + 0.2 * timeIndex));
+	};
+	auto forEachPoint = [&](auto&& fn) {
+		float xyz[3];
+		for (size_t l = 0; l < lines; l++) {
+			for (size_t p = 0; p < lineLength(l); p++) {
+				position(l, p, xyz);
+				fn(l, p, xyz);
+				out.next();
+			}
+		}
+	};
+
+	put(out, "# vtk DataFile Version 2.0\nvtkCaseGenerator tracks\n{}\nDATASET POLYDATA\nPOINTS {} float\n",
+		opts.binary ? "BINARY" : "ASCII", points);
+	forEachPoint([&](size_t, size_t, const float* xyz) {
+		if (!opts.binary) put(out, "{} {} {}\n", xyz[0], xyz[1], xyz[2]);
+		else for (int c = 0; c < 3; c++) out.bigEndian(xyz[c]);
+	});
+
+	put(out, "{}LINES {} {}\n", opts.binary ? "\n" : "", lines, lines + points);
+	size_t first = 0;
+	for (size_t l = 0; l < lines; l++) {
+		size_t length = lineLength(l);
+		if (!opts.binary) {
+			put(out, "{}", length);
+			for (size_t p = 0; p < length; p++) put(out, " {}", first + p);
+			put(out, "\n");
+		}
+		else {
+			out.bigEndian((int32_t)length);
+			for (size_t p = 0; p < length; p++) out.bigEndian((int32_t)(first + p));
+		}
+		first += length;
+		out.next();
+	}
+
+	// age like the streamline function object writes, then the requested fields
+	put(out, "{}POINT_DATA {}\nFIELD attributes {}\n", opts.binary ? "\n" : "", points, opts.fields.size() + 1);
+	for (int f = -1; f < (int)opts.fields.size(); f++) {
+		int components = (f < 0) ? 1 : opts.fields[f].components;
+		put(out, "{} {} {} float\n", (f < 0) ? "age" : opts.fields[f].name, components, points);
+		forEachPoint([&](size_t l, size_t p, const float* xyz) {
+			for (int c = 0; c < components; c++) {
+				float v = (f < 0) ? (float)p * 0.01f : (float)fieldValue(f, c, xyz[0], xyz[1], xyz[2], timeIndex);
+				if (opts.binary) out.bigEndian(v);
+				else put(out, c == 0 ? "{}" : " {}", v);
+			}
+			if (!opts.binary) put(out, "\n");
+			(void)l;
+		});
+		if (opts.binary) put(out, "\n");
+	}
+	return out.close();
+}
+
+int vtkCaseGenerator::writePolyMesh(const options& opts, const std::string& polyMeshDir) {
+	block b{ blockSide(opts.cells) };
+	int n = b.side;
+	const char* location = "constant/polyMesh";
+
+	caseFile points;
+	if (!points.open(polyMeshDir + "/points")) return 0;
+	foamHeader(points, opts.binary, "vectorField", location, "points");
+	put(points, "{}\n(", b.pointCount());
+	for (int k = 0; k <= n; k++) {
+		for (int j = 0; j <= n; j++) {
+			for (int i = 0; i <= n; i++) {
+				double xyz[3] = { (double)i / n, (double)j / n, (double)k / n };
+				if (opts.binary) points.raw(xyz, sizeof(xyz));
+				else put(points, "\n({} {} {})", xyz[0], xyz[1], xyz[2]);
+				points.next();
+			}
+		}
+	}
+	put(points, opts.binary ? ")\n" : "\n)\n");
+	if (!points.close()) return 0;
+
+	// binary faces are always a faceCompactList, ascii ones a plain faceList
+	caseFile faces;
+	if (!faces.open(polyMeshDir + "/faces")) return 0;
+	foamHeader(faces, opts.binary, opts.binary ? "faceCompactList" : "faceList", location, "faces");
+	if (opts.binary) {
+		labelList(faces, true, b.faceCount() + 1, [](size_t i) { return (int)(i * 4); });
+		put(faces, "\n{}\n(", b.faceCount() * 4);
+		forEachFace(b, [&](int p0, int p1, int p2, int p3, int, int) {
+			int quad[4] = { p0, p1, p2, p3 };
+			faces.raw(quad, sizeof(quad));
+			faces.next();
+		});
+		put(faces, ")\n");
+	}
+	else {
+		put(faces, "{}\n(\n", b.faceCount());
+		forEachFace(b, [&](int p0, int p1, int p2, int p3, int, int) {
+			put(faces, "4({} {} {} {})\n", p0, p1, p2, p3);
+			faces.next();
+		});
+		put(faces, ")\n");
+	}
+	if (!faces.close()) return 0;
+
+	std::vector<int> owner, neighbour;
+	owner.reserve(b.faceCount());
+	neighbour.reserve(b.internalFaces());
+	forEachFace(b, [&](int, int, int, int, int o, int nb) {
+		owner.push_back(o);
+		if (nb >= 0) neighbour.push_back(nb);
+	});
+	for (int which = 0; which < 2; which++) {
+		const std::vector<int>& labels = (which == 0) ? owner : neighbour;
+		const char* name = (which == 0) ? "owner" : "neighbour";
+		caseFile out;
+		if (!out.open(polyMeshDir + "/" + name)) return 0;
+		foamHeader(out, opts.binary, "labelList", location, name);
+		labelList(out, opts.binary, labels.size(), [&labels](size_t i) { return labels[i]; });
+		if (!out.close()) return 0;
+	}
+
+	caseFile boundary;
+	if (!boundary.open(polyMeshDir + "/boundary")) return 0;
+	// always ascii, OpenFOAM writes the boundary dictionary that way too
+	foamHeader(boundary, false, "polyBoundaryMesh", location, "boundary");
+	size_t start = b.internalFaces(), side = (size_t)n * n;
+	put(boundary, "3\n(\n"
+		"    inlet\n    {{\n        type            patch;\n        nFaces          {};\n        startFace       {};\n    }}\n"
+		"    outlet\n    {{\n        type            patch;\n        nFaces          {};\n        startFace       {};\n    }}\n"
+		"    walls\n    {{\n        type            wall;\n        inGroups        List<word> 1(wall);\n"
+		"        nFaces          {};\n        startFace       {};\n    }}\n)\n",
+		side, start, side, start + side, 4 * side, start + 2 * side);
+	return boundary.close();
+}
+
+int vtkCaseGenerator::writeField(const options& opts, const std::string& path, const fieldSpec& field, int timeIndex) {
+	block b{ blockSide(opts.cells) };
+	int n = b.side;
+	bool vector = (field.components == 3);
+	int f = (int)(std::find_if(opts.fields.begin(), opts.fields.end(),
+		[&field](const fieldSpec& s) { return s.name == field.name; }) - opts.fields.begin());
+
+	caseFile out;
+	if (!out.open(path)) return 0;
+	foamHeader(out, opts.binary, vector ? "volVectorField" : "volScalarField", std::to_string(timeIndex).c_str(), field.name);
+	const char* dimensions = (field.name == "p") ? "[0 2 -2 0 0 0 0]" : (field.name == "U") ? "[0 1 -1 0 0 0 0]" : "[0 0 0 0 0 0 0]";
+	put(out, "dimensions      {};\n\ninternalField   nonuniform List<{}> \n{}\n(", dimensions, vector ? "vector" : "scalar", b.cellCount());
+	for (int k = 0; k < n; k++) {
+		for (int j = 0; j < n; j++) {
+			for (int i = 0; i < n; i++) {
+				double v[3];
+				for (int c = 0; c < field.components; c++)
+					v[c] = fieldValue(f, c, (i + 0.5) / n, (j + 0.5) / n, (k + 0.5) / n, timeIndex);
+				if (opts.binary) out.raw(v, sizeof(double) * field.components);
+				else if (vector) put(out, "\n({} {} {})", v[0], v[1], v[2]);
+				else put(out, "\n{}", v[0]);
+				out.next();
+			}
+		}
+	}
+	put(out, opts.binary ? ")\n;\n\n" : "\n)\n;\n\n");
+	put(out, "boundaryField\n{{\n    inlet\n    {{\n        type            fixedValue;\n        value           uniform {};\n    }}\n"
+		"    outlet\n    {{\n        type            zeroGradient;\n    }}\n"
+		"    walls\n    {{\n        type            {};\n    }}\n}}\n",
+		vector ? "(1 0 0)" : "1", vector ? "noSlip" : "zeroGradient");
+	return out.close();
+}
+
+int vtkCaseGenerator::write(const options& opts) {
+	std::error_code err;
+	if (opts.cells > 0) {
+		std::string polyMeshDir = opts.caseDir + "/constant/polyMesh";
+		std::filesystem::create_directories(polyMeshDir, err);
+		if (!writePolyMesh(opts, polyMeshDir)) return 0;
+	}
+	for (int t = 1; t <= opts.timeSteps; t++) {
+		std::string time = std::to_string(t);
+		if (opts.cells > 0) {
+			std::filesystem::create_directories(opts.caseDir + "/" + time, err);
+			for (const fieldSpec& field : opts.fields)
+				if (!writeField(opts, opts.caseDir + "/" + time + "/" + field.name, field, t)) return 0;
+		}
+		if (opts.trackPoints > 0) {
+			std::string dir = opts.caseDir + "/postProcessing/streamlines/" + time;
+			std::filesystem::create_directories(dir, err);
+			if (!writeTracks(opts, dir + "/tracks.vtk", t)) return 0;
+		}
+	}
+	return 1;
+}
@@ -0,0 +1,47 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#ifndef VTK_CASE_GEN_HPP
+#define VTK_CASE_GEN_HPP
+
+#include <vector>
+#include <string>
+
+/* Writes synthetic OpenFOAM cases far bigger than the bundled pitzDailySteady
+ * for scale testing the readers: a block polyMesh, vol fields in every time
+ * directory and postProcessing/streamlines/<time>/tracks.vtk, laid out like a
+ * real case so vtkOFRenderer, vtkBench --case and the gtests all read it.
+ * Everything is generated while it is written, memory use does not grow with
+ * the point or cell counts.
+ */
+class vtkCaseGenerator {
+public:
+	struct fieldSpec {
+		std::string name;
+		int components = 1; // 1 scalar or 3 vector
+	};
+
+	struct options {
+		std::string caseDir;
+		bool binary = false; // BINARY tracks and binary FoamFiles, ascii otherwise
+		int timeSteps = 3; // time directories 1 .. timeSteps
+		size_t trackPoints = 100000; // per tracks file, 0 = no tracks
+		int streamlines = 100; // points are split evenly between them
+		size_t cells = 27000; // roughly, rounded to a cube of hex cells, 0 = no mesh and fields
+		std::vector<fieldSpec> fields = { { "p", 1 }, { "U", 3 }, { "k", 1 } };
+	};
+
+	// 1 on success, a partly written case is left behind on failure
+	static int write(const options& opts);
+	static int writeTracks(const options& opts, const std::string& path, int timeIndex);
+	static int writePolyMesh(const options& opts, const std::string& polyMeshDir);
+	static int writeField(const options& opts, const std::string& path, const fieldSpec& field, int timeIndex);
+
+	/* "p,U:3,k" -> p (1), U (3), k (1). U with no count is a vector, anything
+	 * else a scalar. Empty on a bad entry.
+	 */
+	static std::vector<fieldSpec> parseFields(const std::string& list);
+	// cells per side of the block write() makes for opts.cells
+	static int blockSide(size_t cells);
+};
+
+#endif
@@ -0,0 +1,131 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <utility>
+#include <vector>
+
+#include "vtkDecimate.hpp"
+#include "vtkStreamlineMesh.hpp"
+
+namespace {
+	struct decimateContext {
+		const vtkParser::vtkPointDataset* points;
+		const vtkParser::vtkDataArray* field; // nullptr when only geometry counts
+		double tolerance;
+		double fieldTolerance; // absolute, in field units
+	};
+
+	/* Marks the points of line to keep in keep[0 .. line.size()).
+	 * Iterative Douglas-Peucker, the worst point of a span is measured against
+	 * both tolerances and the span is split there if it exceeds either.
+	 */
+	void simplifyLine(const decimateContext& ctx, vtkParser::vtkLine line, uint8_t* keep,
+		std::vector<std::pair<size_t, size_t> >& spans) {
+
+		size_t n = line.size();
+		if (n == 0) return;
+		keep[0] = keep[n - 1] = 1;
+
+		spans.clear();
+		spans.push_back({ 0, n - 1 });
+		while (!spans.empty()) {
+			auto [a, b] = spans.back();
+			spans.pop_back();
+			if (b - a < 2) continue;
+
+			vtkParser::vtkPoint pa = ctx.points->point(line[a]), pb = ctx.points->point(line[b]);
+			double abx = pb.x - pa.x, aby = pb.y - pa.y, abz = pb.z - pa.z;
+			double len2 = abx * abx + aby * aby + abz * abz;
+			double fa = 0.0, fb = 0.0;
+			if (ctx.field != nullptr) {
+				fa = ctx.field->magnitude(line[a]);
+				fb = ctx.field->magnitude(line[b]);
+			}
+
+			// errors are kept as multiples of their tolerance so the two compare directly
+			size_t worst = 0;
+			double worstErr = 1.0;
+			for (size_t k = a + 1; k < b; k++) {
+				vtkParser::vtkPoint p = ctx.points->point(line[k]);
+				double px = p.x - pa.x, py = p.y - pa.y, pz = p.z - pa.z;
+				double t = (len2 > 0.0) ? std::clamp((px * abx + py * aby + pz * abz) / len2, 0.0, 1.0) : 0.0;
+				double dx = px - abx * t, dy = py - aby * t, dz = pz - abz * t;
+				double err = std::sqrt(dx * dx + dy * dy + dz * dz) / ctx.tolerance;
+				if (ctx.field != nullptr) {
+					double f = ctx.field->magnitude(line[k]);
+					err = std::max(err, std::fabs(f - (fa + (fb - fa) * t)) / ctx.fieldTolerance);
+				}
+				if (err > worstErr) {
+					worstErr = err;
+					worst = k;
+				}
+			}
+			if (worst != 0) {
+				keep[worst] = 1;
+				spans.push_back({ a, worst });
+				spans.push_back({ worst, b });
+			}
+		}
+	}
+}
+
+vtkParser::vtkPolylineIndex vtkPolylineDecimator::decimate(vtkParser::openFoamVtkFileData& data,
+	const options& opts, vtkThreadPool* pool) {
+	VTK_TRACE_ZONE("vtkPolylineDecimator::decimate");
+
+	const vtkParser::vtkPolylineIndex& lines = data.lines;
+	if (opts.tolerance <= 0.0 || lines.empty() || data.points.empty()) return lines;
+
+	decimateContext ctx;
+	ctx.points = &data.points;
+	ctx.tolerance = opts.tolerance;
+	ctx.field = nullptr;
+	ctx.fieldTolerance = 0.0;
+	if (opts.field != nullptr && opts.fieldTolerance > 0.0) {
+		const vtkParser::vtkDataArray* field = vtkParser::getVtkData(data, vtkParser::POINT_DATA, opts.field);
+		if (field != nullptr && field->numTuples == data.points.size) {
+			double lo, hi;
+			vtkFieldMagnitudeRange(*field, lo, hi);
+			if (hi > lo) {
+				ctx.field = field;
+				ctx.fieldTolerance = opts.fieldTolerance * (hi - lo);
+			}
+		}
+	}
+
+	// one flag per CSR slot, every line owns its own range so chunks never overlap
+	std::vector<uint8_t> keep(lines.totalPoints(), 0);
+	auto simplifyRange = [&](size_t first, size_t last) {
+		std::vector<std::pair<size_t, size_t> > spans;
+		for (size_t i = first; i < last; i++)
+			simplifyLine(ctx, lines[i], keep.data() + lines.offsets[i], spans);
+	};
+
+	if (pool == nullptr || pool->size() < 2) {
+		simplifyRange(0, lines.size());
+	}
+	else {
+		size_t chunks = std::min(lines.size(), (size_t)pool->size() * 4);
+		size_t per = (lines.size() + chunks - 1) / chunks;
+		std::vector<std::future<void> > results;
+		for (size_t first = 0; first < lines.size(); first += per) {
+			size_t last = std::min(first + per, lines.size());
+			results.push_back(pool->enqueue([&simplifyRange, first, last]() { simplifyRange(first, last); }));
+		}
+		for (std::future<void>& result : results) result.get();
+	}
+
+	vtkParser::vtkPolylineIndex out;
+	out.offsets.resize(lines.size() + 1);
+	out.indices.reserve(lines.totalPoints());
+	for (size_t i = 0; i < lines.size(); i++) {
+		out.offsets[i] = (int)out.indices.size();
+		for (int j = lines.offsets[i]; j < lines.offsets[i + 1]; j++)
+			if (keep[j]) out.indices.push_back(lines.indices[j]);
+	}
+	out.offsets[lines.size()] = (int)out.indices.size();
+	out.indices.shrink_to_fit();
+	return out;
+}
@@ -0,0 +1,32 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#ifndef VTK_DECIMATE_HPP
+#define VTK_DECIMATE_HPP
+
+#include "vtkParser.hpp"
+#include "vtkThreadPool.hpp"
+
+/* Error bounded streamline simplification.
+ * Each polyline is reduced with Douglas-Peucker: a point is dropped only when
+ * it lies within tolerance of the simplified line, and (when a field is given)
+ * the field's magnitude there is within fieldTolerance of the value
+ * interpolated along it. Straight runs collapse to their ends while bends and
+ * field gradients keep their points. Line ends are always kept.
+ */
+class vtkPolylineDecimator {
+public:
+	struct options {
+		double tolerance = 0.0; // dataset units, 0 keeps every point
+		const char* field = nullptr; // point data array whose magnitude must be preserved
+		double fieldTolerance = 0.0; // fraction of the field's magnitude range
+	};
+
+	/* Simplified copy of data.lines, indices still refer to data.points.
+	 * With a pool the lines are split into chunks that run on it, the caller
+	 * must not be one of the pool's own workers.
+	 */
+	static vtkParser::vtkPolylineIndex decimate(vtkParser::openFoamVtkFileData& data,
+		const options& opts, vtkThreadPool* pool = nullptr);
+};
+
+#endif
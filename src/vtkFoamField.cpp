@@ -0,0 +1,196 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <future>
+
+#include "vtkFoamField.hpp"
+
+namespace {
+	/* uniform v or nonuniform List<type> N(...), up to and including the ';'.
+	 * A patch's "value $internalField;" takes the uniform internal value. Other
+	 * forms (#calc, #codeStream, other macros) are skipped and known is false.
+	 */
+	bool readValue(vtkFoamFile& f, int components, bool& uniform, std::vector<double>& values,
+		bool& known, const vtkFoamField::field* internal = nullptr) {
+		known = true;
+		std::string_view kind = f.word();
+		if (kind == "$internalField" && internal != nullptr && internal->uniform) {
+			uniform = true;
+			values = internal->internal;
+		}
+		else if (kind == "uniform") {
+			uniform = true;
+			values.resize(components);
+			if (!f.entry(values.data(), components)) return false;
+		}
+		else if (kind == "nonuniform") {
+			uniform = false;
+			std::string listType(f.word());
+			int listComponents = vtkFoamField::componentCount(listType);
+			if (listComponents != components) return false;
+			if (!f.scalarList(values, components)) return false;
+		}
+		else {
+			known = false;
+			f.skipEntry();
+			return true;
+		}
+		return f.accept(';');
+	}
+
+	// repeats a uniform value count times, checks a nonuniform one has count entries
+	bool fitValues(std::vector<double>& values, bool& uniform, int components, size_t count) {
+		if (!uniform) return values.size() == count * components;
+		std::vector<double> one(values);
+		values.resize(count * components);
+		for (size_t i = 0; i < count; i++) std::copy(one.begin(), one.end(), values.begin() + i * components);
+		uniform = false;
+		return true;
+	}
+
+	bool readBoundaryField(vtkFoamFile& f, const vtkFoamField::field& out, std::vector<vtkFoamField::patchField>& patches) {
+		if (!f.accept('{')) return false;
+		while (!f.accept('}')) {
+			vtkFoamField::patchField patch;
+			patch.name = f.word();
+			if (patch.name.empty()) return false;
+			if (patch.name[0] == '#') {
+				// #includeEtc "caseDicts/setConstraintTypes", not followed
+				f.word();
+				continue;
+			}
+			if (!f.accept('{')) return false;
+			while (!f.accept('}')) {
+				std::string_view key = f.word();
+				if (key.empty()) return false;
+				if (key == "type") patch.type = f.valueText();
+				else if (key == "value") {
+					if (!readValue(f, out.components, patch.uniform, patch.values, patch.hasValue, &out)) return false;
+					if (!patch.hasValue) patch.values.clear();
+				}
+				else f.skipEntry();
+			}
+			patches.push_back(std::move(patch));
+		}
+		return true;
+	}
+}
+
+size_t vtkFoamField::field::byteSize() const {
+	size_t bytes = internal.size() * sizeof(double);
+	for (const patchField& patch : patches) bytes += patch.values.size() * sizeof(double);
+	return bytes;
+}
+
+int vtkFoamField::componentCount(const std::string& type) {
+	std::string lower(type);
+	std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	if (lower.find("symmtensor") != std::string::npos) return 6;
+	if (lower.find("sphericaltensor") != std::string::npos) return 1;
+	if (lower.find("tensor") != std::string::npos) return 9;
+	if (lower.find("vector") != std::string::npos) return 3;
+	if (lower.find("scalar") != std::string::npos) return 1;
+	return 0;
+}
+
+int vtkFoamField::readField(const std::string& path, field& out, const vtkFoamMesh::polyMesh* mesh) {
+	VTK_TRACE_ZONE("vtkFoamField::readField");
+	vtkFoamFile f;
+	if (!f.open(path)) return 0;
+	out = field{};
+	out.name = f.getHeader().object;
+	out.className = f.getHeader().className;
+	out.components = componentCount(out.className);
+	if (out.components == 0) {
+		VTKLOG("ERROR:: {} is not a field file (class {})", path, out.className);
+		return 0;
+	}
+
+	bool hasInternal = false;
+	while (!f.atEnd()) {
+		std::string_view key = f.word();
+		bool ok = true;
+		if (key.empty()) ok = false;
+		else if (key == "dimensions") out.dimensions = f.valueText();
+		else if (key == "internalField") ok = readValue(f, out.components, out.uniform, out.internal, hasInternal) && hasInternal;
+		else if (key == "boundaryField") ok = readBoundaryField(f, out, out.patches);
+		else if (key[0] == '#') f.word();
+		else f.skipEntry();
+		if (!ok) {
+			VTKLOG("ERROR:: Bad field entry in {} (line {})", path, f.currentLine());
+			return 0;
+		}
+	}
+	if (!hasInternal) {
+		VTKLOG("ERROR:: {} has no internalField", path);
+		return 0;
+	}
+	if (mesh == nullptr) return 1;
+
+	size_t count = out.isSurface() ? mesh->internalFaceCount() :
+		(out.className.rfind("point", 0) == 0) ? mesh->pointCount() : (size_t)mesh->cellCount;
+	if (!fitValues(out.internal, out.uniform, out.components, count)) {
+		VTKLOG("ERROR:: {} holds {} values, the mesh has {}", path, out.size(), count);
+		return 0;
+	}
+	if (out.className.rfind("point", 0) == 0) return 1;
+	for (patchField& patch : out.patches) {
+		if (!patch.hasValue) continue;
+		auto meshPatch = std::find_if(mesh->patches.begin(), mesh->patches.end(),
+			[&patch](const vtkFoamMesh::boundaryPatch& p) { return p.name == patch.name; });
+		// regex patch names ("(inlet|outlet)") stay as written
+		if (meshPatch == mesh->patches.end()) continue;
+		if (!fitValues(patch.values, patch.uniform, out.components, meshPatch->nFaces)) {
+			VTKLOG("ERROR:: Patch {} of {} holds {} values for {} faces", patch.name, path,
+				patch.values.size() / out.components, meshPatch->nFaces);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+std::vector<std::string> vtkFoamField::listFields(const std::string& timeDir) {
+	std::vector<std::string> names;
+	std::error_code err;
+	for (const auto& entry : std::filesystem::directory_iterator(timeDir, err)) {
+		if (!entry.is_regular_file()) continue;
+		vtkFoamFile f;
+		if (!f.open(entry.path().string())) continue;
+		// volScalarField::Internal and other helpers are left out
+		const std::string& cls = f.getHeader().className;
+		bool fieldClass = cls.rfind("vol", 0) == 0 || cls.rfind("surface", 0) == 0 || cls.rfind("point", 0) == 0;
+		if (!fieldClass || cls.size() <= 5 || cls.compare(cls.size() - 5, 5, "Field") != 0) continue;
+		// U.gz is listed as U, readField finds the compressed file on its own
+		std::string name = entry.path().filename().string();
+		if (vtkInflateStream::isCompressed(name)) name.resize(name.size() - 3);
+		names.push_back(name);
+	}
+	std::sort(names.begin(), names.end());
+	names.erase(std::unique(names.begin(), names.end()), names.end());
+	return names;
+}
+
+int vtkFoamField::readTimeSteps(const std::vector<std::string>& timeDirs, const std::vector<std::string>& fieldNames,
+	std::vector<std::vector<field> >& out, const vtkFoamMesh::polyMesh* mesh, vtkThreadPool* pool) {
+	out.assign(timeDirs.size(), std::vector<field>(fieldNames.size()));
+	int ok = 1;
+	if (pool == nullptr || pool->size() < 2) {
+		for (size_t t = 0; t < timeDirs.size(); t++)
+			for (size_t i = 0; i < fieldNames.size(); i++)
+				ok &= readField(timeDirs[t] + "/" + fieldNames[i], out[t][i], mesh);
+		return ok;
+	}
+
+	std::vector<std::future<int> > results;
+	results.reserve(timeDirs.size() * fieldNames.size());
+	for (size_t t = 0; t < timeDirs.size(); t++) {
+		for (size_t i = 0; i < fieldNames.size(); i++) {
+			std::string path = timeDirs[t] + "/" + fieldNames[i];
+			field* target = &out[t][i];
+			results.push_back(pool->enqueue([path, target, mesh]() { return readField(path, *target, mesh); }));
+		}
+	}
+	for (std::future<int>& result : results) ok &= result.get();
+	return ok;
+}
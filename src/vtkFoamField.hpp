@@ -0,0 +1,60 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#ifndef VTK_FOAM_FIELD_HPP
+#define VTK_FOAM_FIELD_HPP
+
+#include <vector>
+#include <string>
+
+#include "vtkFoamMesh.hpp"
+#include "vtkThreadPool.hpp"
+
+/* Reader for the fields OpenFOAM writes into its time directories
+ * (I.E. case/287/U), volume fields on the cells and surface fields on the
+ * internal faces, so the solution can be shown without running foamToVTK.
+ */
+class vtkFoamField {
+public:
+	struct patchField {
+		std::string name;
+		std::string type; // fixedValue, zeroGradient, calculated ...
+		bool hasValue = false; // patches like zeroGradient write no value
+		bool uniform = false; // values holds one entry, expanded when the mesh is known
+		std::vector<double> values;
+	};
+
+	struct field {
+		std::string name; // the FoamFile object, I.E. U
+		std::string className; // volScalarField, volVectorField, surfaceScalarField ...
+		std::string dimensions; // I.E. [0 1 -1 0 0 0 0]
+		int components = 1; // 1 scalar, 3 vector, 6 symmTensor, 9 tensor
+		bool uniform = false; // internal holds one entry, expanded when the mesh is known
+		std::vector<double> internal; // components per cell (or internal face)
+		std::vector<patchField> patches;
+
+		size_t size() const { return internal.size() / components; }
+		bool isSurface() const { return className.rfind("surface", 0) == 0; }
+		size_t byteSize() const;
+	};
+
+	/* Reads one field file. With a mesh, uniform values are expanded to the
+	 * cells / internal faces and patch faces and every size is checked against it.
+	 */
+	static int readField(const std::string& path, field& out, const vtkFoamMesh::polyMesh* mesh = nullptr);
+
+	// names of the vol/surface/point field files in a time directory, sorted
+	static std::vector<std::string> listFields(const std::string& timeDir);
+
+	/* Reads fieldNames from every one of timeDirs (out[time][field], in the
+	 * order given) as one task per file on the pool, the caller must not be one
+	 * of its workers. Without a pool the files are read in turn. Every file is
+	 * read even when one fails, returns 0 if any did.
+	 */
+	static int readTimeSteps(const std::vector<std::string>& timeDirs, const std::vector<std::string>& fieldNames,
+		std::vector<std::vector<field> >& out, const vtkFoamMesh::polyMesh* mesh = nullptr, vtkThreadPool* pool = nullptr);
+
+	// 1 for scalar, 3 for vector ... from a field class or a List<type>, 0 if unknown
+	static int componentCount(const std::string& type);
+};
+
+#endif
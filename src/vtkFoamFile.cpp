@@ -0,0 +1,366 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+
+#include "vtkFoamFile.hpp"
+#include "vtkParser.hpp"
+
+namespace {
+	std::string_view unquote(std::string_view v) {
+		if (v.size() >= 2 && v.front() == '"' && v.back() == '"') return v.substr(1, v.size() - 2);
+		return v;
+	}
+}
+
+int vtkFoamFile::open(const std::string& path) {
+	hdr = header();
+	stream.reset();
+	window = std::vector<char>();
+	mark = nullptr;
+	linesBefore = 0;
+	file.close();
+
+	// writeCompression leaves U.gz where U is expected
+	filePath = path;
+	std::error_code err;
+	if (!vtkInflateStream::isCompressed(path) && !std::filesystem::exists(path, err) &&
+		std::filesystem::exists(path + ".gz", err)) filePath = path + ".gz";
+
+	if (vtkInflateStream::isCompressed(filePath)) {
+		stream = std::make_unique<vtkInflateStream>();
+		if (!stream->open(filePath)) {
+			VTKLOG("ERROR:: Failed to open compressed FoamFile: {}", filePath);
+			stream.reset();
+			return 0;
+		}
+		compressedSize = (size_t)std::filesystem::file_size(filePath, err);
+		begin = cur = end = nullptr;
+		more();
+	}
+	else {
+		if (!file.open(filePath)) {
+			VTKLOG("ERROR:: Failed to open FoamFile: {}", filePath);
+			return 0;
+		}
+		begin = cur = file.data();
+		end = begin + file.size();
+	}
+	if (!readHeader()) {
+		VTKLOG("ERROR:: Bad FoamFile header in {} (line {})", filePath, currentLine());
+		return 0;
+	}
+	return 1;
+}
+
+bool vtkFoamFile::more() {
+	if (stream == nullptr) return false;
+	const char* keep = (mark != nullptr) ? mark : cur;
+	size_t kept = end - keep, curAt = cur - keep, markAt = (mark != nullptr) ? mark - keep : 0;
+	if (begin != nullptr) linesBefore += (size_t)std::count(begin, keep, '\n');
+
+	// what is kept moves to the front, the window only grows for a view longer than a chunk
+	if (kept > 0 && keep != window.data()) std::memmove(window.data(), keep, kept);
+	if (window.size() < kept + WINDOW_CHUNK) window.resize(kept + WINDOW_CHUNK);
+	size_t got = stream->read(window.data() + kept, window.size() - kept);
+
+	begin = window.data();
+	cur = begin + curAt;
+	end = begin + kept + got;
+	if (mark != nullptr) mark = begin + markAt;
+	if (got == 0 && stream->failed()) {
+		VTKLOG("ERROR:: {} is corrupt or cut short (line {})", filePath, currentLine());
+		// what is left in the window is still scanned, then the file just ends
+		stream.reset();
+	}
+	return got > 0;
+}
+
+void vtkFoamFile::skip() {
+	for (;;) {
+		skipSpace();
+		lookahead(2);
+		if (end - cur >= 2 && cur[0] == '/' && cur[1] == '/') {
+			for (;;) {
+				while (cur < end && *cur != '\n') cur++;
+				if (cur < end || !more()) break;
+			}
+			continue;
+		}
+		if (end - cur >= 2 && cur[0] == '/' && cur[1] == '*') {
+			cur += 2;
+			for (;;) {
+				lookahead(2);
+				if (end - cur < 2) {
+					cur = end;
+					break;
+				}
+				if (cur[0] == '*' && cur[1] == '/') {
+					cur += 2;
+					break;
+				}
+				cur++;
+			}
+			continue;
+		}
+		return;
+	}
+}
+
+bool vtkFoamFile::accept(char c) {
+	skip();
+	if (cur < end && *cur == c) {
+		cur++;
+		return true;
+	}
+	return false;
+}
+
+bool vtkFoamFile::atEnd() {
+	skip();
+	return cur >= end;
+}
+
+std::string_view vtkFoamFile::word() {
+	skip();
+	mark = cur;
+	bool quoted = (cur < end && *cur == '"');
+	if (quoted) cur++;
+	for (;;) {
+		if (quoted) {
+			while (cur < end && *cur != '"') cur++;
+			if (cur < end) {
+				cur++;
+				break;
+			}
+		}
+		else {
+			while (cur < end && (unsigned char)*cur > ' ' && !std::strchr(";{}()", *cur)) cur++;
+			if (cur < end) break;
+		}
+		if (!more()) break;
+	}
+	std::string_view ret(mark, cur - mark);
+	mark = nullptr;
+	return ret;
+}
+
+std::string_view vtkFoamFile::valueText() {
+	skipSpace();
+	mark = cur;
+	scanValue();
+	// scanValue stopped past the ';', the view ends before it
+	const char* stop = (cur > mark && *(cur - 1) == ';') ? cur - 1 : cur;
+	while (stop > mark && (unsigned char)*(stop - 1) <= ' ') stop--;
+	std::string_view ret(mark, stop - mark);
+	mark = nullptr;
+	return ret;
+}
+
+void vtkFoamFile::scanValue() {
+	int depth = 0;
+	bool quoted = false;
+	for (;;) {
+		while (cur < end) {
+			char c = *cur++;
+			if (c == '"') quoted = !quoted;
+			else if (!quoted && (c == '(' || c == '{')) depth++;
+			else if (!quoted && (c == ')' || c == '}')) depth--;
+			else if (!quoted && depth <= 0 && c == ';') return;
+		}
+		if (!more()) return;
+	}
+}
+
+void vtkFoamFile::skipEntry() {
+	skip();
+	if (cur >= end || *cur != '{') {
+		// nothing kept, a skipped list can be far bigger than the window
+		scanValue();
+		return;
+	}
+	int depth = 0;
+	bool quoted = false;
+	for (;;) {
+		while (cur < end) {
+			char c = *cur++;
+			if (c == '"') quoted = !quoted;
+			else if (!quoted && c == '{') depth++;
+			else if (!quoted && c == '}' && --depth == 0) return;
+		}
+		if (!more()) return;
+	}
+}
+
+const char* vtkFoamFile::parseScalar(const char* first, double& out) const {
+#if defined __cpp_lib_to_chars
+	auto res = std::from_chars(first, end, out);
+	return res.ec == std::errc() ? res.ptr : nullptr;
+#else
+	// strtod needs a terminated copy since the mapping has no '\0'
+	char tmp[64];
+	size_t len = 0;
+	while (first + len < end && len < sizeof(tmp) - 1 && (unsigned char)first[len] > ' ' && first[len] != ')') {
+		tmp[len] = first[len];
+		len++;
+	}
+	tmp[len] = '\0';
+	char* stop = nullptr;
+	out = std::strtod(tmp, &stop);
+	return (stop == tmp) ? nullptr : first + (stop - tmp);
+#endif
+}
+
+bool vtkFoamFile::readHeader() {
+	skip();
+	lookahead(9);
+	if (end - cur < 9 || std::memcmp(cur, "FoamFile", 8) != 0 ||
+		((unsigned char)cur[8] > ' ' && cur[8] != '{')) {
+		// headerless files are plain ascii data
+		return true;
+	}
+	cur += 8;
+	if (!accept('{')) return false;
+	while (!accept('}')) {
+		std::string_view key = word();
+		if (key.empty()) return false;
+		std::string value(unquote(valueText()));
+		if (key == "format") hdr.format = value;
+		else if (key == "class") hdr.className = value;
+		else if (key == "object") hdr.object = value;
+		else if (key == "arch") {
+			// I.E. "LSB;label=32;scalar=64"
+			bool msb = value.find("MSB") != std::string::npos;
+			hdr.swapBytes = msb != (std::endian::native == std::endian::big);
+			if (value.find("label=64") != std::string::npos) hdr.labelBytes = 8;
+			if (value.find("scalar=32") != std::string::npos) hdr.scalarBytes = 4;
+		}
+	}
+	return true;
+}
+
+bool vtkFoamFile::copyRaw(void* out, size_t bytes) {
+	char* dst = (char*)out;
+	while (bytes > 0) {
+		if (cur == end && !more()) return false;
+		size_t n = std::min(bytes, (size_t)(end - cur));
+		std::memcpy(dst, cur, n);
+		cur += n;
+		dst += n;
+		bytes -= n;
+	}
+	return true;
+}
+
+bool vtkFoamFile::rawLabels(int* out, size_t count) {
+	if (hdr.labelBytes == 4) {
+		if (!copyRaw(out, count * 4)) return false;
+		if (hdr.swapBytes) vtkByteSwap(out, 4, count);
+	}
+	else {
+		std::vector<int64_t> wide(count);
+		if (!copyRaw(wide.data(), count * 8)) return false;
+		if (hdr.swapBytes) vtkByteSwap(wide.data(), 8, count);
+		for (size_t i = 0; i < count; i++) {
+			if (wide[i] < INT32_MIN || wide[i] > INT32_MAX) return false;
+			out[i] = (int)wide[i];
+		}
+	}
+	return true;
+}
+
+bool vtkFoamFile::rawScalars(double* out, size_t count) {
+	if (hdr.scalarBytes == 8) {
+		if (!copyRaw(out, count * 8)) return false;
+		if (hdr.swapBytes) vtkByteSwap(out, 8, count);
+	}
+	else {
+		std::vector<float> narrow(count);
+		if (!copyRaw(narrow.data(), count * 4)) return false;
+		if (hdr.swapBytes) vtkByteSwap(narrow.data(), 4, count);
+		for (size_t i = 0; i < count; i++) out[i] = narrow[i];
+	}
+	return true;
+}
+
+bool vtkFoamFile::listOpen(int& count, bool& uniform) {
+	count = -1;
+	skip();
+	if (!label(count)) count = -1;
+	if (accept('{')) {
+		uniform = true;
+		return count >= 0;
+	}
+	uniform = false;
+	return accept('(');
+}
+
+bool vtkFoamFile::labelList(std::vector<int>& out) {
+	int count;
+	bool uniform;
+	if (!listOpen(count, uniform)) return false;
+	if (uniform) {
+		int v;
+		if (!label(v) || !accept('}')) return false;
+		out.assign(count, v);
+		return true;
+	}
+	// binary data starts right after the '('
+	if (isBinary() && count >= 0) {
+		out.resize(count);
+		return rawLabels(out.data(), count) && accept(')');
+	}
+	if (count >= 0) {
+		out.resize(count);
+		for (int i = 0; i < count; i++)
+			if (!label(out[i])) return false;
+	}
+	else {
+		out.clear();
+		int v;
+		while (label(v)) out.push_back(v);
+	}
+	return accept(')');
+}
+
+bool vtkFoamFile::entry(double* values, int components) {
+	if (components == 1) return scalar(values[0]);
+	if (!accept('(')) return false;
+	for (int c = 0; c < components; c++)
+		if (!scalar(values[c])) return false;
+	return accept(')');
+}
+
+bool vtkFoamFile::scalarList(std::vector<double>& out, int components) {
+	int count;
+	bool uniform;
+	if (!listOpen(count, uniform)) return false;
+
+	if (uniform) {
+		std::vector<double> value(components);
+		if (!entry(value.data(), components) || !accept('}')) return false;
+		out.resize((size_t)count * components);
+		for (int i = 0; i < count; i++) std::copy(value.begin(), value.end(), out.begin() + (size_t)i * components);
+		return true;
+	}
+	if (isBinary() && count >= 0) {
+		out.resize((size_t)count * components);
+		return rawScalars(out.data(), out.size()) && accept(')');
+	}
+	if (count >= 0) {
+		out.resize((size_t)count * components);
+		for (int i = 0; i < count; i++)
+			if (!entry(&out[(size_t)i * components], components)) return false;
+	}
+	else {
+		out.clear();
+		std::vector<double> value(components);
+		while (entry(value.data(), components)) out.insert(out.end(), value.begin(), value.end());
+	}
+	return accept(')');
+}
+
+size_t vtkFoamFile::currentLine() const {
+	return linesBefore + (size_t)std::count(begin, cur, '\n') + 1;
+}
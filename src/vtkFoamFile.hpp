@@ -0,0 +1,142 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#ifndef VTK_FOAM_FILE_HPP
+#define VTK_FOAM_FILE_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cstdint>
+#include <memory>
+
+#include "vtkTokenizer.hpp"
+
+/* One mapped OpenFOAM FoamFile, scanned in place.
+ * open() reads the FoamFile header dictionary, the scanning calls then walk
+ * the data after it. Lists are read as ascii or raw binary depending on the
+ * header's format, numbers are decoded straight from the mapping.
+ * Compressed files (writeCompression on: U.gz) are inflated into a small
+ * window that is refilled as the scan moves, never into one whole buffer.
+ */
+class vtkFoamFile {
+public:
+	struct header {
+		std::string format = "ascii"; // or binary
+		std::string className; // I.E. vectorField, faceList, labelList, volScalarField
+		std::string object;
+		int labelBytes = 4; // binary only, from arch "LSB;label=32;scalar=64"
+		int scalarBytes = 8;
+		bool swapBytes = false; // binary written on a machine of the other byte order
+	};
+
+	// a missing path is retried with .gz appended, the way OpenFOAM looks for files
+	int open(const std::string& path);
+	const header& getHeader() const { return hdr; }
+	bool isBinary() const { return hdr.format == "binary"; }
+	const std::string& getPath() const { return filePath; }
+	// bytes on disk, compressed for .gz files
+	size_t getSize() const { return window.empty() ? file.size() : compressedSize; }
+
+	// whitespace plus // and /* */ comments
+	void skip();
+	// consumes c when it is the next character after skip()
+	bool accept(char c);
+	bool atEnd();
+	/* word up to whitespace or one of ; { } ( ), empty when the next character is
+	 * one of those. A quoted word ("(inlet|outlet)") is returned with its quotes.
+	 * Views into the file (word, valueText) last until the next scanning call.
+	 */
+	std::string_view word();
+	// raw text of a dictionary value up to its ';' (consumed), nested brackets and quotes included
+	std::string_view valueText();
+	// skips one dictionary value or sub dictionary
+	void skipEntry();
+
+	bool label(int& out) {
+		skipBlank();
+		if (stream != nullptr && (size_t)(end - cur) < NUMBER_LOOKAHEAD) lookahead(NUMBER_LOOKAHEAD);
+		// a label past int32 is corrupt (or a label=64 case too big to index), never wrapped
+		int32_t v;
+		auto [p, ec] = std::from_chars(cur, end, v);
+		if (ec != std::errc()) return false;
+		out = v;
+		cur = p;
+		return true;
+	}
+
+	bool scalar(double& out) {
+		skipBlank();
+		if (stream != nullptr && (size_t)(end - cur) < NUMBER_LOOKAHEAD) lookahead(NUMBER_LOOKAHEAD);
+		const char* first = (cur < end && *cur == '+') ? cur + 1 : cur;
+		const char* stop = parseScalar(first, out);
+		if (stop == nullptr) return false;
+		cur = stop;
+		return true;
+	}
+
+	// one list entry, a scalar (components 1) or (x y z ...)
+	bool entry(double* values, int components);
+
+	/* labelList: N(a b c), N{a} (uniform) or (a b c) without a size.
+	 * Binary lists are copied from the raw bytes.
+	 */
+	bool labelList(std::vector<int>& out);
+	/* List of scalars (components 1) or vectors/tensors (I.E. 3: (x y z) per
+	 * entry), flattened into out. Uniform N{...} lists are expanded.
+	 */
+	bool scalarList(std::vector<double>& out, int components);
+
+	// 1 based line of the scan position, for error messages
+	size_t currentLine() const;
+
+private:
+	// inflated bytes fetched per refill, and how far ahead a number has to be in the window
+	static constexpr size_t WINDOW_CHUNK = 1 << 18;
+	static constexpr size_t NUMBER_LOOKAHEAD = 64;
+
+	vtkMappedFile file;
+	const char* begin = nullptr;
+	const char* cur = nullptr;
+	const char* end = nullptr;
+	header hdr;
+	std::string filePath;
+
+	// compressed files only: [begin, end) is a window over the inflated text
+	std::unique_ptr<vtkInflateStream> stream;
+	std::vector<char> window;
+	const char* mark = nullptr; // start of a view being scanned, kept through refills
+	size_t linesBefore = 0; // newlines in text already dropped from the window
+	size_t compressedSize = 0;
+
+	/* Drops what is behind cur (or mark) from the window and inflates more
+	 * after what is left. False when the stream has nothing more.
+	 */
+	bool more();
+	void lookahead(size_t n) {
+		while ((size_t)(end - cur) < n && more());
+	}
+	void skipSpace() {
+		for (;;) {
+			while (cur < end && (unsigned char)*cur <= ' ') cur++;
+			if (cur < end || stream == nullptr || !more()) return;
+		}
+	}
+	// steps over a dictionary value up to its ';' without keeping it
+	void scanValue();
+	// count bytes straight from the file into out, across refills
+	bool copyRaw(void* out, size_t bytes);
+	// skip() kept out of the number loops unless a comment is actually next
+	void skipBlank() {
+		skipSpace();
+		if (cur < end && *cur == '/') skip();
+	}
+	const char* parseScalar(const char* first, double& out) const;
+	bool readHeader();
+	// count values of bytes each copied out of the mapping
+	bool rawLabels(int* out, size_t count);
+	bool rawScalars(double* out, size_t count);
+	bool listOpen(int& count, bool& uniform);
+};
+
+#endif
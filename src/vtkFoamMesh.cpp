@@ -0,0 +1,216 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+#include <algorithm>
+#include <charconv>
+#include <future>
+
+#include "vtkFoamMesh.hpp"
+
+int vtkFoamMesh::readPoints(const std::string& path, std::vector<double>& points) {
+	VTK_TRACE_ZONE("vtkFoamMesh::readPoints");
+	vtkFoamFile f;
+	if (!f.open(path)) return 0;
+	if (!f.scalarList(points, 3)) {
+		VTKLOG("ERROR:: Bad points list in {} (line {})", path, f.currentLine());
+		return 0;
+	}
+	return 1;
+}
+
+int vtkFoamMesh::readFaces(const std::string& path, std::vector<int>& offsets, std::vector<int>& indices) {
+	VTK_TRACE_ZONE("vtkFoamMesh::readFaces");
+	vtkFoamFile f;
+	if (!f.open(path)) return 0;
+
+	// faceCompactList is the offsets list followed by the point indices
+	if (f.getHeader().className == "faceCompactList") {
+		if (!f.labelList(offsets) || !f.labelList(indices)) {
+			VTKLOG("ERROR:: Bad faceCompactList in {} (line {})", path, f.currentLine());
+			return 0;
+		}
+		// face() and buildCells make spans from neighbouring offsets, they have to run 0 .. size
+		if (offsets.empty() || offsets.front() != 0 || offsets.back() != (int)indices.size() ||
+			!std::is_sorted(offsets.begin(), offsets.end())) {
+			VTKLOG("ERROR:: faceCompactList offsets do not match its indices in {}", path);
+			return 0;
+		}
+		return 1;
+	}
+	if (f.isBinary()) {
+		VTKLOG("ERROR:: Binary faces must be a faceCompactList: {}", path);
+		return 0;
+	}
+
+	// faceList: N ( k(a b c ...) ... ), read straight into the CSR arrays
+	int count = 0;
+	if (!f.label(count) || count < 0 || !f.accept('(')) {
+		VTKLOG("ERROR:: Bad faceList in {} (line {})", path, f.currentLine());
+		return 0;
+	}
+	offsets.resize((size_t)count + 1);
+	indices.clear();
+	indices.reserve((size_t)count * 4);
+	offsets[0] = 0;
+	for (int i = 0; i < count; i++) {
+		int size = 0;
+		if (!f.label(size) || size < 0 || !f.accept('(')) {
+			VTKLOG("ERROR:: Bad face {} in {} (line {})", i, path, f.currentLine());
+			return 0;
+		}
+		size_t first = indices.size();
+		indices.resize(first + size);
+		for (int k = 0; k < size; k++) {
+			if (!f.label(indices[first + k])) {
+				VTKLOG("ERROR:: Bad face {} in {} (line {})", i, path, f.currentLine());
+				return 0;
+			}
+		}
+		if (!f.accept(')')) {
+			VTKLOG("ERROR:: Face {} is longer than its size in {} (line {})", i, path, f.currentLine());
+			return 0;
+		}
+		offsets[i + 1] = (int)indices.size();
+	}
+	if (!f.accept(')')) {
+		VTKLOG("ERROR:: faceList in {} has more faces than its size", path);
+		return 0;
+	}
+	return 1;
+}
+
+int vtkFoamMesh::readLabels(const std::string& path, std::vector<int>& labels) {
+	VTK_TRACE_ZONE("vtkFoamMesh::readLabels");
+	vtkFoamFile f;
+	if (!f.open(path)) return 0;
+	if (!f.labelList(labels)) {
+		VTKLOG("ERROR:: Bad labelList in {} (line {})", path, f.currentLine());
+		return 0;
+	}
+	return 1;
+}
+
+int vtkFoamMesh::readBoundary(const std::string& path, std::vector<boundaryPatch>& patches) {
+	vtkFoamFile f;
+	if (!f.open(path)) return 0;
+
+	auto toInt = [](std::string_view text, int& out) {
+		return std::from_chars(text.data(), text.data() + text.size(), out).ec == std::errc();
+	};
+
+	// N ( name { type ..; nFaces ..; startFace ..; } ... )
+	int count = 0;
+	if (!f.label(count)) count = -1;
+	if (!f.accept('(')) {
+		VTKLOG("ERROR:: Bad boundary list in {} (line {})", path, f.currentLine());
+		return 0;
+	}
+	patches.clear();
+	while (!f.accept(')')) {
+		boundaryPatch patch;
+		patch.name = f.word();
+		if (patch.name.empty() || !f.accept('{')) {
+			VTKLOG("ERROR:: Bad boundary patch in {} (line {})", path, f.currentLine());
+			return 0;
+		}
+		while (!f.accept('}')) {
+			std::string_view key = f.word();
+			if (key.empty()) {
+				VTKLOG("ERROR:: Unterminated patch {} in {}", patch.name, path);
+				return 0;
+			}
+			if (key == "type") patch.type = f.valueText();
+			else if (key == "nFaces") {
+				if (!toInt(f.valueText(), patch.nFaces)) return 0;
+			}
+			else if (key == "startFace") {
+				if (!toInt(f.valueText(), patch.startFace)) return 0;
+			}
+			else f.skipEntry();
+		}
+		patches.push_back(std::move(patch));
+	}
+	if (count >= 0 && (size_t)count != patches.size()) {
+		VTKLOG("ERROR:: {} lists {} patches but holds {}", path, count, patches.size());
+		return 0;
+	}
+	return 1;
+}
+
+void vtkFoamMesh::buildCells(polyMesh& mesh) {
+	int maxCell = -1;
+	for (int c : mesh.owner) maxCell = std::max(maxCell, c);
+	for (int c : mesh.neighbour) maxCell = std::max(maxCell, c);
+	mesh.cellCount = maxCell + 1;
+
+	// counting sort, walking faces in order keeps every cell's faces ascending
+	mesh.cellOffsets.assign((size_t)mesh.cellCount + 1, 0);
+	for (int c : mesh.owner) mesh.cellOffsets[c + 1]++;
+	for (int c : mesh.neighbour) mesh.cellOffsets[c + 1]++;
+	for (int c = 0; c < mesh.cellCount; c++) mesh.cellOffsets[c + 1] += mesh.cellOffsets[c];
+
+	std::vector<int> fill(mesh.cellOffsets.begin(), mesh.cellOffsets.end() - 1);
+	mesh.cellFaces.resize(mesh.cellOffsets.back());
+	size_t internal = mesh.neighbour.size();
+	for (size_t i = 0; i < mesh.owner.size(); i++) {
+		mesh.cellFaces[fill[mesh.owner[i]]++] = (int)i;
+		if (i < internal) mesh.cellFaces[fill[mesh.neighbour[i]]++] = (int)i;
+	}
+}
+
+int vtkFoamMesh::readPolyMesh(const std::string& polyMeshDir, polyMesh& mesh, vtkThreadPool* pool) {
+	VTK_TRACE_ZONE("vtkFoamMesh::readPolyMesh");
+	mesh = polyMesh{};
+	std::string dir = polyMeshDir;
+	if (!dir.empty() && dir.back() != '/') dir += '/';
+
+	int ok = 1;
+	if (pool != nullptr && pool->size() > 1) {
+		std::future<int> points = pool->enqueue([&]() { return readPoints(dir + "points", mesh.points); });
+		std::future<int> faces = pool->enqueue([&]() { return readFaces(dir + "faces", mesh.faceOffsets, mesh.faceIndices); });
+		std::future<int> owner = pool->enqueue([&]() { return readLabels(dir + "owner", mesh.owner); });
+		std::future<int> neighbour = pool->enqueue([&]() { return readLabels(dir + "neighbour", mesh.neighbour); });
+		ok &= readBoundary(dir + "boundary", mesh.patches);
+		// wait on all of them, they write into mesh
+		ok &= points.get();
+		ok &= faces.get();
+		ok &= owner.get();
+		ok &= neighbour.get();
+	}
+	else {
+		ok = readPoints(dir + "points", mesh.points) &&
+			readFaces(dir + "faces", mesh.faceOffsets, mesh.faceIndices) &&
+			readLabels(dir + "owner", mesh.owner) &&
+			readLabels(dir + "neighbour", mesh.neighbour) &&
+			readBoundary(dir + "boundary", mesh.patches);
+	}
+	if (!ok) return 0;
+
+	if (mesh.owner.size() != mesh.faceCount() || mesh.neighbour.size() > mesh.faceCount()) {
+		VTKLOG("ERROR:: {} has {} faces, {} owners and {} neighbours", polyMeshDir, mesh.faceCount(),
+			mesh.owner.size(), mesh.neighbour.size());
+		return 0;
+	}
+	int pointCount = (int)mesh.pointCount();
+	for (int p : mesh.faceIndices) {
+		if (p < 0 || p >= pointCount) {
+			VTKLOG("ERROR:: {} references point {} of {}", polyMeshDir, p, pointCount);
+			return 0;
+		}
+	}
+	for (const std::vector<int>* cells : { &mesh.owner, &mesh.neighbour }) {
+		for (int c : *cells) {
+			if (c < 0) {
+				VTKLOG("ERROR:: {} has a negative cell label", polyMeshDir);
+				return 0;
+			}
+		}
+	}
+	for (const boundaryPatch& patch : mesh.patches) {
+		if (patch.startFace < 0 || patch.nFaces < 0 || (size_t)patch.startFace + patch.nFaces > mesh.faceCount()) {
+			VTKLOG("ERROR:: Patch {} of {} is outside the faces", patch.name, polyMeshDir);
+			return 0;
+		}
+	}
+
+	buildCells(mesh);
+	return 1;
+}
@@ -0,0 +1,78 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#ifndef VTK_FOAM_MESH_HPP
+#define VTK_FOAM_MESH_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <span>
+
+#include "vtkParser.hpp"
+#include "vtkThreadPool.hpp"
+#include "vtkFoamFile.hpp"
+
+/* Reader for the native OpenFOAM polyMesh (constant/polyMesh), the cells the
+ * solver ran on rather than the postProcessing output vtkParser reads.
+ * Files are mapped and scanned in place, ascii and binary FoamFiles are both
+ * read, faces as faceList (4(a b c d)) or faceCompactList.
+ */
+class vtkFoamMesh {
+public:
+	struct boundaryPatch {
+		std::string name;
+		std::string type; // patch, wall, empty, symmetryPlane ...
+		int startFace = 0;
+		int nFaces = 0;
+	};
+
+	/* Faces and cells are CSR like vtkPolylineIndex, face i is
+	 * faceIndices[faceOffsets[i] .. faceOffsets[i + 1]) and cell c is
+	 * cellFaces[cellOffsets[c] .. cellOffsets[c + 1]).
+	 */
+	struct polyMesh {
+		std::vector<double> points; // x y z per point
+		std::vector<int> faceOffsets;
+		std::vector<int> faceIndices; // point indices, counter clockwise seen from the owner
+		std::vector<int> owner; // cell on the owner side of every face
+		std::vector<int> neighbour; // other cell of every internal face, internal faces come first
+		std::vector<boundaryPatch> patches;
+
+		int cellCount = 0;
+		std::vector<int> cellOffsets;
+		std::vector<int> cellFaces; // face indices, ascending in every cell
+
+		size_t pointCount() const { return points.size() / 3; }
+		size_t faceCount() const { return faceOffsets.empty() ? 0 : faceOffsets.size() - 1; }
+		size_t internalFaceCount() const { return neighbour.size(); }
+
+		std::span<const int> face(size_t i) const {
+			return std::span<const int>(faceIndices.data() + faceOffsets[i], faceOffsets[i + 1] - faceOffsets[i]);
+		}
+		std::span<const int> cell(size_t c) const {
+			return std::span<const int>(cellFaces.data() + cellOffsets[c], cellOffsets[c + 1] - cellOffsets[c]);
+		}
+		size_t byteSize() const {
+			return points.size() * sizeof(double) + (faceOffsets.size() + faceIndices.size() + owner.size() +
+				neighbour.size() + cellOffsets.size() + cellFaces.size()) * sizeof(int);
+		}
+	};
+
+	/* Reads points, faces, owner, neighbour and boundary from polyMeshDir
+	 * (I.E. case/constant/polyMesh) and builds the cell connectivity. With a
+	 * pool the four big files are read at the same time, the caller must not be
+	 * one of the pool's own workers. Returns 0 and logs why on failure.
+	 */
+	static int readPolyMesh(const std::string& polyMeshDir, polyMesh& mesh, vtkThreadPool* pool = nullptr);
+
+	static int readPoints(const std::string& path, std::vector<double>& points);
+	static int readFaces(const std::string& path, std::vector<int>& offsets, std::vector<int>& indices);
+	// owner, neighbour or any other labelList
+	static int readLabels(const std::string& path, std::vector<int>& labels);
+	static int readBoundary(const std::string& path, std::vector<boundaryPatch>& patches);
+
+	// cellOffsets / cellFaces from owner and neighbour
+	static void buildCells(polyMesh& mesh);
+};
+
+#endif
@@ -0,0 +1,48 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#include "vtkGLShader.hpp"
+#include "vtkParser.hpp"
+
+static GLuint compileShader(GLenum type, const char* source, const char* name) {
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, nullptr);
+	glCompileShader(shader);
+	GLint ok = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+	if (!ok) {
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+		VTKLOG("ERROR:: {} shader failed to compile: {}", name, log);
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+GLuint vtkBuildShaderProgram(const char* vertexSource, const char* fragmentSource, const char* name) {
+	GLuint vs = compileShader(GL_VERTEX_SHADER, vertexSource, name);
+	GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragmentSource, name);
+	if (vs == 0 || fs == 0) {
+		if (vs != 0) glDeleteShader(vs);
+		if (fs != 0) glDeleteShader(fs);
+		return 0;
+	}
+
+	GLuint prog = glCreateProgram();
+	glAttachShader(prog, vs);
+	glAttachShader(prog, fs);
+	glLinkProgram(prog);
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+
+	GLint ok = 0;
+	glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+	if (!ok) {
+		char log[1024];
+		glGetProgramInfoLog(prog, sizeof(log), nullptr, log);
+		VTKLOG("ERROR:: {} shader failed to link: {}", name, log);
+		glDeleteProgram(prog);
+		return 0;
+	}
+	return prog;
+}
@@ -0,0 +1,10 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#pragma once
+
+#include "AftrOpenGLIncludes.h"
+
+/* Compiles and links a vertex + fragment shader pair, 0 on failure with the
+ * GL info log printed. name only labels the log messages.
+ */
+GLuint vtkBuildShaderProgram(const char* vertexSource, const char* fragmentSource, const char* name);
@@ -2,253 +2,506 @@
 
 #include <filesystem>
 #include <functional>
+#include <algorithm>
+#include <climits>
 
 #include "vtkOFRenderer.hpp"
+#include "Mat4.h"
 
 using namespace Aftr;
 
-std::vector<std::string> getDirectoryListing(std::string filePath) {
-	std::vector<std::string> dirs;
-	if(!std::filesystem::is_directory(filePath)) return dirs;
-	for (auto& curDir : std::filesystem::recursive_directory_iterator(filePath)) {
-		if (curDir.is_directory()) dirs.push_back(curDir.path().string());
-	}
-	return dirs;
-}
-
-std::string splitStr(std::string & str, char delim) {
-	int i;
-	for (i = 0; i < str.length(); i++) {
-		if (str.at(i) == delim) {
-			// return the first half of split string and set original to rest of string
-			std::string ret = str.substr(0, i);
-			str = str.substr(i + 1, str.length());
-			return ret;
-		}
-	}
-	return "";
-}
-
-std::vector<std::string> vtkOFRenderer::getOpenFoamTimeStamps(std::vector<std::string> dirs) {
-	std::vector<std::string> ret;
-	for (std::string i : dirs) {
-		while(splitStr(i, '/')!="");
-		if(splitStr(i, '\\') != "") continue;
-		try {
-			if(std::stoi(i)||i=="0") ret.push_back(i);
-		} catch (const std::invalid_argument &e) { continue; }
-	}
-	return ret;
-}
-
 vtkOFRenderer::vtkOFRenderer(std::string openFoamPath) : filePath(openFoamPath) {
+	VTK_TRACE_ZONE("vtkOFRenderer::scanCase");
 	
 	//parser = (vtkParser*)malloc(sizeof(vtkParser*));
 
-	std::vector<std::string> listing = getDirectoryListing(openFoamPath);
-
-	VTKASSERT(!listing.empty(),
+	VTKASSERT(std::filesystem::is_directory(openFoamPath),
 		"ERROR:: Failed to open OPENFOAM test case folder: %s", openFoamPath.c_str());
 
-	timeStamps = getOpenFoamTimeStamps(listing);
+	// in time order and each time once, playback and blending step through them by index
+	timeStamps = vtkListTimeStamps(openFoamPath);
 
 	VTKASSERT(!timeStamps.empty(),
 		"ERROR:: Failed to retrieve OpenFoam case Time Stamps!");
 	
 	if (openFoamPath.at(openFoamPath.length() - 1) != '/') openFoamPath += '/';
 	for (int i = 0; i < timeStamps.size();i++) {
-		std::string fullPath = openFoamPath +
-			"postProcessing/streamlines/" + timeStamps.at(i) + "/tracks.vtk";
+		std::string dir = openFoamPath + "postProcessing/streamlines/" + timeStamps.at(i) + "/";
+		std::string fullPath = dir + "tracks.vtk";
+		// the streamline writer can be set to xml output instead, either one possibly compressed
+		std::error_code err;
+		for (const char* name : { "tracks.vtk", "tracks.vtp", "tracks.vtk.gz", "tracks.vtp.gz" }) {
+			if (std::filesystem::exists(dir + name, err)) {
+				fullPath = dir + name;
+				break;
+			}
+		}
 		tracksFiles.push_back(fullPath);
 		std::cout << fullPath << std::endl;
 	}
 	isReady = false; // will be ready after parser is ran
-	runLoop = false;
+	playback = vtkPlaybackClock((int)timeStamps.size(), PLAYBACK_RATE);
+	interpolate = PLAYBACK_INTERPOLATE;
+	blendFrom = -1;
+	blendFraction = 0.0f;
+	selectedTimeStamp = 0;
+	shownTimeStamp = -1;
+	trackWO = nullptr;
+	trackSeries = nullptr;
+	decimateTolerance = DECIMATE_TOLERANCE;
+	decimateFieldTolerance = DECIMATE_FIELD_TOLERANCE;
+	geometryDirty = false;
+	parsedCount = 0;
+	cancelParsing = false;
+	parseProgress = [](int index, int finished, int total) {
+		VTKLOG("INFO:: Finished parser task {} ({}/{})", index, finished, total);
+	};
 }
 
-void vtkOFRenderer::parseThread(int index) {
-	
-	vtkParser* parser = &threadParsers.at(index);
-	
-	parser->setVtkFile(tracksFiles.at(index));
-	//parser->printVTKFILE();
-	parser->init();
-	parser->parseOpenFoam();
-	tracksFileData.push_back(parser->getOpenFoamData());
-	//parser->dumpOFOAMPolyDataset();
-	parser->freeVtkData();
-
-	threadStates.at(index) = 1;
+vtkOFRenderer::~vtkOFRenderer() {
+	// queued timestamps are dropped, only tasks already running finish
+	cancelParsing = true;
+	parsePool.reset();
 }
 
-int vtkOFRenderer::parseTracksFiles() {
+int vtkOFRenderer::parseThread(int index) {
+	VTK_TRACE_ZONE("vtkOFRenderer::parseThread");
+
+	if (cancelParsing) return 0;
+
+	vtkParser parser;
+	parser.setVtkFile(tracksFiles.at(index));
+	parser.setCache(useParseCache, parseCacheDir);
+	//parser.printVTKFILE();
+	int ok = parser.init() && parser.parseOpenFoam();
+	// each task owns its own slot, no other thread touches index
+	tracksFileData.at(index) = parser.releaseOpenFoamData();
+	//parser.dumpOFOAMPolyDataset();
+	parser.freeVtkData();
+	if (!ok) VTKLOG("ERROR:: Failed to parse: {}", tracksFiles.at(index));
+
+	// published after the slot is written, the render thread may use it from here on
+	timeStampReady.at(index) = 1;
+	int finished = ++parsedCount;
+	if (parseProgress) parseProgress(index, finished, (int)tracksFiles.size());
+	return ok;
+}
 
-	threadStates.resize(tracksFiles.size(), 0);
-	threadParsers.resize(tracksFiles.size());
-	threads.resize(tracksFiles.size());
+void vtkOFRenderer::setParseProgressCallback(parseProgressCallback callback) {
+	parseProgress = callback;
+}
 
-	int i, finished=0;
+// aftr.conf value or fallback when it is missing / not a number
+static size_t configValue(const std::string& name, size_t fallback) {
+	std::string value = ManagerEnvironmentConfiguration::getVariableValue(name);
+	if (value.empty()) return fallback;
+	try { return (size_t)std::stoull(value); }
+	catch (const std::exception&) { return fallback; }
+}
+
+int vtkOFRenderer::parseTracksFiles(bool async) {
+	VTK_TRACE_ZONE("vtkOFRenderer::parseTracksFiles");
+
+	// results land in preallocated slots so timestamp i is always data i
+	tracksFileData.clear();
+	tracksFileData.resize(tracksFiles.size());
+	trackGeometries.clear();
+	trackGeometries.resize(tracksFiles.size());
+	timeStampReady = std::vector<std::atomic<int> >(tracksFiles.size());
+	geometryState = std::vector<std::atomic<int> >(tracksFiles.size());
+	geometryGeneration.assign(tracksFiles.size(), 0);
+	geometryResults.clear();
+	geometryResults.resize(tracksFiles.size());
+	trackLines.clear();
+	trackLines.resize(tracksFiles.size());
+	trackSpatial.clear();
+	trackSpatial.resize(tracksFiles.size());
+	topologyMatch.assign(tracksFiles.size(), -1);
+	blendFrom = -1;
+	parseResults.clear();
+	parsedCount = 0;
+	cancelParsing = false;
+
+	// aftr.conf variable names are lower case unless quoted
+	unsigned threadCount = (unsigned)configValue("vtkparsethreads", PARSE_THREADS);
+	size_t memoryBudget = configValue("vtkparsememorymb", PARSE_MEMORY_MB) * 1024 * 1024;
+	useParseCache = configValue("vtkparsecache", PARSE_CACHE) != 0;
+	parseCacheDir = ManagerEnvironmentConfiguration::getVariableValue("vtkparsecachedir");
+	geometryCache.reset(tracksFiles.size(), configValue("vtkgeometrycachemb", GEOMETRY_CACHE_MB) * 1024 * 1024);
+	if (parsePool == nullptr)
+		parsePool = std::make_unique<vtkThreadPool>(threadCount, memoryBudget);
+	VTKLOG("INFO:: Parsing {} tracks files on {} threads", tracksFiles.size(), parsePool->size());
+
+	// timestamps are queued in order so the first one shown is the first one parsed
+	int i;
 	for (i = 0; i < tracksFiles.size(); i++) {
-		threads.at(i) = std::thread(std::mem_fn(&vtkOFRenderer::parseThread), this, i);
-		VTKLOG("INFO:: Started parser thread for: {}", tracksFiles.at(i));
+		// the mapped (or inflated) file plus the arrays decoded from it is roughly twice its size
+		size_t estimate = vtkInflateStream::sizeHint(tracksFiles.at(i)) * 2;
+		parseResults.push_back(parsePool->enqueue([this, i]() { return parseThread(i); }, estimate));
+		VTKLOG("INFO:: Queued parser task for: {}", tracksFiles.at(i));
 	}
-	
-	while (!finished) {
-		int totalFinished = 0;
-		for (i = 0; i < threadStates.size();i++) {
-			if (threadStates.at(i)) totalFinished++;
-		}
-		if (totalFinished == threadStates.size() - 1) finished = 1;
+	if (async) {
+		// only the first timestamp is needed to start rendering, the rest stream in
+		waitForTimeStamp(0);
 	}
-	for (i = 0; i < tracksFiles.size(); i++) {
-		threads.at(i).join();
-		VTKLOG("INFO:: Finished parser thread for: {}", tracksFiles.at(i));
+	else {
+		for (i = 0; i < parseResults.size(); i++) parseResults.at(i).wait();
 	}
 
 	isReady = true;
-	currentSelectedTimeStamp = timeStamps.at(0).c_str();
-#if PRELOAD_TIMESTAMPS
-	VTKLOG("INFO:: Preloading OpenFOAM timestamps is enables");
-#endif
+	selectedTimeStamp = 0;
+	playback.scrub(0.0);
 	return 0;
 }
 
-void vtkOFRenderer::updateVtkTrackModel(WorldContainer* wl) {
+bool vtkOFRenderer::isTimeStampReady(int index) const {
+	return index >= 0 && index < timeStampReady.size() && timeStampReady.at(index) != 0;
+}
 
-	static int curTime = 0;
-	static size_t pastClock = clock();
-	static size_t curClock = clock();
-
-	static const char* pastTS = currentSelectedTimeStamp;
-	openFoamVtkFileData* pptr = new openFoamVtkFileData;
-	int i = 0;
-
-	if (runLoop) currentSelectedTimeStamp = timeStamps.at(curTime).c_str();
-
-	if (currentSelectedTimeStamp != pastTS) {
-		for (i = 0; i < WOIDS.size(); i++) {
-			WO* tmp = wl->getWOByID(WOIDS.at(i));
-			wl->eraseViaWOptr(tmp);
-#if !PRELOAD_TIMESTAMPS
-			delete tmp;
-#endif
-		}
-		WOIDS.clear();
-		int i = 0;
-		for (i = 0; i < timeStamps.size(); i++) {
-			if (timeStamps.at(i).c_str() == currentSelectedTimeStamp) break;
+int vtkOFRenderer::getParsedCount() const {
+	return parsedCount;
+}
+
+void vtkOFRenderer::waitForTimeStamp(int index) {
+	if (index < 0 || index >= parseResults.size()) return;
+	parseResults.at(index).wait();
+}
+
+void vtkOFRenderer::buildTrackGeometry(int index) {
+	openFoamVtkFileData& data = tracksFileData.at(index);
+
+	vtkPolylineDecimator::options simplify;
+	simplify.tolerance = decimateTolerance / POSMUL; // world units back to case units
+	simplify.field = POINT_COLOUR_FIELD;
+	simplify.fieldTolerance = decimateFieldTolerance;
+	vtkParser::vtkPolylineIndex lines = vtkPolylineDecimator::decimate(data, simplify);
+
+	trackGeometry geometry = buildGeometry(data, lines);
+	// already on a pool worker, the tree is built on this thread
+	geometry.spatial = vtkStreamlineSpatialIndex::build(data, lines, POSMUL, TRACK_CHUNK_SEGMENTS);
+	geometry.lines = std::move(lines);
+	trackGeometries.at(index) = std::move(geometry);
+}
+
+vtkOFRenderer::trackGeometry vtkOFRenderer::buildGeometry(openFoamVtkFileData& data,
+	const vtkParser::vtkPolylineIndex& lines) {
+	VTK_TRACE_ZONE("vtkOFRenderer::buildGeometry");
+
+	trackGeometry geometry;
+	if (TRACK_STYLE == TRACK_POINTS) {
+		// files without LINES still show all of their points
+		geometry.points = MGLvtkPointCloud::buildVertices(data,
+			lines.empty() ? nullptr : &lines, POSMUL, POINT_SIZE, POINT_COLOUR_FIELD);
+	}
+	else {
+		vtkStreamlineMeshBuilder::options opts;
+		opts.style = TRACK_STYLE;
+		opts.radius = STREAMLINE_RADIUS;
+		opts.sides = STREAMLINE_SIDES;
+		opts.posScale = POSMUL;
+		opts.colourField = POINT_COLOUR_FIELD;
+		opts.lines = &lines;
+		geometry.mesh = vtkStreamlineMeshBuilder::build(data, opts);
+	}
+	return geometry;
+}
+
+int vtkOFRenderer::nextGeometryToken(int index) {
+	unsigned generation = ++geometryGeneration.at(index) & (UINT_MAX >> 3);
+	return (int)(generation << 2) | GEOMETRY_QUEUED;
+}
+
+bool vtkOFRenderer::runTrackGeometry(int index, int token) {
+	// the queued task and a render thread that can't wait for it race for the slot, one wins.
+	// A task from an earlier, cancelled request holds a stale token and always loses
+	int expected = token;
+	if (!geometryState.at(index).compare_exchange_strong(expected, GEOMETRY_BUILDING)) return false;
+	if (!cancelParsing) buildTrackGeometry(index);
+	geometryState.at(index) = GEOMETRY_BUILT;
+	return true;
+}
+
+void vtkOFRenderer::requestTrackGeometry(int index) {
+	if (!isTimeStampReady(index) || geometryPhase(index) != GEOMETRY_NONE) return;
+	// only the render thread moves a slot out of GEOMETRY_NONE
+	int token = nextGeometryToken(index);
+	geometryState.at(index) = token;
+	geometryResults.at(index) = parsePool->enqueue([this, index, token]() { runTrackGeometry(index, token); });
+}
+
+void vtkOFRenderer::waitForTrackGeometry(int index) {
+	waitForTimeStamp(index);
+	if (geometryPhase(index) == GEOMETRY_NONE) geometryState.at(index) = nextGeometryToken(index);
+	// a task still queued behind parsing could take a while, so this thread builds it instead
+	int token = geometryState.at(index);
+	if ((token & GEOMETRY_PHASE_MASK) == GEOMETRY_QUEUED && runTrackGeometry(index, token)) return;
+	// only the task holding the current token can be building, that is the last future queued
+	if (geometryPhase(index) == GEOMETRY_BUILDING) geometryResults.at(index).wait();
+}
+
+void vtkOFRenderer::rebuildTrackGeometry() {
+	VTK_TRACE_ZONE("vtkOFRenderer::rebuildTrackGeometry");
+	// queued builds are cancelled, running ones finish before their slots are dropped
+	int i;
+	for (i = 0; i < timeStamps.size(); i++) {
+		int token = geometryState.at(i);
+		if ((token & GEOMETRY_PHASE_MASK) == GEOMETRY_QUEUED) geometryState.at(i).compare_exchange_strong(token, GEOMETRY_NONE);
+		if (geometryPhase(i) == GEOMETRY_BUILDING) geometryResults.at(i).wait();
+	}
+
+	int shown = shownTimeStamp;
+	trackSeries->clear();
+	trackSeries->showBlend(false);
+	blendFrom = -1;
+	geometryCache.clear();
+	for (i = 0; i < timeStamps.size(); i++) {
+		trackGeometries.at(i) = trackGeometry();
+		trackLines.at(i).clear();
+		trackSpatial.at(i).reset();
+		geometryState.at(i) = GEOMETRY_NONE;
+	}
+	// the shown timestamp is rebuilt now, the others as they are prefetched or shown
+	shownTimeStamp = -1;
+	if (shown >= 0) showTimeStamp(shown);
+}
+
+MGL* vtkOFRenderer::buildTimeStampModel(int index) {
+	VTK_TRACE_ZONE("vtkOFRenderer::buildTimeStampModel");
+	// the geometry moves into the model, evicting the model drops the timestamp's geometry
+	trackGeometry geometry = std::move(trackGeometries.at(index));
+	trackGeometries.at(index) = trackGeometry();
+	trackSpatial.at(index) = geometry.spatial;
+	if (TRACK_STYLE == TRACK_POINTS) {
+		MGLvtkPointCloud* cloud = MGLvtkPointCloud::New(trackWO);
+		cloud->setPoints(std::move(geometry.points));
+		// points built without lines have no chunks to draw
+		if (!geometry.lines.empty()) cloud->setSpatialIndex(geometry.spatial, geometry.lines.offsets);
+		trackLines.at(index) = std::move(geometry.lines);
+		return cloud;
+	}
+	MGLvtkStreamlineMesh* streamlines = MGLvtkStreamlineMesh::New(trackWO);
+	streamlines->setMesh(std::move(geometry.mesh));
+	streamlines->setSpatialIndex(geometry.spatial);
+	trackLines.at(index) = std::move(geometry.lines);
+	return streamlines;
+}
+
+void vtkOFRenderer::adoptTrackGeometry(int index) {
+	VTK_TRACE_ZONE("vtkOFRenderer::adoptTrackGeometry");
+	const trackGeometry& geometry = trackGeometries.at(index);
+	size_t bytes = geometry.points.size() * sizeof(vtkPointVertex) + geometry.mesh.byteSize() +
+		(geometry.lines.offsets.size() + geometry.lines.indices.size()) * sizeof(int) +
+		(geometry.spatial != nullptr ? geometry.spatial->byteSize() : 0);
+	trackSeries->setTimeStamp(index, buildTimeStampModel(index));
+	std::vector<int> evicted = geometryCache.insert(index, bytes);
+	for (int victim : evicted) evictTimeStamp(victim);
+}
+
+void vtkOFRenderer::evictTimeStamp(int index) {
+	trackSeries->setTimeStamp(index, nullptr);
+	trackLines.at(index).clear();
+	trackSpatial.at(index).reset();
+	geometryCache.erase(index);
+	geometryState.at(index) = GEOMETRY_NONE;
+}
+
+void vtkOFRenderer::prefetchTimeStamps() {
+	VTK_TRACE_ZONE("vtkOFRenderer::prefetchTimeStamps");
+	int count = (int)timeStamps.size();
+	int i;
+
+	// geometry the workers finished becomes a model, one per frame so a burst doesn't stall a frame
+	for (i = 0; i < count; i++) {
+		if (geometryPhase(i) == GEOMETRY_BUILT && !trackSeries->hasTimeStamp(i)) {
+			adoptTrackGeometry(i);
+			break;
 		}
-		pptr = &tracksFileData.at(i);
-		std::string point(ManagerEnvironmentConfiguration::getSMM() + "/models/planetSunR10.wrl");
-#if !PRELOAD_TIMESTAMPS
-		for (i = 0; i < pptr->points.polyData.size(); i += RENDER_RESOLUTION) {
-			WO* wo = WO::New(point, Vector(POINT_SIZE, POINT_SIZE, POINT_SIZE), MESH_SHADING_TYPE::mstFLAT);
-			wo->setPosition(Vector(
-				pptr->points.polyData.at(i).at(0) * POSMUL,
-				pptr->points.polyData.at(i).at(1) * POSMUL,
-				pptr->points.polyData.at(i).at(2) * POSMUL));
-			wo->renderOrderType = RENDER_ORDER_TYPE::roOPAQUE;
-			std::string id = "point";
-			wo->setLabel(id);
-			wl->push_back(wo);
-			WOIDS.push_back(wo->getID());
+	}
 
+	// the timestamps playback steps to next (and back to) are kept out of eviction with the shown one
+	geometryCache.clearPins();
+	geometryCache.pin(shownTimeStamp, true);
+	std::vector<int> wanted;
+	if (playback.isPlaying() && shownTimeStamp >= 0) {
+		for (i = 1; i < count; i++) {
+			int next = (shownTimeStamp + i) % count;
+			if (isTimeStampReady(next)) {
+				wanted.push_back(next);
+				break;
+			}
 		}
-#else 
-		for (int j = 0; j < preLoadedWOs.at(i).size(); j+=RENDER_RESOLUTION) {
-			WO* tmp = preLoadedWOs.at(i).at(j);
-			wl->push_back(tmp);
-			WOIDS.push_back(tmp->getID());
+		for (i = 1; i < count; i++) {
+			int prev = (shownTimeStamp - i + count) % count;
+			if (isTimeStampReady(prev)) {
+				wanted.push_back(prev);
+				break;
+			}
 		}
-#endif
 	}
-	pastTS = currentSelectedTimeStamp;
-	curClock = clock();
-	if (runLoop) {
-		if (curClock >= pastClock+CLOCKS_PER_SEC) {
-			pastClock = clock();
-			if (curTime <= timeStamps.size()) curTime++;
-			if (curTime == timeStamps.size()) curTime = 0;
+
+	// a neighbour is only built when it fits next to the pinned ones, so playback
+	// never thrashes the cache when the budget holds just the shown timestamp
+	size_t estimate = geometryCache.getCount() > 0 ? geometryCache.getUsedBytes() / geometryCache.getCount() : 0;
+	for (int index : wanted) {
+		if (!geometryCache.contains(index) && !geometryCache.canFit(estimate)) continue;
+		geometryCache.pin(index, true);
+		geometryCache.touch(index);
+		requestTrackGeometry(index);
+	}
+
+	// one more timestamp at a time while there is room without evicting anything
+	for (i = 0; i < count; i++) {
+		if (geometryPhase(i) == GEOMETRY_QUEUED || geometryPhase(i) == GEOMETRY_BUILDING) return;
+	}
+	size_t budget = geometryCache.getBudget();
+	if (budget != 0 && geometryCache.getUsedBytes() + estimate > budget) return;
+	for (i = 0; i < count; i++) {
+		if (geometryPhase(i) == GEOMETRY_NONE && isTimeStampReady(i)) {
+			requestTrackGeometry(i);
+			return;
 		}
 	}
 }
 
-WO *vtkOFRenderer::renderTimeStampTrack(WorldContainer *worldList) {
-	//WO* wo = WO::New();
-	
-	VTKASSERT(currentSelectedTimeStamp != NULL, 
-		"ERROR:: Uninitialized vtk timestamps!");
-
-	static const char* pastTS;
-	openFoamVtkFileData* pptr = new openFoamVtkFileData;
+void vtkOFRenderer::showTimeStamp(int index) {
+	VTK_TRACE_ZONE("vtkOFRenderer::showTimeStamp");
+	if (!trackSeries->hasTimeStamp(index)) {
+		waitForTrackGeometry(index);
+		geometryCache.pin(index, true);
+		adoptTrackGeometry(index);
+	}
+	geometryCache.pin(shownTimeStamp, false);
+	geometryCache.pin(index, true);
+	geometryCache.touch(index);
+	trackSeries->show(index);
+	shownTimeStamp = index;
+	// the probed point belonged to the old timestamp
+	probe.timeStamp = -1;
+}
 
-	int tloc;
-	int i = 0,j;
-	for (i = 0; i < timeStamps.size(); i++) {
-		if (timeStamps.at(i).c_str() == currentSelectedTimeStamp) break;
+bool vtkOFRenderer::showBlend(int index, float fraction) {
+	VTK_TRACE_ZONE("vtkOFRenderer::showBlend");
+	int next = index + 1;
+	if (next >= timeStamps.size() || !isTimeStampReady(next)) return false;
+	// the shown timestamp's lines are what the blend is drawn along
+	if (!trackSeries->hasTimeStamp(index)) return false;
+	if (trackLines.at(index).empty() && !tracksFileData.at(index).lines.empty()) return false;
+
+	if (topologyMatch.at(index) < 0)
+		topologyMatch.at(index) = vtkSameTopology(tracksFileData.at(index), tracksFileData.at(next)) ? 1 : 0;
+	if (topologyMatch.at(index) == 0) return false;
+
+	// paused on a fraction the last blend still holds
+	if (blendFrom == index && blendFraction == fraction) return true;
+
+	// the blend model is made once and refilled every frame
+	if (trackSeries->getBlend() == nullptr) {
+		if (TRACK_STYLE == TRACK_POINTS) trackSeries->setBlend(MGLvtkPointCloud::New(trackWO));
+		else trackSeries->setBlend(MGLvtkStreamlineMesh::New(trackWO));
 	}
-	pptr = &tracksFileData.at(i);
-	tloc = i;
-#if PRELOAD_TIMESTAMPS
-		preLoadedWOs = std::vector<std::vector<WO*> >{};
-		preLoadedWOs.resize(timeStamps.size());
-		for (i = 0; i < preLoadedWOs.size(); i++) {
-			pptr = &tracksFileData.at(i);
-			preLoadedWOs.at(i).resize(pptr->points.polyData.size());
+
+	// a new pair: both ends built along the same lines share one topology, the mesh's indices go up once
+	if (blendFrom != index) {
+		blendStart = buildGeometry(tracksFileData.at(index), trackLines.at(index));
+		blendEnd = buildGeometry(tracksFileData.at(next), trackLines.at(index));
+		blendFrom = -1;
+		if (TRACK_STYLE != TRACK_POINTS) {
+			vtkStreamlineMesh topology = blendStart.mesh;
+			static_cast<MGLvtkStreamlineMesh*>(trackSeries->getBlend())->setMesh(std::move(topology));
 		}
-		pptr = &tracksFileData.at(tloc);
-#endif
-
-	std::string point(ManagerEnvironmentConfiguration::getSMM() + "/models/planetSunR10.wrl");
-	for (i = 0; i < pptr->points.polyData.size();i+=RENDER_RESOLUTION) {
-#if !PRELOAD_TIMESTAMPS
-		WO* wo = WO::New(point, Vector(POINT_SIZE, POINT_SIZE, POINT_SIZE), MESH_SHADING_TYPE::mstFLAT);
-		wo->setPosition(Vector(
-			pptr->points.polyData.at(i).at(0)*POSMUL, 
-			pptr->points.polyData.at(i).at(1)*POSMUL, 
-			pptr->points.polyData.at(i).at(2)*POSMUL));
-		wo->renderOrderType = RENDER_ORDER_TYPE::roOPAQUE;
-		std::string id = "point";
-		wo->setLabel(id);
-		worldList->push_back(wo);
-		WOIDS.push_back(wo->getID());
-#else 
-		preLoadedWOs.at(tloc).at(i) = WO::New(point, Vector(POINT_SIZE, POINT_SIZE, POINT_SIZE), MESH_SHADING_TYPE::mstFLAT);
-		preLoadedWOs.at(tloc).at(i)->setPosition(Vector(
-			pptr->points.polyData.at(i).at(0) * POSMUL,
-			pptr->points.polyData.at(i).at(1) * POSMUL,
-			pptr->points.polyData.at(i).at(2) * POSMUL));
-		preLoadedWOs.at(tloc).at(i)->renderOrderType = RENDER_ORDER_TYPE::roOPAQUE;
-		std::string id = "point";
-		preLoadedWOs.at(tloc).at(i)->setLabel(id);
-		worldList->push_back(preLoadedWOs.at(tloc).at(i));
-		WOIDS.push_back(preLoadedWOs.at(tloc).at(i)->getID());
-#endif
 	}
 
-// load up rest of object into memory
-#if PRELOAD_TIMESTAMPS
-	for (i=1; i < timeStamps.size();i++) {
-		pptr = &tracksFileData.at(i);
-		for (j = 0;j< pptr->points.polyData.size(); j += RENDER_RESOLUTION) {
-			preLoadedWOs.at(i).at(j) = WO::New(point, Vector(POINT_SIZE, POINT_SIZE, POINT_SIZE), MESH_SHADING_TYPE::mstFLAT);
-			preLoadedWOs.at(i).at(j)->setPosition(Vector(
-				pptr->points.polyData.at(j).at(0) * POSMUL,
-				pptr->points.polyData.at(j).at(1) * POSMUL,
-				pptr->points.polyData.at(j).at(2) * POSMUL));
-			preLoadedWOs.at(i).at(j)->renderOrderType = RENDER_ORDER_TYPE::roOPAQUE;
-			std::string id = "point";
-			preLoadedWOs.at(i).at(j)->setLabel(id);
-			//preLoadedWOs.at(i).push_back(wo);
+	if (TRACK_STYLE == TRACK_POINTS) {
+		const std::vector<vtkPointVertex>& a = blendStart.points;
+		const std::vector<vtkPointVertex>& b = blendEnd.points;
+		if (a.size() != b.size()) return false;
+		std::vector<vtkPointVertex> points(a.size());
+		for (size_t i = 0; i < points.size(); i++) {
+			vtkLerp(&a[i].x, &b[i].x, fraction, &points[i].x, 4); // x y z size
+			for (int c = 0; c < 4; c++)
+				points[i].rgba[c] = (uint8_t)(a[i].rgba[c] + (b[i].rgba[c] - a[i].rgba[c]) * fraction + 0.5f);
 		}
+		static_cast<MGLvtkPointCloud*>(trackSeries->getBlend())->setPoints(std::move(points));
+	}
+	else {
+		if (!vtkLerpMeshVertices(blendStart.mesh, blendEnd.mesh, fraction, blendFrame.mesh)) return false;
+		static_cast<MGLvtkStreamlineMesh*>(trackSeries->getBlend())->setVertices(blendFrame.mesh);
 	}
-#endif
 
-	pastTS = currentSelectedTimeStamp;
+	blendFrom = index;
+	blendFraction = fraction;
+	return true;
+}
+
+void vtkOFRenderer::updateVtkTrackModel(WorldContainer* wl) {
+	VTK_TRACE_ZONE("vtkOFRenderer::updateVtkTrackModel");
+
+	if (trackSeries == nullptr) return; // renderTimeStampTrack hasn't run yet
+
+	if (geometryDirty) {
+		geometryDirty = false;
+		rebuildTrackGeometry();
+	}
+
+	playback.update();
+	// playback waits on the shown timestamp until the one it reached has been parsed
+	if (!isTimeStampReady(playback.getIndex())) playback.scrub(shownTimeStamp >= 0 ? shownTimeStamp : selectedTimeStamp);
+	selectedTimeStamp = playback.getIndex();
+	if (selectedTimeStamp != shownTimeStamp) showTimeStamp(selectedTimeStamp);
 
-	return nullptr;
+	float fraction = playback.getFraction();
+	trackSeries->showBlend(interpolate && fraction > 0.0f && showBlend(selectedTimeStamp, fraction));
+
+	prefetchTimeStamps();
 }
 
+WO *vtkOFRenderer::renderTimeStampTrack(WorldContainer *worldList) {
+	VTK_TRACE_ZONE("vtkOFRenderer::renderTimeStampTrack");
+	
+	VTKASSERT(selectedTimeStamp >= 0 && selectedTimeStamp < timeStamps.size(),
+		"ERROR:: Uninitialized vtk timestamps!");
+
+	trackWO = WO::New();
+	trackSeries = MGLvtkTimeSeries::New(trackWO, timeStamps.size());
+	trackWO->setModel(trackSeries);
+	trackWO->renderOrderType = RENDER_ORDER_TYPE::roOPAQUE;
+	std::string id = "tracks";
+	trackWO->setLabel(id);
+	worldList->push_back(trackWO);
+
+	// the rest are built by updateVtkTrackModel as they are prefetched or shown
+	showTimeStamp(selectedTimeStamp);
+
+	return trackWO;
+}
+
+
+void vtkOFRenderer::probeTracks(const Camera& cam, int x, int y, int width, int height) {
+	VTK_TRACE_ZONE("vtkOFRenderer::probeTracks");
+	probe.timeStamp = -1;
+	if (width <= 0 || height <= 0 || shownTimeStamp < 0) return;
+	const std::shared_ptr<const vtkStreamlineSpatialIndex>& spatial = trackSpatial.at(shownTimeStamp);
+	if (spatial == nullptr) return;
+
+	// the segment tree answers the ray directly, no pass over the points
+	Mat4 mvp = cam.getCameraProjectionMatrix() * cam.getCameraViewMatrix();
+	float origin[3], dir[3], length;
+	if (!vtkUnprojectRay(mvp.getPtr(), 2.0f * x / width - 1.0f, 1.0f - 2.0f * y / height, origin, dir, length)) return;
+	int point = spatial->pickRay(origin, dir, PROBE_RADIUS, length);
+	if (point < 0) return;
+
+	openFoamVtkFileData& data = tracksFileData.at(shownTimeStamp);
+	probe.timeStamp = shownTimeStamp;
+	probe.point = point;
+	probe.position = data.points.point(point);
+	probe.values.clear();
+	for (const char* name : PROBE_FIELDS) {
+		const vtkDataArray* field = getVtkData(data, POINT_DATA, name);
+		if (field == nullptr || point >= field->numTuples) continue;
+		if (field->numComponents == 1) probe.values.push_back({ name, field->value(point) });
+		else probe.values.push_back({ fmt::format("|{}|", name), field->magnitude(point) });
+	}
+}
 
 /*This must be ran in already initialized WOImGui istance*/
 void vtkOFRenderer::renderImGuivtkSettings() {
@@ -257,23 +510,112 @@ void vtkOFRenderer::renderImGuivtkSettings() {
 	static int curTime = 0;
 	static const char* curItem = timeStamps.at(0).c_str();
 
-	ImGui::SetNextWindowSize(ImVec2(400, 200));
+	ImGui::SetNextWindowSize(ImVec2(400, 420));
 	if (ImGui::Begin("Vtk View", NULL)) {
 
+		int parsed = getParsedCount();
+		if (parsed < timeStamps.size()) {
+			// background parsing still running
+			std::string progress = fmt::format("Loading timestamps {}/{}", parsed, timeStamps.size());
+			ImGui::ProgressBar((float)parsed / timeStamps.size(), ImVec2(-1.0f, 0.0f), progress.c_str());
+		}
+
 		ImGui::Text("Select a timestamp to view");
-		if (ImGui::BeginCombo("TimeStamps", currentSelectedTimeStamp)) {
+		if (ImGui::BeginCombo("TimeStamps", timeStamps.at(selectedTimeStamp).c_str())) {
 			for (int n = 0; n < timeStamps.size(); n++)
 			{
-				bool is_selected = (currentSelectedTimeStamp == timeStamps.at(n).c_str());
+				bool is_selected = (selectedTimeStamp == n);
+				// timestamps still parsing are greyed out until they are ready
+				ImGui::BeginDisabled(!isTimeStampReady(n));
 				if (ImGui::Selectable(timeStamps.at(n).c_str(), is_selected))
-					currentSelectedTimeStamp = timeStamps.at(n).c_str();
+					playback.scrub(n);
+				ImGui::EndDisabled();
 					if (is_selected)
 						ImGui::SetItemDefaultFocus(); 
 			}
 			ImGui::EndCombo();
 		}
 
-		ImGui::Checkbox("Play timeStamps", &runLoop);
+		bool playing = playback.isPlaying();
+		if (ImGui::Checkbox("Play timeStamps", &playing)) {
+			if (playing) playback.play();
+			else playback.pause();
+		}
+		ImGui::SameLine();
+		if (ImGui::ArrowButton("##stepBack", ImGuiDir_Left)) playback.step(-1);
+		ImGui::SameLine();
+		if (ImGui::ArrowButton("##stepForward", ImGuiDir_Right)) playback.step(1);
+		ImGui::SameLine();
+		ImGui::Checkbox("Interpolate", &interpolate);
+
+		// scrubbing lands between timestamps too, the blended frame shows there
+		float position = (float)playback.getPosition();
+		if (ImGui::SliderFloat("Time", &position, 0.0f, (float)(timeStamps.size() - 1), "%.2f"))
+			playback.scrub(position);
+		float rate = (float)playback.getRate();
+		if (ImGui::SliderFloat("Rate", &rate, -10.0f, 10.0f, "%.2f timestamps/s"))
+			playback.setRate(rate);
+
+		size_t budget = geometryCache.getBudget();
+		std::string cached = fmt::format("Cached {}/{} timestamps, {:.1f}/{} MB", geometryCache.getCount(),
+			timeStamps.size(), geometryCache.getUsedBytes() / (1024.0 * 1024.0),
+			budget == 0 ? std::string("unlimited") : std::to_string(budget / (1024 * 1024)));
+		ImGui::Text("%s", cached.c_str());
+
+		// geometry is rebuilt once a slider is released, not on every drag step,
+		// and only after background parsing is done so every timestamp matches
+		ImGui::Text("Streamline simplification");
+		ImGui::BeginDisabled(parsed < timeStamps.size());
+		float tolerance = decimateTolerance;
+		if (ImGui::SliderFloat("Distance", &tolerance, 0.0f, 0.5f, "%.3f")) decimateTolerance = tolerance;
+		if (ImGui::IsItemDeactivatedAfterEdit()) geometryDirty = true;
+		float fieldTolerance = decimateFieldTolerance;
+		if (ImGui::SliderFloat("|U| fraction", &fieldTolerance, 0.0f, 0.25f, "%.3f")) decimateFieldTolerance = fieldTolerance;
+		if (ImGui::IsItemDeactivatedAfterEdit()) geometryDirty = true;
+		ImGui::EndDisabled();
+
+		ImGui::Text("Probe");
+		if (probe.timeStamp >= 0) {
+			std::string at = fmt::format("Point {} of {} at ({:.4g}, {:.4g}, {:.4g})", probe.point,
+				timeStamps.at(probe.timeStamp), probe.position.x, probe.position.y, probe.position.z);
+			ImGui::Text("%s", at.c_str());
+			for (const std::pair<std::string, double>& value : probe.values)
+				ImGui::Text("%s = %.6g", value.first.c_str(), value.second);
+		}
+		else {
+			ImGui::Text("Hover a streamline to read its point data");
+		}
+
+		if (vtkTrace::compiledIn && ImGui::CollapsingHeader("Trace")) {
+			bool recording = vtkTrace::isEnabled();
+			if (ImGui::Checkbox("Record", &recording)) vtkTrace::setEnabled(recording);
+			ImGui::SameLine();
+			if (ImGui::Button("Save " TRACE_FILE)) vtkTrace::writeChromeTrace(TRACE_FILE);
+			ImGui::SameLine();
+			if (ImGui::Button("Clear")) vtkTrace::clear();
+
+			vtkTrace::frameSummary frame = vtkTrace::lastFrame();
+			ImGui::Text("Last frame %.2f ms", frame.frameMs);
+			if (ImGui::BeginTable("traceZones", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+				ImGui::TableSetupColumn("Zone");
+				ImGui::TableSetupColumn("Calls");
+				ImGui::TableSetupColumn("Total ms");
+				ImGui::TableSetupColumn("Max ms");
+				ImGui::TableHeadersRow();
+				for (const vtkTrace::zoneStat& zone : frame.zones) {
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", zone.name);
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", zone.calls);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", zone.totalMs);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", zone.maxMs);
+				}
+				ImGui::EndTable();
+			}
+		}
 
 	}
 	ImGui::End();
@@ -2,12 +2,16 @@
 
   NOTE: vtkOFRenderer is a library strictly made for the AfterBurner engine
 		BUT some functionality can be used in whatever you are making
-		EX: getOpenFoamTimeStamps().
+		EX: vtkListTimeStamps() in vtkPlayback.
 */
 
 #pragma once
 
 #include <thread>
+#include <memory>
+#include <atomic>
+#include <future>
+#include <functional>
 #include "GLViewNewModule.h"
 
 #include "WorldList.h"
@@ -24,21 +28,92 @@
 #include "IndexedGeometryTriangles.h"
 
 #include "vtkParser.hpp"
+#include "vtkThreadPool.hpp"
+#include "vtkPointCloud.hpp"
+#include "vtkStreamlineMGL.hpp"
+#include "vtkDecimate.hpp"
+#include "vtkTimeSeriesMGL.hpp"
+#include "vtkTimeStampCache.hpp"
+#include "vtkPlayback.hpp"
+#include "vtkBVH.hpp"
 
 using namespace Aftr;
 
-// This determines how many points to skip each iteration while rendering the model to save ram and cpu/gpu usage
-#define RENDER_RESOLUTION 6
-// l,w,h size of rendered points
-#define POINT_SIZE 0.01
+/*
+*  Streamlines are simplified before they are drawn. A point is only dropped when it lies within
+*  DECIMATE_TOLERANCE world units of the simplified line and its |U| is within DECIMATE_FIELD_TOLERANCE
+*  (fraction of the timestamp's |U| range) of the value interpolated along it. A distance of 0 keeps
+*  every point, a |U| fraction of 0 only checks the distance. Both can be changed at runtime in the
+*  "Vtk View" window.
+*/
+#define DECIMATE_TOLERANCE 0.02f
+#define DECIMATE_FIELD_TOLERANCE 0.02f
+// on screen size of rendered points in pixels
+#define POINT_SIZE 4.0f
+// point data array whose magnitude colours the points
+#define POINT_COLOUR_FIELD "U"
+
+/*
+*  How a timestamp is drawn. TRACK_POINTS draws the parsed points, the vtkStreamlineMeshBuilder
+*  styles (STYLE_LINES, STYLE_RIBBON, STYLE_TUBE) build one mesh of every streamline on the parser threads.
+*/
+#define TRACK_POINTS -1
+#define TRACK_STYLE vtkStreamlineMeshBuilder::STYLE_TUBE
+// tube radius / ribbon half width in world units and facets around a tube
+#define STREAMLINE_RADIUS 0.05f
+#define STREAMLINE_SIDES 6
+/*
+*  Each timestamp's lines are grouped into chunks of about TRACK_CHUNK_SEGMENTS segments with a bounding
+*  volume hierarchy over them, only the chunks inside the view frustum are drawn.
+*/
+#define TRACK_CHUNK_SEGMENTS 256
+
+/*
+*  Hovering the view probes the streamline point under the mouse: a streamline is hit when the mouse ray passes
+*  within PROBE_RADIUS world units of it, and the PROBE_FIELDS point data (vectors as their magnitude) at the
+*  nearest point is shown in the "Vtk View" window.
+*/
+#define PROBE_RADIUS 0.25f
+#define PROBE_FIELDS { "p", "k", "U", "age" }
+/*
+*  Built with VTK_ENABLE_TRACE the "Vtk View" window lists the last frame's VTK_TRACE_ZONEs and saves
+*  everything recorded so far to TRACE_FILE (chrome://tracing or ui.perfetto.dev).
+*/
+#define TRACE_FILE "vtkTrace.json"
 // position scaling from those super tiny values
 #define POSMUL 80
 
-/* 
-*  loads all WO models for every time stamp to speed up loading time.
-*  Warning: When enabled this loads ALL objects, it WILL use a lot of RAM be carful on low-end systems.
+/*
+*  Render ready geometry is kept for the most recently shown timestamps, up to GEOMETRY_CACHE_MB.
+*  Older ones are dropped least recently used first and rebuilt from the parsed data when shown again.
+*  While "Play timeStamps" runs the next and previous timestamps are built ahead on the parser threads,
+*  idle cache space is filled with the timestamps not built yet.
+*  vtkGeometryCacheMB=<mb>  overrides it in aftr.conf (0 = unlimited, every timestamp stays resident)
+*/
+#define GEOMETRY_CACHE_MB 1024
+
+/*
+*  "Play timeStamps" advances PLAYBACK_RATE timestamps per second of wall time. With PLAYBACK_INTERPOLATE
+*  the points and POINT_COLOUR_FIELD of neighbouring timestamps are blended every frame so playback and
+*  scrubbing animate smoothly, timestamps whose points or lines differ still switch in one step.
+*/
+#define PLAYBACK_RATE 1.0
+#define PLAYBACK_INTERPOLATE true
+
+/*
+*  tracks.vtk parsing runs on a fixed pool of worker threads. Both can be overridden in aftr.conf:
+*  vtkParseThreads=<n>    (0 = one per hardware thread)
+*  vtkParseMemoryMB=<mb>  (0 = unlimited) cap on the memory held by parse tasks running at once
 */
-#define PRELOAD_TIMESTAMPS true
+#define PARSE_THREADS 0
+#define PARSE_MEMORY_MB 2048
+
+/*
+*  Parsed tracks are kept in a binary .vtkcache sidecar, later runs map it instead of parsing.
+*  vtkParseCache=<0|1>       turns it off/on
+*  vtkParseCacheDir=<path>   keeps every cache in one directory instead of next to each tracks.vtk
+*/
+#define PARSE_CACHE 1
 
 /*The constructor NEEDS to be initialized
    BEFORE AfterBurner render loop or it'll parse all openFOAM
@@ -61,42 +136,146 @@ public:
 	*   - system
 	*/
 	vtkOFRenderer(std::string openFoamPath);
+	~vtkOFRenderer();
+
+	/* async = false blocks until every tracks.vtk is parsed.
+	*  async = true only waits for the first timestamp and parses the rest in the
+	*  background, check isTimeStampReady before using a timestamp.
+	*/
+	int parseTracksFiles(bool async = false);
 
-	int parseTracksFiles();
+	bool isTimeStampReady(int index) const;
+	int getParsedCount() const;
+	// blocks until timestamp index has been parsed
+	void waitForTimeStamp(int index);
 
-	std::vector<std::string> getOpenFoamTimeStamps(std::vector<std::string> dirs);
+	/* Called from the parser threads each time a timestamp finishes:
+	*  (timestamp index, timestamps finished so far, total timestamps)
+	*/
+	typedef std::function<void(int, int, int)> parseProgressCallback;
+	void setParseProgressCallback(parseProgressCallback callback);
 
 	// Keeps model up to date with imgui selection
 	void updateVtkTrackModel(WorldContainer* wl);
 
-	/*Returns WO for you to push back in the world list*/
+	/* Pushes the single WO every timestamp is drawn through into worldList and
+	*  returns it. Call once, switching timestamps never touches the world list again.
+	*/
 	WO *renderTimeStampTrack(WorldContainer* worldList);
 
 	/*This must be ran in already initialized WOImGui istance*/
 	void renderImGuivtkSettings();
+
+	/* Probes the shown timestamp under the mouse at x, y (pixels from the top left of a
+	*  width x height window), cheap enough to call on every onMouseMove.
+	*/
+	void probeTracks(const Camera& cam, int x, int y, int width, int height);
 	
 private:
 
-	bool runLoop;
-	const char* currentSelectedTimeStamp;
+	vtkPlaybackClock playback; // position over timeStamps, driven by the UI
+	bool interpolate;
+	int selectedTimeStamp; // index into timeStamps picked in the UI or by playback
 
-	std::vector<int> threadStates;
-	std::vector<vtkParser> threadParsers;
-	std::vector<std::thread> threads;
+	std::unique_ptr<vtkThreadPool> parsePool;
+	std::vector<std::future<int> > parseResults; // one per timestamp, same order
+	std::atomic<int> parsedCount;
+	std::atomic<bool> cancelParsing;
+	std::vector<std::atomic<int> > timeStampReady; // set by the parser thread once slot i is filled
+	parseProgressCallback parseProgress;
+	bool useParseCache;
+	std::string parseCacheDir;
 
 	std::string filePath;
 
 	std::vector<std::string> timeStamps;
 
 	std::vector<std::string> tracksFiles;
+	// slot i always holds timeStamps[i], preallocated before any parse task runs
 	std::vector<vtkParser::openFoamVtkFileData> tracksFileData;
 
-	std::vector<unsigned int> WOIDS;
+	// render ready geometry of one timestamp, built on a worker and moved into a WO on the render thread
+	struct trackGeometry {
+		std::vector<vtkPointVertex> points; // TRACK_POINTS
+		vtkStreamlineMesh mesh; // streamline styles
+		vtkParser::vtkPolylineIndex lines; // the decimated lines both were built from
+		std::shared_ptr<const vtkStreamlineSpatialIndex> spatial; // of lines, in world space
+	};
+	// slot i is written by whichever thread moves geometryState[i] to GEOMETRY_BUILDING
+	std::vector<trackGeometry> trackGeometries;
+	enum geometryStates {
+		GEOMETRY_NONE, // no geometry and no model
+		GEOMETRY_QUEUED, // build task queued on parsePool
+		GEOMETRY_BUILDING, // a thread is filling trackGeometries[i]
+		GEOMETRY_BUILT, // trackGeometries[i] is ready, or already moved into its model
+		GEOMETRY_PHASE_MASK = 3,
+	};
+	/* A geometryStates in the low bits. A queued slot also carries the generation
+	 * of the request that queued it above them, so a task cancelled by
+	 * rebuildTrackGeometry can't take the slot once it is queued again.
+	 */
+	std::vector<std::atomic<int> > geometryState;
+	std::vector<unsigned> geometryGeneration; // per timestamp, render thread only
+	std::vector<std::future<void> > geometryResults; // last build task queued per timestamp
+	int geometryPhase(int index) const { return geometryState.at(index) & GEOMETRY_PHASE_MASK; }
+	vtkTimeStampCache geometryCache; // timestamps with a model in trackSeries
+	// decimated lines of every timestamp with a model, blended frames are drawn along them
+	std::vector<vtkParser::vtkPolylineIndex> trackLines;
+	// spatial index of every timestamp with a model, shared with the model for culling
+	std::vector<std::shared_ptr<const vtkStreamlineSpatialIndex> > trackSpatial;
+
+	std::vector<int> topologyMatch; // timestamp i against i + 1: -1 not checked yet, 0 differ, 1 same
+	/* Both ends of the blend are built once per timestamp pair along the shown
+	*  timestamp's lines, every frame after that only lerps their vertices into
+	*  blendFrame and re-uploads those, the index buffer stays.
+	*/
+	trackGeometry blendStart;
+	trackGeometry blendEnd;
+	trackGeometry blendFrame;
+	int blendFrom; // timestamp the blend ends were built from, -1 for none
+	float blendFraction;
+
+	struct probeResult {
+		int timeStamp = -1; // -1 when nothing is under the mouse
+		int point = -1;
+		vtkParser::vtkPoint position;
+		std::vector<std::pair<std::string, double> > values; // field label and value
+	};
+	probeResult probe;
 
-	std::vector< Vector > curVertexList;
-	std::vector< unsigned int > curIndexList;
+	// decimation settings read by the workers, world units / fraction of the |U| range
+	std::atomic<float> decimateTolerance;
+	std::atomic<float> decimateFieldTolerance;
+	bool geometryDirty; // settings changed, rebuild on the next update
 
-	std::vector<std::vector<WO*> > preLoadedWOs;
+	WO* trackWO; // the one world list node, owns trackSeries
+	MGLvtkTimeSeries* trackSeries; // one model per timestamp
+	int shownTimeStamp; // timestamp trackSeries renders, -1 before the first
 
-	void parseThread(int index);
+	int parseThread(int index);
+	// decimates timestamp index and builds its geometry into trackGeometries (any thread)
+	void buildTrackGeometry(int index);
+	// points or mesh of data drawn along lines, with the current TRACK_STYLE (any thread)
+	static trackGeometry buildGeometry(vtkParser::openFoamVtkFileData& data, const vtkParser::vtkPolylineIndex& lines);
+	// queued token for the next request of a timestamp (render thread only)
+	int nextGeometryToken(int index);
+	// builds a timestamp queued as token unless another thread already took it, false if it did
+	bool runTrackGeometry(int index, int token);
+	// queues the geometry build of a parsed timestamp on the pool (render thread only)
+	void requestTrackGeometry(int index);
+	// returns once timestamp index has geometry, building it on this thread when nobody started it
+	void waitForTrackGeometry(int index);
+	// drops every model and geometry so they are built again with the current settings
+	void rebuildTrackGeometry();
+	// model drawing a parsed timestamp in a single call, parented to trackWO (render thread only)
+	MGL* buildTimeStampModel(int index);
+	// moves built geometry into a model in trackSeries and the cache, evicting what no longer fits
+	void adoptTrackGeometry(int index);
+	void evictTimeStamp(int index);
+	// queues the playback neighbours of the shown timestamp, then fills idle cache space
+	void prefetchTimeStamps();
+	// makes trackSeries render timestamp index, building its model first if needed
+	void showTimeStamp(int index);
+	// shows index blended fraction of the way to index + 1, false when the two can't blend
+	bool showBlend(int index, float fraction);
 };
\ No newline at end of file
@@ -1,15 +1,53 @@
 /*Copyright (c) 2024 Tristan Wellman*/
 #include <iostream>
 #include <cstdlib>
-#include <fstream>
 #include <cstring>
 #include <memory>
 #include <vector>
-#include <sstream>
 #include <type_traits>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <algorithm>
+#include <bit>
+#include <atomic>
+#include <random>
 
 #include "vtkParser.hpp"
 
+/* Sidecar cache layout, native byte order:
+ * header | one record per section | value blocks aligned to VTKCACHE_ALIGN
+ * Blocks hold exactly what the parser decodes: POINTS as packed xyz, LINES as
+ * the CSR offsets followed by the indices, attribute arrays as tuple major columns.
+ */
+#define VTKCACHE_EXTENSION ".vtkcache"
+#define VTKCACHE_MAGIC "VTKFOAMC"
+#define VTKCACHE_VERSION 1
+#define VTKCACHE_BYTEORDER 0x01020304u
+#define VTKCACHE_NAMESIZE 64
+#define VTKCACHE_ALIGN 16
+
+struct vtkCacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder; // reads back as something else on a machine of the other endianness
+	uint64_t sourceSize;
+	int64_t sourceMTime;
+	uint32_t sectionCount;
+	uint32_t reserved;
+};
+
+struct vtkCacheRecord {
+	char name[VTKCACHE_NAMESIZE];
+	int32_t scope;
+	int32_t type;
+	int32_t numComponents;
+	int32_t numTuples;
+	uint64_t count;
+	uint64_t offset;
+};
+
 vtkParser::vtkParser() {}
 vtkParser::vtkParser(char* vtkFile) : VTKFILE(vtkFile) {}
 
@@ -31,272 +69,1083 @@ void vtkParser::printVTKFILE() {
 }
 
 void vtkParser::freeVtkData() {
+	if (globalVtkData == nullptr) return;
 
 	delete globalVtkData->foamData;
 	delete globalVtkData;
-
+	globalVtkData = nullptr;
 }
 
 int vtkParser::init() {
+	VTK_TRACE_ZONE("vtkParser::init");
 
 	globalVtkData = new vtkParseData;
-	globalVtkData->foamData = new openFoamVtkFileData;
-
-	std::FILE* file = std::fopen(
-		VTKFILE.c_str(), "r");
+	globalVtkData->foamData = new openFoamVtkFileData();
+	globalVtkData->index = std::make_shared<vtkSectionIndex>();
+	globalVtkData->index->path = VTKFILE;
+	globalVtkData->foamData->index = globalVtkData->index;
+	globalVtkData->encoding = ENCODING_ASCII;
 
+	// map the file once, everything after this tokenizes the mapping in place.
+	// tracks.vtk.gz is inflated into a temporary file and that is mapped instead
+	vtkMappedFile& file = globalVtkData->index->file;
 	VTKASSERT(
-		file != NULL,
-		"ERROR:: Failed to Open file : %s\n", VTKFILE);
-
-	int lineCount = 0;
-	char line[256];
-	for (; fgets(line, sizeof(line), file) != NULL; lineCount++);
+		vtkInflateStream::isCompressed(VTKFILE) ? file.openInflated(VTKFILE) : file.open(VTKFILE),
+		"ERROR:: Failed to Open file : %s\n", VTKFILE.c_str());
 	VTKASSERT(
-		lineCount > 0,
+		file.size() > 0,
 		"Error:: OpenFoam File Buffer empty!\n");
 
-	std::fseek(file, 0, SEEK_SET);
-	globalVtkData->lineCount = lineCount;
-
-	// copy data from file to fileBuffer
-	for (lineCount = 0; fgets(line, sizeof(line), file) != NULL; lineCount++) {
-		int i = 0;
-		for (i = 0; i < MAXLINESIZE && line[i] != '\0'; i++) {
-			globalVtkData->fileBuffer[lineCount][i] = line[i];
-		}
-		//std::cout << globalVtkData->fileBuffer[lineCount];
-	}
-	std::fclose(file);
+	globalVtkData->tokens = vtkTokenizer(file.data(), file.data() + file.size());
 
-
-	return (globalVtkData->lineCount > 0);
+	return (file.size() > 0);
 }
 
 void vtkParser::dumpOFOAMPolyDataset() {
-	int i, j;
-	std::cout << "Total Polys: " << globalVtkData->foamData->points.size << std::endl;
+	int i;
+	const vtkPointDataset& points = globalVtkData->foamData->points;
+	std::cout << "Total Polys: " << points.size << std::endl;
 
-	for (i = 0; i < globalVtkData->foamData->points.size; i++) {
-		for (j = 0; j < POLYDATANSIZE; j++) {
-			if (globalVtkData->foamData->points.polyData.at(i).empty() ||
-				globalVtkData->foamData->points.polyData.at(i).size() <= j) continue;
-			//std::cout << globalVtkData->foamData->points.polyData[i][j] << " ";
-			VTKLOG("{}", globalVtkData->foamData->points.polyData.at(i).at(j));
-		}
+	for (i = 0; i < points.size; i++) {
+		vtkPoint p = points.point(i);
+		VTKLOG("{} {} {}", p.x, p.y, p.z);
 		std::cout << "Poly " << i << std::endl;
 	}
 }
 
+vtkParser::valueTypes vtkParser::valueTypeFromName(std::string_view name) {
+	if (name == "float") return TYPE_FLOAT;
+	if (name == "double") return TYPE_DOUBLE;
+	if (name == "int" || name == "unsigned_int" || name == "long" || name == "unsigned_long" ||
+		name == "short" || name == "unsigned_short" || name == "char" || name == "unsigned_char" ||
+		name == "bit" || name == "vtkIdType") return TYPE_INT;
+	return TYPE_UNKNOWN;
+}
+
+size_t vtkParser::valueTypeSize(int type) {
+	if (type == TYPE_FLOAT) return sizeof(float);
+	if (type == TYPE_INT) return sizeof(int);
+	return sizeof(double);
+}
+
 vtkParser::openFoamVtkFileData vtkParser::getOpenFoamData() {
 	return *globalVtkData->foamData;
 }
 
-int checkDataScope(char* line) {
-	//std::cout << line << std::endl;
-	std::string str(line);
-	if (str.find("DATASET") != std::string::npos ||
-		str.find("POINT_DATA") != std::string::npos ||
-		str.find("CELL_DATA") != std::string::npos ||
-		str.find("LINES") != std::string::npos) return 1;
-	return 0;
+vtkParser::openFoamVtkFileData vtkParser::releaseOpenFoamData() {
+	openFoamVtkFileData ret = std::move(*globalVtkData->foamData);
+	*globalVtkData->foamData = openFoamVtkFileData();
+	return ret;
 }
 
-// util function to seek to line in ifstream
-void seekToLine(std::ifstream& stream, int lineNum) {
-	std::string line;
-	for (int i = 0; i < lineNum && std::getline(stream, line); i++);
+// true for keywords that open a new section in a legacy vtk file
+static bool isSectionKeyword(std::string_view tok) {
+	return tok == "DATASET" || tok == "POINTS" || tok == "LINES" ||
+		tok == "POINT_DATA" || tok == "CELL_DATA";
 }
 
-std::vector<std::string> vtkParser::tokenizeDataLine(char* currentLine) {
-	std::vector<std::string> ret;
-	std::string line(currentLine);
-	std::stringstream strstream(line);
-	while (std::getline(strstream, line, ' '))
-		ret.push_back(line);
-	return ret;
+// how legacy BINARY stores one value of a type name, 0 for types it can't read (bit)
+static int legacyDiskType(std::string_view name, vtkParser::vtkSection& sec) {
+	sec.diskFloat = (name == "float" || name == "double");
+	sec.diskSigned = name.rfind("unsigned", 0) != 0;
+	if (name == "double" || name == "long" || name == "unsigned_long") sec.diskBytes = 8;
+	else if (name == "float" || name == "int" || name == "unsigned_int" || name == "vtkIdType") sec.diskBytes = 4;
+	else if (name == "short" || name == "unsigned_short") sec.diskBytes = 2;
+	else if (name == "char" || name == "unsigned_char") sec.diskBytes = 1;
+	else sec.diskBytes = 0;
+	return sec.diskBytes;
 }
 
-void vtkParser::polyPointSecParse(vtkParseData* data, int lineNum) {
+// .vtp DataArray type I.E. Float32, Int64, UInt8
+static int vtpDiskType(std::string_view name, vtkParser::vtkSection& sec) {
+	sec.diskFloat = name.rfind("Float", 0) == 0;
+	sec.diskSigned = name.rfind("UInt", 0) != 0;
+	std::string_view bits = name.substr(name.find_first_of("0123456789") == std::string_view::npos ?
+		name.size() : name.find_first_of("0123456789"));
+	if (bits == "8") sec.diskBytes = 1;
+	else if (bits == "16") sec.diskBytes = 2;
+	else if (bits == "32") sec.diskBytes = 4;
+	else if (bits == "64") sec.diskBytes = 8;
+	else sec.diskBytes = 0;
+	if (sec.diskFloat && sec.diskBytes < 4) sec.diskBytes = 0;
+	return sec.diskBytes;
+}
+
+// value of name="..." inside an xml tag, empty when the tag doesn't have it
+static std::string_view xmlAttribute(std::string_view tag, std::string_view name) {
+	size_t at = 0;
+	while ((at = tag.find(name, at)) != std::string_view::npos) {
+		size_t eq = at + name.size();
+		if (at > 0 && vtkTokenizer::isSpace(tag[at - 1]) && eq + 1 < tag.size() && tag[eq] == '=' &&
+			(tag[eq + 1] == '"' || tag[eq + 1] == '\'')) {
+			size_t close = tag.find(tag[eq + 1], eq + 2);
+			if (close == std::string_view::npos) return {};
+			return tag.substr(eq + 2, close - eq - 2);
+		}
+		at = eq;
+	}
+	return {};
+}
+
+/* Decodes base64 from [first, last) into out until maxBytes are written or a
+ * character that isn't base64 is reached. Whitespace is skipped and padded
+ * groups may be followed by more data, .vtp writers encode the length header
+ * and the values either as one stream or as two.
+ */
+static size_t base64Decode(const char* first, const char* last, uint8_t* out, size_t maxBytes) {
+	static const struct table {
+		int8_t v[256];
+		table() {
+			const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+			memset(v, -1, sizeof(v));
+			for (int i = 0; i < 64; i++) v[(unsigned char)chars[i]] = (int8_t)i;
+		}
+	} lookup;
+
+	size_t written = 0;
+	uint32_t quantum = 0;
+	int chars = 0, padding = 0;
+	const char* p = first;
+	while (p < last && written < maxBytes) {
+		// whole groups without whitespace or padding, nearly all of a block
+		while (chars == 0 && last - p >= 4 && maxBytes - written >= 3) {
+			int a = lookup.v[(unsigned char)p[0]], b = lookup.v[(unsigned char)p[1]];
+			int c = lookup.v[(unsigned char)p[2]], d = lookup.v[(unsigned char)p[3]];
+			if ((a | b | c | d) < 0) break;
+			uint32_t group = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | (uint32_t)d;
+			out[written] = (uint8_t)(group >> 16);
+			out[written + 1] = (uint8_t)(group >> 8);
+			out[written + 2] = (uint8_t)group;
+			written += 3;
+			p += 4;
+		}
+		if (p >= last || written >= maxBytes) break;
+
+		unsigned char c = (unsigned char)*p++;
+		if (vtkTokenizer::isSpace((char)c)) continue;
+		if (c == '=') padding++;
+		else if (lookup.v[c] < 0 || padding > 0) break;
+		quantum = (quantum << 6) | (uint32_t)(c == '=' ? 0 : lookup.v[c]);
+		if (++chars < 4) continue;
+		uint8_t bytes[3] = { (uint8_t)(quantum >> 16), (uint8_t)(quantum >> 8), (uint8_t)quantum };
+		for (int i = 0; i < 3 - padding && written < maxBytes; i++) out[written++] = bytes[i];
+		quantum = 0;
+		chars = padding = 0;
+	}
+	return written;
+}
+
+// one value as the file stores it (already in native byte order) converted to T
+template<typename T>
+static T diskValue(const uint8_t* p, const vtkParser::vtkSection& sec) {
+	if (sec.diskFloat) {
+		if (sec.diskBytes == 4) { float v; memcpy(&v, p, 4); return (T)v; }
+		double v; memcpy(&v, p, 8); return (T)v;
+	}
+	switch (sec.diskBytes) {
+	case 1: return sec.diskSigned ? (T)(int8_t)p[0] : (T)p[0];
+	case 2: { uint16_t v; memcpy(&v, p, 2); return sec.diskSigned ? (T)(int16_t)v : (T)v; }
+	case 4: { uint32_t v; memcpy(&v, p, 4); return sec.diskSigned ? (T)(int32_t)v : (T)v; }
+	default: { uint64_t v; memcpy(&v, p, 8); return sec.diskSigned ? (T)(int64_t)v : (T)v; }
+	}
+}
+
+/* count fixed width values from src into out. When the file stores exactly
+ * T the block is one memcpy plus a bulk byte swap, other widths (I.E. Int64
+ * connectivity read into int) go through a small buffer a chunk at a time.
+ */
+template<typename T>
+static void decodeBinary(const uint8_t* src, const vtkParser::vtkSection& sec, T* out, size_t count) {
+	if (sec.diskBytes == (int)sizeof(T) && sec.diskFloat == std::is_floating_point_v<T>) {
+		memcpy(out, src, count * sizeof(T));
+		if (sec.swapBytes) vtkByteSwap(out, sizeof(T), count);
+		return;
+	}
+	uint8_t chunk[4096 * 8];
+	size_t perChunk = sizeof(chunk) / sec.diskBytes;
+	for (size_t i = 0; i < count; i += perChunk) {
+		size_t n = std::min(perChunk, count - i);
+		memcpy(chunk, src + i * sec.diskBytes, n * sec.diskBytes);
+		if (sec.swapBytes) vtkByteSwap(chunk, sec.diskBytes, n);
+		for (size_t j = 0; j < n; j++) out[i + j] = diskValue<T>(chunk + j * sec.diskBytes, sec);
+	}
+}
+
+template<typename T>
+int vtkParser::readNumericBlock(vtkTokenizer& tokens, T* out, size_t count,
+	const char* section, const std::string& file) {
+	const char* blockStart = tokens.position();
+
+	size_t got = tokens.readBlock(out, count);
+	if (got < count) {
+		std::string_view stopTok = tokens.peek();
+		VTKLOG("ERROR:: {} in {} declares {} values but only {} were read, stopped at '{}' (line {})",
+			section, file, count, got, stopTok.empty() ? "EOF" : std::string(stopTok),
+			tokens.currentLine());
+		return 0;
+	}
+
+	// the next thing after the block must be a keyword or the end of the file
+	double extra;
+	const char* blockEnd = tokens.position();
+	if (tokens.nextNumber(extra)) {
+		VTKLOG("ERROR:: {} in {} declares {} values but more data follows (line {}, block began line {})",
+			section, file, count, tokens.lineAt(blockEnd), tokens.lineAt(blockStart));
+		return 0;
+	}
+	return 1;
+}
+template int vtkParser::readNumericBlock<float>(vtkTokenizer&, float*, size_t, const char*, const std::string&);
+template int vtkParser::readNumericBlock<double>(vtkTokenizer&, double*, size_t, const char*, const std::string&);
+template int vtkParser::readNumericBlock<int>(vtkTokenizer&, int*, size_t, const char*, const std::string&);
+
+template<typename T>
+int vtkParser::readSectionBlock(vtkSectionIndex& index, const vtkSection& sec, T* out, size_t count) {
+	if (sec.encoding == ENCODING_RAW) {
+		size_t bytes = count * sizeof(T);
+		if (sec.offset > index.file.size() || bytes > index.file.size() - sec.offset) {
+			VTKLOG("ERROR:: {} in {} runs past the end of the file", sec.name, index.path);
+			return 0;
+		}
+		memcpy(out, index.file.data() + sec.offset, bytes);
+		return 1;
+	}
+	if (sec.encoding == ENCODING_BINARY || sec.encoding == ENCODING_BASE64) {
+		size_t bytes = count * sec.diskBytes;
+		const char* first = index.file.data() + std::min(sec.offset, index.file.size());
+		const char* last = index.file.data() + index.file.size();
+		if (sec.encoding == ENCODING_BINARY) {
+			if (bytes > (size_t)(last - first)) {
+				VTKLOG("ERROR:: {} in {} runs past the end of the file", sec.name, index.path);
+				return 0;
+			}
+			decodeBinary((const uint8_t*)first, sec, out, count);
+			return 1;
+		}
+		std::vector<uint8_t> decoded(sec.headerBytes + bytes);
+		if (base64Decode(first, last, decoded.data(), decoded.size()) != decoded.size()) {
+			VTKLOG("ERROR:: {} in {} holds less base64 data than its {} values", sec.name, index.path, count);
+			return 0;
+		}
+		decodeBinary(decoded.data() + sec.headerBytes, sec, out, count);
+		return 1;
+	}
+
+	vtkTokenizer tokens(index.file.data(), index.file.data() + index.file.size());
+	tokens.seek(sec.offset);
+	std::string section = (sec.scope == DATASET) ? sec.name : fmt::format("array {}", sec.name);
+	return readNumericBlock(tokens, out, count, section.c_str(), index.path);
+}
+template int vtkParser::readSectionBlock<float>(vtkSectionIndex&, const vtkSection&, float*, size_t);
+template int vtkParser::readSectionBlock<double>(vtkSectionIndex&, const vtkSection&, double*, size_t);
+template int vtkParser::readSectionBlock<int>(vtkSectionIndex&, const vtkSection&, int*, size_t);
+
+int vtkParser::polyPointSecParse(vtkParseData* data, const vtkSection& sec) {
+	VTK_TRACE_ZONE("vtkParser::polyPointSecParse");
 
 	if (data == nullptr ||
 		data->foamData == nullptr) {
 		VTKLOG("ERROR:: vtk parse data struct is nullptr!");
-		return;
+		return 0;
 	}
 
-	std::string dataBuffer;
+	vtkPointDataset& points = data->foamData->points;
+	vtkSectionIndex& index = *data->index;
+	points.clear();
 
-	// initialize 2D vector
-	int i, j;
-	if (data->foamData->points.polyData.empty()) {
-		data->foamData->points.polyData =
-			std::vector<std::vector<double> >{};
-		data->foamData->points.polyData.resize(
-			data->foamData->points.size);
+	// one allocation for the whole block, values go straight from the mapping into it.
+	// points stay in the declared precision, anything that isn't float is held as double
+	if (sec.type == TYPE_FLOAT) {
+		std::vector<float> packed((size_t)sec.numTuples * POLYDATANSIZE);
+		if (!readSectionBlock(index, sec, packed.data(), packed.size())) return 0;
+		points.assign(std::move(packed));
 	}
+	else {
+		std::vector<double> packed((size_t)sec.numTuples * POLYDATANSIZE);
+		if (!readSectionBlock(index, sec, packed.data(), packed.size())) return 0;
+		points.assign(std::move(packed));
+	}
+	return 1;
+}
 
-	std::ifstream file(VTKFILE);
-	VTKASSERT(!file.fail(), "ERROR:: Failed to re-open vtk file!");
+int vtkParser::polyLineSecParse(vtkParseData* data, const vtkSection& sec) {
+	VTK_TRACE_ZONE("vtkParser::polyLineSecParse");
 
-	std::vector<std::string> pointBufferLines;
-	std::string curLine;
-	int totalSize = 0;
+	vtkPolylineIndex& lines = data->foamData->lines;
+	vtkSectionIndex& index = *data->index;
+	int lineCount = sec.numTuples;
+	lines.clear();
+
+	if (sec.encoding == ENCODING_RAW) {
+		// cached lines are already CSR: lineCount + 1 offsets then the indices
+		if (lineCount <= 0 || sec.count < (size_t)lineCount + 1) {
+			VTKLOG("ERROR:: LINES in {} has a bad line count", index.path);
+			return 0;
+		}
+		lines.offsets.resize(lineCount + 1);
+		lines.indices.resize(sec.count - lines.offsets.size());
+		vtkSection indexSec = sec;
+		indexSec.offset += lines.offsets.size() * sizeof(int);
+		if (!readSectionBlock(index, sec, lines.offsets.data(), lines.offsets.size()) ||
+			!readSectionBlock(index, indexSec, lines.indices.data(), lines.indices.size()) ||
+			lines.offsets.front() != 0 || lines.offsets.back() != (int)lines.indices.size()) {
+			VTKLOG("ERROR:: LINES in {} are not valid CSR", index.path);
+			lines.clear();
+			return 0;
+		}
+		return 1;
+	}
 
-	// get all the data lines
-	seekToLine(file, lineNum);
-	for (i = 0; i < data->foamData->points.size && getline(file, curLine); i++) {
-		if (checkDataScope(data->fileBuffer[lineNum + i])) break;
-		pointBufferLines.push_back(curLine);
-		totalSize += curLine.length();
+	// .vtp lines are the connectivity plus a separate list of where every line ends
+	const vtkSection* offsetsSec = nullptr;
+	for (const vtkSection& other : index.sections)
+		if (other.scope == DATASET && other.name == "OFFSETS") offsetsSec = &other;
+	if (offsetsSec != nullptr) {
+		int pointCount = data->foamData->points.size;
+		if (lineCount < 0 || offsetsSec->count < (size_t)lineCount) {
+			VTKLOG("ERROR:: Lines in {} hold {} offsets for {} lines", index.path, offsetsSec->count, lineCount);
+			return 0;
+		}
+		lines.indices.resize(sec.count);
+		lines.offsets.resize((size_t)lineCount + 1);
+		lines.offsets[0] = 0;
+		if (!readSectionBlock(index, sec, lines.indices.data(), lines.indices.size()) ||
+			!readSectionBlock(index, *offsetsSec, lines.offsets.data() + 1, lineCount)) {
+			lines.clear();
+			return 0;
+		}
+		for (int i = 0; i < lineCount; i++) {
+			if (lines.offsets[i + 1] < lines.offsets[i]) {
+				VTKLOG("ERROR:: Lines in {}: line {} ends before it starts", index.path, i);
+				lines.clear();
+				return 0;
+			}
+		}
+		if (lines.offsets.back() != (int)lines.indices.size()) {
+			VTKLOG("ERROR:: Lines in {} end at {} but the connectivity holds {}", index.path,
+				lines.offsets.back(), lines.indices.size());
+			lines.clear();
+			return 0;
+		}
+		for (int idx : lines.indices) {
+			if (idx < 0 || idx >= pointCount) {
+				VTKLOG("ERROR:: Lines in {} reference point {} of {}", index.path, idx, pointCount);
+				lines.clear();
+				return 0;
+			}
+		}
+		return 1;
 	}
 
-	// reserve and concat all strings to line buffer
-	dataBuffer.reserve(totalSize);
-	for (auto& str : pointBufferLines) {
-		if (str.at(str.length() - 1) == '\n') str = str.substr(0, str.size() - 1);
-		dataBuffer += str;
-		if (str.at(str.length() - 1) != ' ') dataBuffer += ' ';
+	int totalSize = (int)sec.count;
+	if (lineCount <= 0 || totalSize < lineCount) {
+		VTKLOG("ERROR:: LINES {} {} in {} is not a valid header", lineCount, totalSize, index.path);
+		return 0;
 	}
 
-	// tokenize the file buffer line into individual values
-	std::vector<std::string> tokenizedLine;
-	tokenizedLine = tokenizeDataLine((char*)dataBuffer.c_str());
+	/* The block is <n> i0 .. in-1 per line. It is read whole into what becomes
+	 * the index array and compacted in place by dropping the counts, so the
+	 * index array and the offsets are the only allocations.
+	 */
+	std::vector<int>& indices = lines.indices;
+	indices.resize(totalSize);
+	if (!readSectionBlock(index, sec, indices.data(), indices.size())) {
+		lines.clear();
+		return 0;
+	}
 
-	for (i = 0; i < tokenizedLine.size() &&
-		i < data->foamData->points.size; i++) {
-		for (j = 0; j < POLYDATANSIZE; j++) {
-			if (tokenizedLine[i * POLYDATANSIZE + j].empty()) return;
-			if (tokenizedLine[i * POLYDATANSIZE + j] == "\n") continue;
-			int pos = (i * POLYDATANSIZE + j);
-			data->foamData->points.polyData[i].push_back(
-				std::stod(tokenizedLine[pos]));
+	lines.offsets.resize(lineCount + 1);
+	int pointCount = data->foamData->points.size;
+	int read = 0, write = 0, i, j;
+	for (i = 0; i < lineCount; i++) {
+		int n = (read < totalSize) ? indices[read++] : -1;
+		if (n < 0 || n > totalSize - read) {
+			VTKLOG("ERROR:: LINES in {}: line {} has a bad point count", index.path, i);
+			lines.clear();
+			return 0;
+		}
+		lines.offsets[i] = write;
+		for (j = 0; j < n; j++) {
+			int idx = indices[read++];
+			if (idx < 0 || idx >= pointCount) {
+				VTKLOG("ERROR:: LINES in {}: line {} references point {} of {}", index.path, i, idx, pointCount);
+				lines.clear();
+				return 0;
+			}
+			indices[write++] = idx;
 		}
 	}
+	if (read != totalSize) {
+		VTKLOG("ERROR:: LINES in {} declares {} values but its {} lines hold {}",
+			index.path, totalSize, lineCount, read);
+		lines.clear();
+		return 0;
+	}
+	lines.offsets[lineCount] = write;
+	indices.resize(write); // shrinking, no reallocation
+	return 1;
+}
 
-	file.close();
+void vtkParser::scanSections(vtkParseData* data) {
+	VTK_TRACE_ZONE("vtkParser::scanSections");
 
+	vtkTokenizer& tokens = data->tokens;
+	std::vector<vtkSection>& sections = data->index->sections;
+	int scope = NONE, scopeSize = 0;
+
+	bool binary = (data->encoding == ENCODING_BINARY);
+
+	// records where the block starts and steps over it without decoding
+	auto addSection = [&](vtkSection sec, std::string_view typeName) {
+		if (binary) {
+			// big endian values start on the line after the section header
+			if (!legacyDiskType(typeName, sec)) {
+				VTKLOG("ERROR:: {} in {} is of type {} which BINARY files can't be read as", sec.name, VTKFILE, typeName);
+				return false;
+			}
+			tokens.skipLine();
+			sec.offset = tokens.offset();
+			sec.encoding = ENCODING_BINARY;
+			sec.swapBytes = (std::endian::native == std::endian::little);
+			size_t bytes = sec.count * sec.diskBytes;
+			if (bytes > tokens.size() - sec.offset) {
+				VTKLOG("WARNING:: {} in {} declares {} values but the file ends first", sec.name, VTKFILE, sec.count);
+			}
+			tokens.seek(sec.offset + bytes);
+			sections.push_back(std::move(sec));
+			return true;
+		}
+		sec.offset = tokens.offset();
+		size_t skipped = tokens.skipNumbers(sec.count);
+		if (skipped != sec.count) {
+			VTKLOG("WARNING:: {} in {} declares {} values but only {} follow (line {})",
+				sec.name, VTKFILE, sec.count, skipped, tokens.currentLine());
+		}
+		sections.push_back(std::move(sec));
+		return true;
+	};
+
+	sections.clear();
+	while (!tokens.eof()) {
+		std::string_view tok = tokens.next();
+
+		if (tok == "DATASET") {
+			scope = (tokens.next() == "POLYDATA") ? DATASET : NONE;
+		}
+		else if (tok == "POINT_DATA" || tok == "CELL_DATA") {
+			scope = (tok == "POINT_DATA") ? POINT_DATA : CELL_DATA;
+			if (!tokens.nextNumber(scopeSize)) scope = NONE;
+		}
+		else if (scope == DATASET && tok == "POINTS") {
+			// POINTS <count> <type> I.E. POINTS 104 float
+			vtkSection sec;
+			sec.name = "POINTS";
+			sec.scope = DATASET;
+			sec.numComponents = POLYDATANSIZE;
+			if (!tokens.nextNumber(sec.numTuples)) continue; // invalid or wrong polydata point area
+			std::string_view type = tokens.next();
+			if (type.empty() || isSectionKeyword(type)) continue;
+			sec.type = valueTypeFromName(type);
+			sec.count = (size_t)sec.numTuples * POLYDATANSIZE;
+			if (!addSection(std::move(sec), type)) return;
+		}
+		else if (scope == DATASET && tok == "LINES") {
+			// LINES <line count> <total values> I.E. LINES 10 114
+			vtkSection sec;
+			sec.name = "LINES";
+			sec.scope = DATASET;
+			sec.type = TYPE_INT;
+			sec.numComponents = 1;
+			int totalSize = 0;
+			if (!tokens.nextNumber(sec.numTuples) || !tokens.nextNumber(totalSize)) continue;
+			sec.count = totalSize;
+			if (!addSection(std::move(sec), "int")) return;
+		}
+		else if ((scope == POINT_DATA || scope == CELL_DATA) && tok == "FIELD") {
+			// FIELD <name> <array count>, each array is: <name> <components> <tuples> <type>
+			tokens.next();
+			int arrayCount = 0;
+			if (!tokens.nextNumber(arrayCount)) continue;
+			for (int i = 0; i < arrayCount; i++) {
+				vtkSection sec;
+				sec.name = std::string(tokens.next());
+				sec.scope = scope;
+				if (!tokens.nextNumber(sec.numComponents) ||
+					!tokens.nextNumber(sec.numTuples)) {
+					VTKLOG("ERROR:: bad FIELD array header for {} in {}", sec.name, VTKFILE);
+					return;
+				}
+				std::string_view type = tokens.next();
+				sec.type = valueTypeFromName(type);
+				sec.count = (size_t)sec.numTuples * sec.numComponents;
+				if (!addSection(std::move(sec), type)) return;
+			}
+		}
+		else if ((scope == POINT_DATA || scope == CELL_DATA) &&
+			(tok == "SCALARS" || tok == "VECTORS" || tok == "NORMALS")) {
+			// SCALARS <name> <type> [components] [LOOKUP_TABLE <table>], VECTORS/NORMALS <name> <type>
+			vtkSection sec;
+			sec.name = std::string(tokens.next());
+			sec.scope = scope;
+			std::string_view type = tokens.next();
+			sec.type = valueTypeFromName(type);
+			sec.numTuples = scopeSize;
+			sec.numComponents = (tok == "SCALARS") ? 1 : 3;
+			if (tok == "SCALARS") {
+				int comps = 0;
+				if (vtkTokenizer::toNumber(tokens.peek(), comps)) {
+					tokens.next();
+					sec.numComponents = comps;
+				}
+				if (tokens.peek() == "LOOKUP_TABLE") {
+					tokens.next();
+					tokens.next();
+				}
+			}
+			sec.count = (size_t)sec.numTuples * sec.numComponents;
+			if (!addSection(std::move(sec), type)) return;
+		}
+		else if (tok == "LOOKUP_TABLE") {
+			// LOOKUP_TABLE <name> <size> followed by rgba entries, not used for colouring here
+			tokens.next();
+			int entries = 0;
+			if (!tokens.nextNumber(entries)) continue;
+			if (binary) {
+				// one unsigned char per channel
+				tokens.skipLine();
+				tokens.seek(tokens.offset() + (size_t)entries * 4);
+			}
+			else tokens.skipNumbers((size_t)entries * 4);
+		}
+	}
 }
 
-/* This function needs changed in future:
- * vtk datasets are defined by (name) value type I.E. POINTS 104 float.
- * this function is only catering to the polyData when it could grab everything for later use.
- * */
- // WIP
-void vtkParser::getPolyDataset(vtkParseData* data) {
+int vtkParser::scanVtpSections(vtkParseData* data) {
+	VTK_TRACE_ZONE("vtkParser::scanVtpSections");
 
-	vtkParser::dataScopes currentDataScope = NONE;
-	vtkParser::OFOAMdatasetTypes currentDatasetType = OFNONE;
+	vtkSectionIndex& index = *data->index;
+	std::string_view text(index.file.data(), index.file.size());
+	std::vector<vtkSection>& sections = index.sections;
+	const size_t npos = std::string_view::npos;
+	sections.clear();
 
-	int i;
+	// tags are only looked for in front of the appended block, its bytes can hold anything
+	size_t appendedTag = text.find("<AppendedData");
+	size_t tagsEnd = (appendedTag == npos) ? text.size() : appendedTag;
+	size_t appendedStart = npos;
+	bool appendedBase64 = false;
+	if (appendedTag != npos) {
+		size_t close = text.find('>', appendedTag);
+		size_t underscore = (close == npos) ? npos : text.find('_', close);
+		if (underscore == npos) {
+			VTKLOG("ERROR:: AppendedData in {} has no '_' marker", index.path);
+			return 0;
+		}
+		appendedBase64 = xmlAttribute(text.substr(appendedTag, close - appendedTag), "encoding") == "base64";
+		appendedStart = underscore + 1;
+	}
 
-	int inDataset = 0, inPolyPointData = 0;
-	int totalPoints = 0;
-	for (i = 0; i < data->lineCount; i++) {
+	enum { IN_NONE, IN_POINTS, IN_LINES, IN_POINT_DATA, IN_CELL_DATA, IN_OTHER };
+	int block = IN_NONE;
+	bool swap = false;
+	int headerBytes = 4;
+	int pointCount = 0, lineCount = 0;
 
-		if (currentDataScope == DATASET) {
+	size_t pos = 0;
+	while ((pos = text.find('<', pos)) < tagsEnd) {
+		size_t close = text.find('>', pos);
+		if (close == npos) break;
+		std::string_view tag = text.substr(pos + 1, close - pos - 1);
+		std::string_view tagName = tag.substr(0, tag.find_first_of(" \t\r\n/", 1));
+		pos = close + 1;
 
-			// run the parser for point data in vtk file
-			if (currentDatasetType == POINTS) {
-				if (checkDataScope(data->fileBuffer[i])) break;
-				polyPointSecParse(data, i);
-				data->foamData->depth++;
+		if (tagName == "VTKFile") {
+			if (xmlAttribute(tag, "type") != "PolyData") {
+				VTKLOG("ERROR:: {} is a {} file, only PolyData is read", index.path, xmlAttribute(tag, "type"));
+				return 0;
+			}
+			if (!xmlAttribute(tag, "compressor").empty()) {
+				VTKLOG("ERROR:: {} is compressed with {}, write it uncompressed", index.path, xmlAttribute(tag, "compressor"));
+				return 0;
+			}
+			swap = (xmlAttribute(tag, "byte_order") == "BigEndian") != (std::endian::native == std::endian::big);
+			headerBytes = (xmlAttribute(tag, "header_type") == "UInt64") ? 8 : 4;
+		}
+		else if (tagName == "Piece") {
+			if (!sections.empty()) {
+				VTKLOG("WARNING:: {} holds more than one Piece, only the first is read", index.path);
 				break;
 			}
+			if (!vtkTokenizer::toNumber(xmlAttribute(tag, "NumberOfPoints"), pointCount)) pointCount = 0;
+			if (!vtkTokenizer::toNumber(xmlAttribute(tag, "NumberOfLines"), lineCount)) lineCount = 0;
+		}
+		else if (tagName == "Points") block = IN_POINTS;
+		else if (tagName == "Lines") block = IN_LINES;
+		else if (tagName == "PointData") block = IN_POINT_DATA;
+		else if (tagName == "CellData") block = IN_CELL_DATA;
+		else if (tagName == "Verts" || tagName == "Polys" || tagName == "Strips" || tagName == "FieldData") block = IN_OTHER;
+		else if (tagName == "/Points" || tagName == "/Lines" || tagName == "/PointData" || tagName == "/CellData" ||
+			tagName == "/Verts" || tagName == "/Polys" || tagName == "/Strips" || tagName == "/FieldData") block = IN_NONE;
+		else if (tagName == "DataArray") {
+			vtkSection sec;
+			std::string_view name = xmlAttribute(tag, "Name");
+			sec.numComponents = 1;
+			vtkTokenizer::toNumber(xmlAttribute(tag, "NumberOfComponents"), sec.numComponents);
+
+			if (block == IN_POINTS) {
+				sec.name = "POINTS";
+				sec.scope = DATASET;
+				sec.numTuples = pointCount;
+				if (sec.numComponents != POLYDATANSIZE) {
+					VTKLOG("ERROR:: Points in {} have {} components", index.path, sec.numComponents);
+					return 0;
+				}
+			}
+			else if (block == IN_LINES && (name == "connectivity" || name == "offsets")) {
+				sec.name = (name == "connectivity") ? "LINES" : "OFFSETS";
+				sec.scope = DATASET;
+				sec.numTuples = lineCount;
+			}
+			else if (block == IN_POINT_DATA || block == IN_CELL_DATA) {
+				sec.name = std::string(name);
+				sec.scope = (block == IN_POINT_DATA) ? POINT_DATA : CELL_DATA;
+				// lines are the only cells that are read
+				sec.numTuples = (block == IN_POINT_DATA) ? pointCount : lineCount;
+			}
+			else continue;
 
-			//if in just dataset portion
-			char* polyCheck = strtok(data->fileBuffer[i], "POINTS");
-			if (polyCheck != NULL) {
-				polyCheck++;
-				// polyCheck should be "104 float" with my test file
-				char tmp[MAXLINESIZE];
-				snprintf(tmp, sizeof(tmp), "%s", polyCheck);
-				char* count = strtok(tmp, " ");
-				char* type = strstr(polyCheck, " ");
-				if (count != NULL && type != NULL) {
-					type++;
-					currentDatasetType = POINTS;
-
-					data->foamData->points.size = atoi(count++);
-
-					data->foamData->points.expandedSize =
-						data->foamData->points.size * 3;
+			std::string_view type = xmlAttribute(tag, "type");
+			if (!vtpDiskType(type, sec)) {
+				VTKLOG("ERROR:: DataArray {} in {} has unknown type {}", name, index.path, type);
+				return 0;
+			}
+			sec.type = !sec.diskFloat ? TYPE_INT : (sec.diskBytes == 4) ? TYPE_FLOAT : TYPE_DOUBLE;
+			sec.swapBytes = swap;
+
+			std::string_view format = xmlAttribute(tag, "format");
+			size_t start = pos;
+			if (format == "appended") {
+				size_t offset = 0;
+				if (appendedStart == npos || !vtkTokenizer::toNumber(xmlAttribute(tag, "offset"), offset)) {
+					VTKLOG("ERROR:: DataArray {} in {} has no appended data", name, index.path);
+					return 0;
+				}
+				start = appendedStart + offset;
+				sec.encoding = appendedBase64 ? ENCODING_BASE64 : ENCODING_BINARY;
+			}
+			else sec.encoding = (format == "binary") ? ENCODING_BASE64 : ENCODING_ASCII;
+
+			// how many values the block holds: counted for ascii, the length header for binary
+			if (sec.encoding == ENCODING_ASCII) {
+				vtkTokenizer tokens(text.data(), text.data() + tagsEnd);
+				tokens.seek(start);
+				tokens.skipSpace();
+				sec.offset = tokens.offset();
+				sec.count = tokens.skipNumbers(SIZE_MAX);
+				pos = tokens.offset();
+			}
+			else {
+				uint8_t header[8] = {};
+				if (sec.encoding == ENCODING_BINARY) {
+					if (start > text.size() || text.size() - start < (size_t)headerBytes) {
+						VTKLOG("ERROR:: DataArray {} in {} starts past the end of the file", name, index.path);
+						return 0;
+					}
+					memcpy(header, text.data() + start, headerBytes);
+					sec.offset = start + headerBytes;
 				}
 				else {
-					// invalid or wrong polydata point area
-					continue;
+					if (start > text.size() ||
+						base64Decode(text.data() + start, text.data() + text.size(), header, headerBytes) != (size_t)headerBytes) {
+						VTKLOG("ERROR:: DataArray {} in {} has a bad base64 header", name, index.path);
+						return 0;
+					}
+					sec.offset = start;
+					sec.headerBytes = headerBytes;
 				}
+				if (swap) vtkByteSwap(header, headerBytes, 1);
+				uint64_t length = 0;
+				if (headerBytes == 8) memcpy(&length, header, 8);
+				else {
+					uint32_t length32;
+					memcpy(&length32, header, 4);
+					length = length32;
+				}
+				sec.count = (size_t)(length / sec.diskBytes);
 			}
-		}
 
-		if (strstr(data->fileBuffer[i], "DATASET POLYDATA")) currentDataScope = DATASET;
+			// connectivity has no declared size, everything else has to hold its tuples
+			size_t expected = (size_t)sec.numTuples * sec.numComponents;
+			if (sec.name != "LINES" && sec.count != expected) {
+				if (sec.encoding != ENCODING_ASCII && sec.count < expected) {
+					VTKLOG("ERROR:: DataArray {} in {} holds {} values, {} are needed", name, index.path, sec.count, expected);
+					return 0;
+				}
+				VTKLOG("WARNING:: DataArray {} in {} holds {} values, {} are declared", name, index.path, sec.count, expected);
+				// the extra values are never read, nothing past the declared tuples may size a copy
+				sec.count = std::min(sec.count, expected);
+			}
+			sections.push_back(std::move(sec));
+		}
 	}
+	return 1;
 }
 
-template<typename VTKENUM>
-vtkParser::vtkPointDataset vtkParser::getVtkData(VTKENUM dataType, std::string dataName) {
+int vtkParser::getPolyDataset(vtkParseData* data) {
 
-	vtkParser::vtkPointDataset ret;
-	int T = dataType;
-	if (T == DATASET) {
+	for (const vtkSection& sec : data->index->sections) {
+		if (sec.scope != DATASET) continue;
 
+		if (sec.name == "POINTS") {
+			// run the parser for point data in vtk file
+			if (!polyPointSecParse(data, sec)) return 0;
+			data->foamData->depth++;
+		}
+		else if (sec.name == "LINES") {
+			if (!polyLineSecParse(data, sec)) return 0;
+			data->foamData->depth++;
+		}
+	}
+	return 1;
+}
+
+int vtkParser::attributeArraySecParse(vtkSectionIndex& index, const vtkSection& sec, vtkDataArray& array) {
+	VTK_TRACE_ZONE("vtkParser::attributeArraySecParse");
+	size_t count = (size_t)array.numTuples * array.numComponents;
+
+	int ok = 0;
+	if (array.type == TYPE_FLOAT) {
+		array.storage<float>().resize(count);
+		ok = readSectionBlock(index, sec, array.storage<float>().data(), count);
+	}
+	else if (array.type == TYPE_INT) {
+		array.storage<int>().resize(count);
+		ok = readSectionBlock(index, sec, array.storage<int>().data(), count);
+	}
+	else {
+		array.type = TYPE_DOUBLE;
+		array.storage<double>().resize(count);
+		ok = readSectionBlock(index, sec, array.storage<double>().data(), count);
+	}
+	if (!ok) {
+		array = vtkDataArray{};
+		return 0;
 	}
-	else if (T == POINT_DATA) {
+	return 1;
+}
 
+const vtkParser::vtkDataArray* vtkParser::getVtkData(openFoamVtkFileData& data, int dataType,
+	const std::string& dataName) {
+
+	if (dataType != POINT_DATA && dataType != CELL_DATA && dataType != FIELD) {
+		// geometry (POINTS/LINES) is read through openFoamVtkFileData::points / lines
+		return nullptr;
 	}
-	else if (T == CELL_DATA) {
+	// data built in memory (I.E. interpolated between timestamps) has no file left to decode from
+	std::unique_lock<std::mutex> guard;
+	if (data.index != nullptr) guard = std::unique_lock<std::mutex>(data.index->lock);
+
+	for (int scope : { (int)POINT_DATA, (int)CELL_DATA }) {
+		if (dataType != FIELD && dataType != scope) continue;
+		vtkAttributeMap& map = (scope == POINT_DATA) ? data.pointData : data.cellData;
+
+		auto it = map.find(dataName);
+		if (it != map.end()) return &it->second;
+		if (data.index == nullptr) continue;
+		vtkSectionIndex& index = *data.index;
+
+		// first request for this array, decode it straight from its recorded offset
+		for (const vtkSection& sec : index.sections) {
+			if (sec.scope != scope || sec.name != dataName) continue;
+
+			vtkDataArray array;
+			array.name = sec.name;
+			array.type = sec.type;
+			array.numComponents = sec.numComponents;
+			array.numTuples = sec.numTuples;
 
+			if (!attributeArraySecParse(index, sec, array)) return nullptr;
+			return &(map[dataName] = std::move(array));
+		}
 	}
-	else if (T == STRUCTURED_GRID) {
+	return nullptr;
+}
+
+template<typename VTKENUM>
+const vtkParser::vtkDataArray* vtkParser::getVtkData(VTKENUM dataType, std::string dataName) {
+	if (globalVtkData == nullptr || globalVtkData->foamData == nullptr) return nullptr;
+	return getVtkData(*globalVtkData->foamData, (int)dataType, dataName);
+}
+template const vtkParser::vtkDataArray* vtkParser::getVtkData<int>(int, std::string);
+template const vtkParser::vtkDataArray* vtkParser::getVtkData<vtkParser::dataScopes>(
+	vtkParser::dataScopes, std::string);
+template const vtkParser::vtkDataArray* vtkParser::getVtkData<vtkParser::geometryTypes>(
+	vtkParser::geometryTypes, std::string);
+
+int vtkParser::parseOpenFoam() {
+	VTK_TRACE_ZONE("vtkParser::parseOpenFoam");
 
+	// a cache that still matches the source replaces the whole parse
+	std::string cachePath;
+	if (useCache) {
+		cachePath = cachePathFor(VTKFILE, cacheDirectory);
+		if (loadCache(cachePath)) return getPolyDataset(globalVtkData);
 	}
-	else if (T == UNSTRUCTURED_GRID) {
 
+	vtkTokenizer& tokens = globalVtkData->tokens;
+	tokens.seek(0);
+
+	std::string_view first = tokens.peek();
+	if (first.rfind("<?xml", 0) == 0 || first.rfind("<VTKFile", 0) == 0) {
+		if (!scanVtpSections(globalVtkData)) return 0;
 	}
-	else if (T == POLYDATA) {
+	else {
+		// make sure file is readable, legacy header is:
+		// # vtk DataFile Version x.x / title / ASCII|BINARY / DATASET type
+		int encoding = -1;
+		while (!tokens.eof()) {
+			const char* lineStart = tokens.position();
+			std::string_view line = tokens.line();
+			if (line.find("DATASET") != std::string_view::npos) {
+				tokens.seek(lineStart - globalVtkData->index->file.data());
+				break;
+			}
+			while (!line.empty() && vtkTokenizer::isSpace(line.back())) line.remove_suffix(1);
+			if (line == "BINARY") encoding = ENCODING_BINARY;
+			else if (line.find("ASCII") != std::string_view::npos) encoding = ENCODING_ASCII;
+		}
+		if (encoding < 0) {
+			std::cout << "ERROR:: .vtk file is neither ASCII nor BINARY!" << std::endl;
+			return 0;
+		}
+		globalVtkData->encoding = encoding;
+		scanSections(globalVtkData);
+	}
+
+	// every section is indexed once, then the geometry is decoded. POINT_DATA/CELL_DATA
+	// arrays are decoded when they are first asked for through getVtkData
+	if (!getPolyDataset(globalVtkData)) return 0;
+
+	if (useCache && !writeCache(cachePath))
+		VTKLOG("WARNING:: could not write cache {} for {}", cachePath, VTKFILE);
+	return 1;
+}
 
+void vtkParser::setCache(bool enabled, const std::string& directory) {
+	useCache = enabled;
+	cacheDirectory = directory;
+}
+
+std::string vtkParser::cachePathFor(const std::string& source, const std::string& directory) {
+	if (directory.empty()) return source + VTKCACHE_EXTENSION;
+
+	// every timestamp's file is named tracks.vtk, so a shared directory keys on the full path
+	std::error_code err;
+	std::filesystem::path full = std::filesystem::absolute(source, err);
+	std::string key = err ? source : full.string();
+	uint64_t hash = 14695981039346656037ull; // FNV-1a
+	for (unsigned char c : key) {
+		hash ^= c;
+		hash *= 1099511628211ull;
 	}
-	else if (T == STRUCTURED_POINTS) {
+	std::string name = fmt::format("{}.{:016x}{}",
+		std::filesystem::path(source).filename().string(), hash, VTKCACHE_EXTENSION);
+	return (std::filesystem::path(directory) / name).string();
+}
+
+// what a cache is keyed on, a changed size or mtime means the source was rewritten
+static int sourceStamp(const std::string& path, uint64_t& size, int64_t& mtime) {
+	std::error_code err;
+	size = (uint64_t)std::filesystem::file_size(path, err);
+	if (err) return 0;
+	std::filesystem::file_time_type time = std::filesystem::last_write_time(path, err);
+	if (err) return 0;
+	mtime = (int64_t)time.time_since_epoch().count();
+	return 1;
+}
 
+int vtkParser::writeCache(const std::string& cachePath) {
+	VTK_TRACE_ZONE("vtkParser::writeCache");
+	if (globalVtkData == nullptr || globalVtkData->foamData == nullptr) return 0;
+	vtkSectionIndex& index = *globalVtkData->index;
+	openFoamVtkFileData& foam = *globalVtkData->foamData;
+
+	vtkCacheHeader header{};
+	memcpy(header.magic, VTKCACHE_MAGIC, sizeof(header.magic));
+	header.version = VTKCACHE_VERSION;
+	header.byteOrder = VTKCACHE_BYTEORDER;
+	if (!sourceStamp(index.path, header.sourceSize, header.sourceMTime)) return 0;
+
+	// records describe the decoded form, which is what the cache holds
+	std::vector<vtkCacheRecord> records;
+	std::vector<const vtkSection*> sources;
+	for (const vtkSection& sec : index.sections) {
+		// .vtp line offsets are already folded into the CSR LINES record
+		if (sec.scope == DATASET && sec.name == "OFFSETS") continue;
+		vtkCacheRecord rec{};
+		if (sec.name.size() >= VTKCACHE_NAMESIZE) {
+			VTKLOG("ERROR:: array name {} in {} is too long to cache", sec.name, index.path);
+			return 0;
+		}
+		memcpy(rec.name, sec.name.data(), sec.name.size());
+		rec.scope = sec.scope;
+		rec.numComponents = sec.numComponents;
+		rec.numTuples = sec.numTuples;
+
+		if (sec.scope == DATASET && sec.name == "POINTS") {
+			rec.type = foam.points.type;
+			rec.count = (uint64_t)foam.points.expandedSize;
+		}
+		else if (sec.scope == DATASET && sec.name == "LINES") {
+			rec.type = TYPE_INT;
+			rec.count = foam.lines.offsets.size() + foam.lines.indices.size();
+		}
+		else {
+			// what attributeArraySecParse decodes, the section may hold more or fewer values
+			rec.type = (sec.type == TYPE_FLOAT || sec.type == TYPE_INT) ? sec.type : TYPE_DOUBLE;
+			rec.count = (uint64_t)sec.numTuples * sec.numComponents;
+		}
+		records.push_back(rec);
+		sources.push_back(&sec);
 	}
-	else if (T == RECTILINEAR_GRID) {
+	header.sectionCount = (uint32_t)records.size();
 
+	size_t offset = sizeof(header) + records.size() * sizeof(vtkCacheRecord);
+	for (vtkCacheRecord& rec : records) {
+		offset = (offset + VTKCACHE_ALIGN - 1) / VTKCACHE_ALIGN * VTKCACHE_ALIGN;
+		rec.offset = offset;
+		offset += rec.count * valueTypeSize(rec.type);
 	}
-	else if (T == FIELD) {
 
+	std::error_code err;
+	std::filesystem::path dir = std::filesystem::path(cachePath).parent_path();
+	if (!dir.empty()) std::filesystem::create_directories(dir, err);
+
+	/* written beside the final name and renamed, a reader never maps a half written cache.
+	 * Every writer gets its own temp file, two tasks (or two processes sharing
+	 * vtkparsecachedir) caching the same source just race on the rename.
+	 */
+	static const uint64_t processTag = ((uint64_t)std::random_device{}() << 32) | std::random_device{}();
+	static std::atomic<uint64_t> writerCount{ 0 };
+	std::string tmpPath = fmt::format("{}.{:x}.{}.tmp", cachePath, processTag, writerCount++);
+	FILE* out = fopen(tmpPath.c_str(), "wbx");
+	if (out == nullptr) return 0;
+
+	size_t written = 0;
+	bool ok = true;
+	auto put = [&](const void* bytes, size_t size) {
+		if (ok && size > 0 && fwrite(bytes, 1, size, out) != size) ok = false;
+		written += size;
+	};
+	static const char zeros[VTKCACHE_ALIGN] = {};
+
+	put(&header, sizeof(header));
+	put(records.data(), records.size() * sizeof(vtkCacheRecord));
+	for (size_t i = 0; i < records.size() && ok; i++) {
+		const vtkCacheRecord& rec = records[i];
+		const vtkSection& sec = *sources[i];
+		put(zeros, rec.offset - written);
+
+		if (sec.scope == DATASET && sec.name == "POINTS") {
+			if (foam.points.type == TYPE_FLOAT) put(foam.points.packed<float>().data(), rec.count * sizeof(float));
+			else put(foam.points.packed<double>().data(), rec.count * sizeof(double));
+		}
+		else if (sec.scope == DATASET && sec.name == "LINES") {
+			put(foam.lines.offsets.data(), foam.lines.offsets.size() * sizeof(int));
+			put(foam.lines.indices.data(), foam.lines.indices.size() * sizeof(int));
+		}
+		else {
+			// arrays nobody asked for yet are decoded one at a time and dropped again
+			vtkAttributeMap& map = (sec.scope == POINT_DATA) ? foam.pointData : foam.cellData;
+			auto it = map.find(sec.name);
+			vtkDataArray decoded;
+			const vtkDataArray* array = (it != map.end()) ? &it->second : nullptr;
+			if (array == nullptr) {
+				decoded.name = sec.name;
+				decoded.type = sec.type;
+				decoded.numComponents = sec.numComponents;
+				decoded.numTuples = sec.numTuples;
+				if (!attributeArraySecParse(index, sec, decoded)) ok = false;
+				array = &decoded;
+			}
+			auto putValues = [&](const auto& values) {
+				if (values.size() != rec.count) ok = false;
+				else put(values.data(), values.size() * sizeof(values[0]));
+			};
+			if (!ok) break;
+			if (array->type == TYPE_FLOAT) putValues(array->values<float>());
+			else if (array->type == TYPE_INT) putValues(array->values<int>());
+			else putValues(array->values<double>());
+		}
 	}
+	if (fclose(out) != 0) ok = false;
 
-	return ret;
+	if (ok) std::filesystem::rename(tmpPath, cachePath, err);
+	if (!ok || err) {
+		std::filesystem::remove(tmpPath, err);
+		return 0;
+	}
+	return 1;
 }
-template vtkParser::vtkPointDataset vtkParser::getVtkData<int>(int, std::string);
-template vtkParser::vtkPointDataset vtkParser::getVtkData<vtkParser::dataScopes>(
-	vtkParser::dataScopes, std::string);
-template vtkParser::vtkPointDataset vtkParser::getVtkData<vtkParser::geometryTypes>(
-	vtkParser::geometryTypes, std::string);
 
-int vtkParser::parseOpenFoam() {
-	int isASCII = 0;
-	int i;
-	// make sure file is readable
-	for (i = 0; i < globalVtkData->lineCount; i++) {
-		if (strstr(globalVtkData->fileBuffer[i], "ASCII")) isASCII = 1;
-		if (strstr(globalVtkData->fileBuffer[i], "DATASET POLYDATA")) break;
+int vtkParser::loadCache(const std::string& cachePath) {
+	VTK_TRACE_ZONE("vtkParser::loadCache");
+	if (globalVtkData == nullptr) return 0;
+	vtkSectionIndex& index = *globalVtkData->index;
+
+	std::error_code err;
+	if (!std::filesystem::exists(cachePath, err)) return 0;
+
+	vtkMappedFile cache;
+	if (!cache.open(cachePath) || cache.size() < sizeof(vtkCacheHeader)) return 0;
+
+	vtkCacheHeader header;
+	memcpy(&header, cache.data(), sizeof(header));
+	if (memcmp(header.magic, VTKCACHE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != VTKCACHE_VERSION || header.byteOrder != VTKCACHE_BYTEORDER) {
+		VTKLOG("INFO:: {} was written by another version, reparsing {}", cachePath, index.path);
+		return 0;
 	}
-	if (!isASCII) {
-		std::cout << "ERROR:: .vtk file is not ASCII readable!" << std::endl;
+
+	uint64_t sourceSize;
+	int64_t sourceMTime;
+	if (!sourceStamp(index.path, sourceSize, sourceMTime) ||
+		sourceSize != header.sourceSize || sourceMTime != header.sourceMTime) return 0;
+
+	size_t tableEnd = sizeof(header) + (size_t)header.sectionCount * sizeof(vtkCacheRecord);
+	if (tableEnd > cache.size()) {
+		VTKLOG("ERROR:: cache {} is truncated", cachePath);
 		return 0;
 	}
 
-	// get poly data and put it into the foamData struct
-	/*globalVtkData->foamData->points =
-		vtkParser::getVtkData<vtkParser::dataScopes>(DATASET, "POINTS");
-	globalVtkData->foamData->lines =
-		vtkParser::getVtkData<vtkParser::dataScopes>(DATASET, "LINES");
-	globalVtkData->foamData->u_velocity =
-		vtkParser::getVtkData<vtkParser::dataScopes>(POINT_DATA, "U");*/
+	std::vector<vtkSection> sections;
+	sections.reserve(header.sectionCount);
+	for (uint32_t i = 0; i < header.sectionCount; i++) {
+		vtkCacheRecord rec;
+		memcpy(&rec, cache.data() + sizeof(header) + i * sizeof(vtkCacheRecord), sizeof(rec));
+		rec.name[VTKCACHE_NAMESIZE - 1] = '\0';
 
-		// this is temporary while I work on getVtkData
-	getPolyDataset(globalVtkData);
+		if (rec.offset < tableEnd || rec.offset > cache.size() ||
+			rec.count > (cache.size() - rec.offset) / valueTypeSize(rec.type)) {
+			VTKLOG("ERROR:: cache {} is truncated", cachePath);
+			return 0;
+		}
+
+		vtkSection sec;
+		sec.name = rec.name;
+		sec.scope = rec.scope;
+		sec.type = (valueTypes)rec.type;
+		sec.numComponents = rec.numComponents;
+		sec.numTuples = rec.numTuples;
+		sec.count = (size_t)rec.count;
+		sec.offset = (size_t)rec.offset;
+		sec.encoding = ENCODING_RAW;
+		sections.push_back(std::move(sec));
+	}
 
+	// from here on every section is read out of the cache mapping, the text is never touched
+	index.file = std::move(cache);
+	index.sections = std::move(sections);
+	globalVtkData->tokens = vtkTokenizer();
 	return 1;
 }
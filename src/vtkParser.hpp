@@ -5,17 +5,24 @@
 
 #include <iostream>
 #include <vector>
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <type_traits>
+#include <cmath>
+#include <string_view>
+
+#include "vtkTokenizer.hpp"
+#include "vtkTrace.hpp"
 
 #if defined __APPLE__
 #define FMT_HEADER_ONLY
 #endif
 #include <fmt/core.h>
 
-#define MAXLINESIZE 256
-#define MAXFILELINES 100000
-
 #define POLYDATANSIZE 3
-#define MAXPOLY 100000
 
 #define VTKASSERT(err, ...) \
 	if (!(err)) { fprintf(stderr, __VA_ARGS__); exit(1); }
@@ -44,23 +51,222 @@ public:
 		FIELD
 	};
 
+	// value types a legacy vtk section can declare I.E. POINTS 104 float
+	enum valueTypes {
+		TYPE_UNKNOWN,
+		TYPE_FLOAT,
+		TYPE_DOUBLE,
+		TYPE_INT
+	};
+	static valueTypes valueTypeFromName(std::string_view name);
+	// bytes per value as held in memory, TYPE_UNKNOWN is held as double
+	static size_t valueTypeSize(int type);
+
+	// how a section's values are stored in the mapped file
+	enum sectionEncodings {
+		ENCODING_ASCII, // whitespace separated text, legacy .vtk and ascii .vtp arrays
+		ENCODING_RAW, // native binary exactly as held in memory, the sidecar cache
+		ENCODING_BINARY, // fixed width values as the file stores them, BINARY .vtk and raw appended .vtp
+		ENCODING_BASE64 // ENCODING_BINARY base64 encoded behind a length header, .vtp binary/appended
+	};
+
 	struct vtkPoint {
 		float x, y, z;
 	};
-	struct vtkLine {
-		std::vector<int> indecies;
+	// one streamline: indices into the POINTS dataset
+	typedef std::span<const int> vtkLine;
+
+	/* LINES connectivity in compressed sparse row form.
+	 * Line i is indices[offsets[i] .. offsets[i + 1]), so a whole file costs
+	 * two allocations no matter how many streamlines it holds.
+	 */
+	struct vtkPolylineIndex {
+		std::vector<int> offsets; // size() + 1 entries, offsets[0] == 0
+		std::vector<int> indices;
+
+		size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+		bool empty() const { return size() == 0; }
+		size_t totalPoints() const { return indices.size(); }
+
+		vtkLine operator[](size_t i) const {
+			return vtkLine(indices.data() + offsets[i], offsets[i + 1] - offsets[i]);
+		}
+
+		class iterator {
+		public:
+			iterator(const vtkPolylineIndex* index, size_t line) : index(index), line(line) {}
+			vtkLine operator*() const { return (*index)[line]; }
+			iterator& operator++() { line++; return *this; }
+			bool operator!=(const iterator& other) const { return line != other.line; }
+			bool operator==(const iterator& other) const { return line == other.line; }
+		private:
+			const vtkPolylineIndex* index;
+			size_t line;
+		};
+		iterator begin() const { return iterator(this, 0); }
+		iterator end() const { return iterator(this, size()); }
+
+		void clear() {
+			offsets.clear();
+			indices.clear();
+		}
 	};
 
-	typedef struct {
-		std::vector<std::vector<double> > polyData;
-		int size; // the 104 number in the .vtk file: POINTS 104 float
-		int expandedSize; //  104 * 3 = 312 : expanded
-	} vtkPointDataset; // DATASET scope followed by POINTS scope
+	template<typename T>
+	struct vtkPointBuffer {
+		std::vector<T> packed; // AoS: x0 y0 z0 x1 y1 z1 ...
+		std::vector<T> x, y, z; // SoA
+	};
+
+	/* Contiguous point storage in the type the file declared (float or double).
+	 * Both a packed AoS view (GPU upload) and SoA views (SIMD kernels) are kept,
+	 * asking for the type the dataset doesn't hold returns empty spans.
+	 */
+	struct vtkPointDataset { // DATASET scope followed by POINTS scope
+		valueTypes type = TYPE_UNKNOWN;
+		int size = 0; // the 104 number in the .vtk file: POINTS 104 float
+		int expandedSize = 0; //  104 * 3 = 312 : expanded
+
+		template<typename T> std::span<const T> packed() const { return buffer<T>().packed; }
+		template<typename T> std::span<const T> x() const { return buffer<T>().x; }
+		template<typename T> std::span<const T> y() const { return buffer<T>().y; }
+		template<typename T> std::span<const T> z() const { return buffer<T>().z; }
+
+		vtkPoint point(int i) const {
+			if (type == TYPE_DOUBLE)
+				return { (float)f64.x[i], (float)f64.y[i], (float)f64.z[i] };
+			return { f32.x[i], f32.y[i], f32.z[i] };
+		}
+
+		// takes a packed x y z array and builds the SoA columns from it
+		template<typename T>
+		void assign(std::vector<T>&& packedXYZ) {
+			static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>);
+			clear();
+			vtkPointBuffer<T>& buf = buffer<T>();
+			size = (int)(packedXYZ.size() / 3);
+			expandedSize = size * 3;
+			type = std::is_same_v<T, float> ? TYPE_FLOAT : TYPE_DOUBLE;
+			buf.packed = std::move(packedXYZ);
+			buf.x.resize(size);
+			buf.y.resize(size);
+			buf.z.resize(size);
+			const T* src = buf.packed.data();
+			for (int i = 0; i < size; i++) {
+				buf.x[i] = src[i * 3 + 0];
+				buf.y[i] = src[i * 3 + 1];
+				buf.z[i] = src[i * 3 + 2];
+			}
+		}
+
+		void clear() {
+			f32 = vtkPointBuffer<float>{};
+			f64 = vtkPointBuffer<double>{};
+			type = TYPE_UNKNOWN;
+			size = expandedSize = 0;
+		}
+
+		bool empty() const { return size == 0; }
+
+	private:
+		vtkPointBuffer<float> f32;
+		vtkPointBuffer<double> f64;
+
+		template<typename T> vtkPointBuffer<T>& buffer() {
+			if constexpr (std::is_same_v<T, float>) return f32; else return f64;
+		}
+		template<typename T> const vtkPointBuffer<T>& buffer() const {
+			if constexpr (std::is_same_v<T, float>) return f32; else return f64;
+		}
+	};
+
+	/* One attribute array (FIELD array, SCALARS or VECTORS) stored as a
+	 * contiguous tuple major column in the type the file declared.
+	 * I.E. "U 3 12065 float" is 12065 tuples of 3 floats: u0 v0 w0 u1 v1 w1 ...
+	 */
+	struct vtkDataArray {
+		std::string name;
+		valueTypes type = TYPE_UNKNOWN;
+		int numComponents = 0;
+		int numTuples = 0;
+
+		// zero copy view, empty when T isn't the type the array holds
+		template<typename T> std::span<const T> values() const {
+			if constexpr (std::is_same_v<T, float>) return f32;
+			else if constexpr (std::is_same_v<T, double>) return f64;
+			else return i32;
+		}
+		template<typename T> std::vector<T>& storage() {
+			if constexpr (std::is_same_v<T, float>) return f32;
+			else if constexpr (std::is_same_v<T, double>) return f64;
+			else return i32;
+		}
+
+		double value(int tuple, int component = 0) const {
+			size_t i = (size_t)tuple * numComponents + component;
+			if (type == TYPE_FLOAT) return f32[i];
+			if (type == TYPE_DOUBLE) return f64[i];
+			return i32[i];
+		}
+		// euclidean length of a tuple, |U| for velocity
+		double magnitude(int tuple) const {
+			double sum = 0.0;
+			for (int c = 0; c < numComponents; c++) {
+				double v = value(tuple, c);
+				sum += v * v;
+			}
+			return std::sqrt(sum);
+		}
+
+		size_t byteSize() const {
+			return f32.size() * sizeof(float) + f64.size() * sizeof(double) + i32.size() * sizeof(int);
+		}
+
+	private:
+		std::vector<float> f32;
+		std::vector<double> f64;
+		std::vector<int> i32;
+	};
+
+	// attribute arrays of one scope (POINT_DATA or CELL_DATA) by name
+	typedef std::unordered_map<std::string, vtkDataArray> vtkAttributeMap;
+
+	// where one section's values live in the file, recorded by the up front scan
+	struct vtkSection {
+		std::string name; // POINTS, LINES or the attribute array name
+		int scope = NONE; // dataScopes: DATASET, POINT_DATA or CELL_DATA
+		valueTypes type = TYPE_UNKNOWN;
+		int numComponents = 0;
+		int numTuples = 0; // points, lines or attribute tuples
+		size_t count = 0; // values in the block
+		size_t offset = 0; // byte offset of the first value
+		int encoding = ENCODING_ASCII;
+
+		// ENCODING_BINARY / ENCODING_BASE64: one value as stored in the file
+		int diskBytes = 0; // 1, 2, 4 or 8
+		bool diskFloat = false;
+		bool diskSigned = true;
+		bool swapBytes = false; // stored in the other byte order
+		int headerBytes = 0; // ENCODING_BASE64: the decoded length prefix to skip, 4 or 8
+	};
+
+	/* The mapped file and its section table. Shared by every copy of a file's
+	 * openFoamVtkFileData so attribute arrays can still be decoded on first use
+	 * after the parser that scanned the file is gone.
+	 */
+	struct vtkSectionIndex {
+		std::string path;
+		vtkMappedFile file;
+		std::vector<vtkSection> sections;
+		std::mutex lock; // guards lazy decoding into pointData/cellData
+	};
 
 	typedef struct {
 		vtkPointDataset points;
-		std::vector<vtkParser::vtkLine> lines;
-		vtkPointDataset u_velocity;
+		vtkPolylineIndex lines;
+		vtkAttributeMap pointData; // POINT_DATA arrays I.E. age, p, k, U, filled on first request
+		vtkAttributeMap cellData; // CELL_DATA arrays, filled on first request
+		std::shared_ptr<vtkSectionIndex> index;
 
 		int depth;
 		//std::vector<std::vector<double> > polyDataset;
@@ -78,12 +284,31 @@ public:
 	int init();
 	int parseOpenFoam();
 
-	// Enum Template so user can use geometryTypes, dataScopes, or just an int
+	/* Enum Template so user can use geometryTypes, dataScopes, or just an int
+	 * I.E. getVtkData(POINT_DATA, "U"). Returns nullptr if there is no such array,
+	 * the pointer is owned by the parser and lives until freeVtkData().
+	 * Arrays are decoded from the file the first time they are asked for.
+	 */
 	template<typename VTKENUM>
-	vtkPointDataset getVtkData(VTKENUM dataType, std::string dataName);
+	const vtkDataArray* getVtkData(VTKENUM dataType, std::string dataName);
+	// same lookup for data already taken out of a parser, the pointer lives as long as data
+	static const vtkDataArray* getVtkData(openFoamVtkFileData& data, int dataType, const std::string& dataName);
 	void dumpOFOAMPolyDataset();
 
+	/* Binary sidecar cache (points, CSR lines and every attribute array).
+	 * With it enabled parseOpenFoam maps the cache instead of parsing when its
+	 * header matches the source's size and mtime, and writes a new one after
+	 * parsing when it doesn't. An empty directory keeps the cache next to the source.
+	 */
+	void setCache(bool enabled, const std::string& directory = "");
+	static std::string cachePathFor(const std::string& source, const std::string& directory = "");
+	int writeCache(const std::string& cachePath);
+	// 0 when there is no cache or it is stale, the source is parsed instead
+	int loadCache(const std::string& cachePath);
+
 	openFoamVtkFileData getOpenFoamData();
+	// moves the parsed data out instead of copying it, the parser is left empty
+	openFoamVtkFileData releaseOpenFoamData();
 
 private:
 	// has to be std string instead of ptr because of local ptr return garbage.
@@ -100,24 +325,54 @@ private:
 	};
 
 	typedef struct {
-		char fileBuffer[MAXFILELINES][MAXLINESIZE];
-		int lineCount;
+		std::shared_ptr<vtkSectionIndex> index; // mapped file + section table
+		vtkTokenizer tokens;
 		openFoamVtkFileData* foamData;
 
 		int currentScope; // EX: DATASET POLYDATA
 		int currentSubScope; // EX: POINT_DATA
+		int encoding; // ENCODING_ASCII or ENCODING_BINARY, from the legacy header
 	} vtkParseData;
 
-	vtkParseData* globalVtkData;
+	vtkParseData* globalVtkData = nullptr;
+
+	bool useCache = false;
+	std::string cacheDirectory;
+
+	/* Reads exactly count values from the current tokenizer position into out.
+	 * Logs and returns 0 when the data holds fewer or more values than the
+	 * section header declared.
+	 */
+	template<typename T>
+	static int readNumericBlock(vtkTokenizer& tokens, T* out, size_t count,
+		const char* section, const std::string& file);
+
+	/* Fills out with a section's count values, parsed for ASCII sections and
+	 * copied straight out of the mapping for RAW ones. T has to be the
+	 * section's in memory type.
+	 */
+	template<typename T>
+	static int readSectionBlock(vtkSectionIndex& index, const vtkSection& sec, T* out, size_t count);
 
-	std::vector<std::string> tokenizeDataLine(char* currentLine);
+	// reads the POINTS section
+	int polyPointSecParse(vtkParseData* data, const vtkSection& sec);
+	// reads a LINES <count> <size> section into the CSR polyline index
+	int polyLineSecParse(vtkParseData* data, const vtkSection& sec);
+	// reads the values of one attribute array whose header is already in array
+	static int attributeArraySecParse(vtkSectionIndex& index, const vtkSection& sec, vtkDataArray& array);
 
-	void polyPointSecParse(vtkParseData* data, int line);
-	/* This function needs changed in future:
-	 * vtk datasets are defined by (name) value type I.E. POINTS 104 float.
-	 * this function is only catering to the polyData when it could grab everything for later use.
-	 * */
-	void getPolyDataset(vtkParseData* data);
+	/* One pass over the file recording every section (POINTS, LINES, each
+	 * FIELD/SCALARS/VECTORS array) with its byte offset, count and type.
+	 * Data blocks are skipped, nothing is decoded.
+	 */
+	void scanSections(vtkParseData* data);
+	/* The same section table for an XML PolyData (.vtp) file: Points, the
+	 * Lines connectivity/offsets and the PointData/CellData arrays, inline ascii,
+	 * inline base64 or raw/base64 appended. Returns 0 for what can't be read.
+	 */
+	int scanVtpSections(vtkParseData* data);
+	// decodes POINTS and LINES from the section table, attribute arrays stay lazy
+	int getPolyDataset(vtkParseData* data);
 };
 
 #endif
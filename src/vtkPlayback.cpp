@@ -0,0 +1,188 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VTK_LERP_SSE2 1
+#endif
+
+#include "vtkPlayback.hpp"
+
+vtkPlaybackClock::vtkPlaybackClock(int timeStampCount, double rate)
+	: count(std::max(timeStampCount, 0)), rate(rate), position(0.0), playing(false),
+	lastUpdate(clock::now()) {}
+
+void vtkPlaybackClock::setCount(int timeStampCount) {
+	count = std::max(timeStampCount, 0);
+	scrub(position);
+}
+
+void vtkPlaybackClock::play() {
+	if (playing) return;
+	playing = true;
+	// the time spent paused isn't played back
+	lastUpdate = clock::now();
+}
+
+void vtkPlaybackClock::pause() {
+	playing = false;
+}
+
+void vtkPlaybackClock::step(int delta) {
+	scrub((double)(getIndex() + delta));
+}
+
+void vtkPlaybackClock::scrub(double to) {
+	if (count == 0 || !std::isfinite(to)) {
+		position = 0.0;
+		return;
+	}
+	position = std::fmod(to, (double)count);
+	if (position < 0.0) position += count;
+	// fmod of a value just under a multiple of count can round up to count
+	if (position >= count) position = 0.0;
+}
+
+void vtkPlaybackClock::update() {
+	clock::time_point now = clock::now();
+	double seconds = std::chrono::duration<double>(now - lastUpdate).count();
+	lastUpdate = now;
+	if (playing) advance(seconds);
+}
+
+void vtkPlaybackClock::advance(double seconds) {
+	scrub(position + seconds * rate);
+}
+
+int vtkPlaybackClock::getIndex() const {
+	return std::min((int)position, std::max(count - 1, 0));
+}
+
+float vtkPlaybackClock::getFraction() const {
+	return (float)(position - getIndex());
+}
+
+void vtkLerp(const float* a, const float* b, float t, float* out, size_t count) {
+	size_t i = 0;
+#ifdef VTK_LERP_SSE2
+	__m128 vt = _mm_set1_ps(t);
+	for (; i + 4 <= count; i += 4) {
+		__m128 va = _mm_loadu_ps(a + i);
+		__m128 vb = _mm_loadu_ps(b + i);
+		_mm_storeu_ps(out + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), vt)));
+	}
+#endif
+	for (; i < count; i++) out[i] = a[i] + (b[i] - a[i]) * t;
+}
+
+void vtkLerp(const double* a, const double* b, double t, double* out, size_t count) {
+	size_t i = 0;
+#ifdef VTK_LERP_SSE2
+	__m128d vt = _mm_set1_pd(t);
+	for (; i + 2 <= count; i += 2) {
+		__m128d va = _mm_loadu_pd(a + i);
+		__m128d vb = _mm_loadu_pd(b + i);
+		_mm_storeu_pd(out + i, _mm_add_pd(va, _mm_mul_pd(_mm_sub_pd(vb, va), vt)));
+	}
+#endif
+	for (; i < count; i++) out[i] = a[i] + (b[i] - a[i]) * t;
+}
+
+bool vtkSameTopology(const vtkParser::openFoamVtkFileData& a, const vtkParser::openFoamVtkFileData& b) {
+	return a.points.size == b.points.size && a.points.type == b.points.type &&
+		a.lines.offsets == b.lines.offsets && a.lines.indices == b.lines.indices;
+}
+
+namespace {
+	template<typename T>
+	void lerpPoints(const vtkParser::vtkPointDataset& a, const vtkParser::vtkPointDataset& b, float t,
+		vtkParser::vtkPointDataset& out) {
+		std::span<const T> pa = a.packed<T>(), pb = b.packed<T>();
+		std::vector<T> packed(pa.size());
+		vtkLerp(pa.data(), pb.data(), (T)t, packed.data(), packed.size());
+		out.assign(std::move(packed));
+	}
+
+	template<typename T>
+	void lerpArray(const vtkParser::vtkDataArray& a, const vtkParser::vtkDataArray& b, float t,
+		vtkParser::vtkDataArray& out) {
+		std::span<const T> va = a.values<T>(), vb = b.values<T>();
+		std::vector<T>& values = out.storage<T>();
+		values.resize(va.size());
+		vtkLerp(va.data(), vb.data(), (T)t, values.data(), values.size());
+	}
+}
+
+int vtkInterpolateTimeStamps(vtkParser::openFoamVtkFileData& a, vtkParser::openFoamVtkFileData& b,
+	float t, const char* field, vtkParser::openFoamVtkFileData& out) {
+
+	if (!vtkSameTopology(a, b)) return 0;
+
+	out.points.clear();
+	out.lines.clear();
+	out.pointData.clear();
+	out.cellData.clear();
+	out.index = nullptr;
+	out.depth = a.depth;
+
+	if (a.points.type == vtkParser::TYPE_DOUBLE) lerpPoints<double>(a.points, b.points, t, out.points);
+	else lerpPoints<float>(a.points, b.points, t, out.points);
+
+	if (field == nullptr) return 1;
+	const vtkParser::vtkDataArray* fa = vtkParser::getVtkData(a, vtkParser::POINT_DATA, field);
+	const vtkParser::vtkDataArray* fb = vtkParser::getVtkData(b, vtkParser::POINT_DATA, field);
+	if (fa == nullptr || fb == nullptr || fa->type != fb->type ||
+		fa->numComponents != fb->numComponents || fa->numTuples != fb->numTuples) return 1;
+
+	vtkParser::vtkDataArray& blended = out.pointData[field];
+	blended.name = fa->name;
+	blended.type = fa->type;
+	blended.numComponents = fa->numComponents;
+	blended.numTuples = fa->numTuples;
+	if (fa->type == vtkParser::TYPE_FLOAT) lerpArray<float>(*fa, *fb, t, blended);
+	else if (fa->type == vtkParser::TYPE_DOUBLE) lerpArray<double>(*fa, *fb, t, blended);
+	else out.pointData.erase(field); // integer arrays don't blend
+	return 1;
+}
+
+int vtkLerpMeshVertices(const vtkStreamlineMesh& a, const vtkStreamlineMesh& b, float t, vtkStreamlineMesh& out) {
+	if (a.primitive != b.primitive || a.positions.size() != b.positions.size() ||
+		a.normals.size() != b.normals.size() || a.colours.size() != b.colours.size()) return 0;
+	out.primitive = a.primitive;
+	out.positions.resize(a.positions.size());
+	out.normals.resize(a.normals.size());
+	out.colours.resize(a.colours.size());
+	vtkLerp(a.positions.data(), b.positions.data(), t, out.positions.data(), out.positions.size());
+	vtkLerp(a.normals.data(), b.normals.data(), t, out.normals.data(), out.normals.size());
+	for (size_t i = 0; i < out.colours.size(); i++)
+		out.colours[i] = (uint8_t)(a.colours[i] + (b.colours[i] - a.colours[i]) * t + 0.5f);
+	return 1;
+}
+
+std::vector<std::string> vtkListTimeStamps(const std::string& caseDir) {
+	std::vector<std::pair<double, std::string> > times;
+	std::error_code err;
+	for (auto it = std::filesystem::recursive_directory_iterator(caseDir, err);
+		it != std::filesystem::recursive_directory_iterator(); it.increment(err)) {
+		if (err) break;
+		if (!it->is_directory(err)) continue;
+		std::string name = it->path().filename().string();
+		double time;
+		auto [end, ec] = std::from_chars(name.data(), name.data() + name.size(), time);
+		if (ec != std::errc() || end != name.data() + name.size()) continue;
+		times.push_back({ time, name });
+	}
+
+	std::stable_sort(times.begin(), times.end(),
+		[](const auto& a, const auto& b) { return a.first < b.first; });
+	times.erase(std::unique(times.begin(), times.end(),
+		[](const auto& a, const auto& b) { return a.first == b.first; }), times.end());
+
+	std::vector<std::string> names;
+	for (auto& time : times) names.push_back(std::move(time.second));
+	return names;
+}
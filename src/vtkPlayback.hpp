@@ -0,0 +1,89 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#ifndef VTK_PLAYBACK_HPP
+#define VTK_PLAYBACK_HPP
+
+#include <chrono>
+
+#include "vtkParser.hpp"
+#include "vtkStreamlineMesh.hpp"
+
+/* Wall clock playback position over a run of timestamps.
+ * The position is in timestamps, I.E. 2.25 is a quarter of the way from
+ * timestamp 2 to 3, and advances by rate timestamps per second of
+ * steady_clock time so playback speed doesn't depend on CPU load.
+ * It wraps from the last timestamp back to the first.
+ */
+class vtkPlaybackClock {
+public:
+	typedef std::chrono::steady_clock clock;
+
+	vtkPlaybackClock(int timeStampCount = 0, double rate = 1.0);
+
+	void setCount(int timeStampCount);
+	int getCount() const { return count; }
+
+	void play();
+	void pause();
+	bool isPlaying() const { return playing; }
+
+	// timestamps per second, negative plays backwards
+	void setRate(double timeStampsPerSecond) { rate = timeStampsPerSecond; }
+	double getRate() const { return rate; }
+
+	// moves delta whole timestamps from the current one, dropping any fraction
+	void step(int delta);
+	// jumps to position, wrapped into [0, count)
+	void scrub(double position);
+
+	// advances by the wall time since the last update, call once per frame
+	void update();
+	// advances by seconds of playback, what update() does with the measured time
+	void advance(double seconds);
+
+	double getPosition() const { return position; }
+	int getIndex() const;
+	// how far the position is from getIndex() towards getIndex() + 1, [0, 1)
+	float getFraction() const;
+
+private:
+	int count;
+	double rate;
+	double position;
+	bool playing;
+	clock::time_point lastUpdate;
+};
+
+/* out = a + (b - a) * t over count values, vectorised with SSE where the
+ * target has it. out may alias a or b.
+ */
+void vtkLerp(const float* a, const float* b, float t, float* out, size_t count);
+void vtkLerp(const double* a, const double* b, double t, double* out, size_t count);
+
+/* Timestamps interpolate only when they share a topology: the same number of
+ * points joined into the same lines, so point i of one is point i of the other.
+ */
+bool vtkSameTopology(const vtkParser::openFoamVtkFileData& a, const vtkParser::openFoamVtkFileData& b);
+
+/* Fills out with the points of a and b and their POINT_DATA array field
+ * (when both hold it with the same shape) blended by t. Lines are left empty,
+ * the caller draws out with the line index of a. Returns 0 when the
+ * topologies differ.
+ */
+int vtkInterpolateTimeStamps(vtkParser::openFoamVtkFileData& a, vtkParser::openFoamVtkFileData& b,
+	float t, const char* field, vtkParser::openFoamVtkFileData& out);
+
+/* Vertex attributes of out (positions, normals, colours) blended by t from two
+ * meshes built along the same lines for timestamps of the same topology, so
+ * only their vertices differ. Indices are left alone, the caller keeps the
+ * ones of a. Returns 0 when the vertex layouts differ.
+ */
+int vtkLerpMeshVertices(const vtkStreamlineMesh& a, const vtkStreamlineMesh& b, float t, vtkStreamlineMesh& out);
+
+/* Names of the numeric directories anywhere under caseDir in time order.
+ * A time found both at the case root and under postProcessing/streamlines
+ * is listed once, as are 100 and 100.0.
+ */
+std::vector<std::string> vtkListTimeStamps(const std::string& caseDir);
+
+#endif
@@ -0,0 +1,153 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#include "vtkPointCloud.hpp"
+#include "vtkGLShader.hpp"
+#include "vtkStreamlineMesh.hpp"
+#include "Mat4.h"
+
+using namespace Aftr;
+
+GLuint MGLvtkPointCloud::program = 0;
+GLint MGLvtkPointCloud::mvpLocation = -1;
+
+static const char* pointCloudVertexShader =
+	"#version 330 core\n"
+	"layout(location = 0) in vec3 position;\n"
+	"layout(location = 1) in float size;\n"
+	"layout(location = 2) in vec4 colour;\n"
+	"uniform mat4 mvp;\n"
+	"out vec4 pointColour;\n"
+	"void main() {\n"
+	"	gl_Position = mvp * vec4(position, 1.0);\n"
+	"	gl_PointSize = size;\n"
+	"	pointColour = colour;\n"
+	"}\n";
+
+// cuts the square point sprite down to a disc
+static const char* pointCloudFragmentShader =
+	"#version 330 core\n"
+	"in vec4 pointColour;\n"
+	"out vec4 fragColour;\n"
+	"void main() {\n"
+	"	vec2 d = gl_PointCoord - vec2(0.5);\n"
+	"	if (dot(d, d) > 0.25) discard;\n"
+	"	fragColour = pointColour;\n"
+	"}\n";
+
+MGLvtkPointCloud* MGLvtkPointCloud::New(WO* parentWO) {
+	return new MGLvtkPointCloud(parentWO);
+}
+
+MGLvtkPointCloud::MGLvtkPointCloud(WO* parentWO)
+	: MGL(parentWO), dirty(false), vao(0), vbo(0), uploadedCount(0) {}
+
+MGLvtkPointCloud::~MGLvtkPointCloud() {
+	if (vbo != 0) glDeleteBuffers(1, &vbo);
+	if (vao != 0) glDeleteVertexArrays(1, &vao);
+}
+
+void MGLvtkPointCloud::setPoints(std::vector<vtkPointVertex>&& points) {
+	vertices = std::move(points);
+	dirty = true;
+}
+
+void MGLvtkPointCloud::setSpatialIndex(std::shared_ptr<const vtkStreamlineSpatialIndex> index,
+	std::vector<int> offsets) {
+	spatial = index;
+	lineOffsets = std::move(offsets);
+}
+
+void MGLvtkPointCloud::upload() {
+	if (vao == 0) {
+		glGenVertexArrays(1, &vao);
+		glGenBuffers(1, &vbo);
+		glBindVertexArray(vao);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		GLsizei stride = sizeof(vtkPointVertex);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(vtkPointVertex, x));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(vtkPointVertex, size));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(vtkPointVertex, rgba));
+	}
+	else {
+		glBindVertexArray(vao);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	}
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vtkPointVertex), vertices.data(), GL_STATIC_DRAW);
+	glBindVertexArray(0);
+	uploadedCount = (GLsizei)vertices.size();
+	dirty = false;
+}
+
+void MGLvtkPointCloud::render(const Camera& cam) {
+	if (program == 0) {
+		program = vtkBuildShaderProgram(pointCloudVertexShader, pointCloudFragmentShader, "point cloud");
+		if (program == 0) return;
+		mvpLocation = glGetUniformLocation(program, "mvp");
+	}
+	if (dirty) upload();
+	if (uploadedCount == 0) return;
+
+	Mat4 mvp = cam.getCameraProjectionMatrix() * cam.getCameraViewMatrix();
+
+	GLint prevProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &prevProgram);
+	glUseProgram(program);
+	glUniformMatrix4fv(mvpLocation, 1, GL_FALSE, mvp.getPtr());
+	glEnable(GL_PROGRAM_POINT_SIZE);
+
+	glBindVertexArray(vao);
+	if (spatial == nullptr || spatial->getChunks().empty() || lineOffsets.empty() ||
+		lineOffsets.back() != uploadedCount) {
+		glDrawArrays(GL_POINTS, 0, uploadedCount);
+	}
+	else {
+		// chunks hold consecutive lines, so neighbouring visible chunks merge into one draw
+		spatial->visibleChunks(vtkFrustum::fromMatrix(mvp.getPtr()), visible);
+		const std::vector<vtkStreamlineSpatialIndex::chunk>& chunks = spatial->getChunks();
+		size_t i = 0;
+		while (i < visible.size()) {
+			int firstLine = chunks[visible[i]].firstLine, lastLine = chunks[visible[i]].lastLine;
+			for (i++; i < visible.size() && chunks[visible[i]].firstLine == lastLine; i++)
+				lastLine = chunks[visible[i]].lastLine;
+			glDrawArrays(GL_POINTS, lineOffsets[firstLine], lineOffsets[lastLine] - lineOffsets[firstLine]);
+		}
+	}
+	glBindVertexArray(0);
+
+	glDisable(GL_PROGRAM_POINT_SIZE);
+	glUseProgram((GLuint)prevProgram);
+}
+
+std::vector<vtkPointVertex> MGLvtkPointCloud::buildVertices(vtkParser::openFoamVtkFileData& data,
+	const vtkParser::vtkPolylineIndex* lines, float posScale, float pointSize, const char* colourField) {
+
+	std::vector<vtkPointVertex> out;
+	if (data.points.empty()) return out;
+	size_t count = (lines != nullptr) ? lines->totalPoints() : (size_t)data.points.size;
+	out.reserve(count);
+
+	const vtkParser::vtkDataArray* field = (colourField != nullptr) ?
+		vtkParser::getVtkData(data, vtkParser::POINT_DATA, colourField) : nullptr;
+	if (field != nullptr && field->numTuples != data.points.size) field = nullptr;
+
+	double lo = 0.0, hi = 0.0;
+	if (field != nullptr) vtkFieldMagnitudeRange(*field, lo, hi);
+	double range = (hi > lo) ? hi - lo : 1.0;
+
+	for (size_t n = 0; n < count; n++) {
+		int i = (lines != nullptr) ? lines->indices[n] : (int)n;
+		vtkParser::vtkPoint p = data.points.point(i);
+		vtkPointVertex v;
+		v.x = p.x * posScale;
+		v.y = p.y * posScale;
+		v.z = p.z * posScale;
+		v.size = pointSize;
+		if (field != nullptr) vtkFieldColour((float)((field->magnitude(i) - lo) / range), v.rgba);
+		else v.rgba[0] = v.rgba[1] = v.rgba[2] = v.rgba[3] = 255;
+		out.push_back(v);
+	}
+	return out;
+}
@@ -0,0 +1,70 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "AftrOpenGLIncludes.h"
+#include "MGL.h"
+#include "Camera.h"
+#include "WO.h"
+
+#include "vtkParser.hpp"
+#include "vtkBVH.hpp"
+
+using namespace Aftr;
+
+// one uploaded point: world position, size in pixels and an rgba colour, 20 bytes
+struct vtkPointVertex {
+	float x, y, z;
+	float size;
+	uint8_t rgba[4];
+};
+
+/* Every point of a timestamp in one vertex buffer, drawn with a single
+ * glDrawArrays(GL_POINTS) as round screen space glyphs.
+ * Vertices are in world space so the owning WO stays at the origin.
+ */
+class MGLvtkPointCloud : public MGL {
+public:
+	static MGLvtkPointCloud* New(WO* parentWO);
+	virtual ~MGLvtkPointCloud();
+
+	// replaces the cloud, the GPU copy is refreshed on the next render
+	void setPoints(std::vector<vtkPointVertex>&& points);
+	size_t getPointCount() const { return vertices.size(); }
+	/* With an index of the lines the points were built along (buildVertices
+	*  with lines) only the chunks inside the view frustum are drawn.
+	*  lineOffsets is the lines' CSR offsets, the first vertex of every line.
+	*/
+	void setSpatialIndex(std::shared_ptr<const vtkStreamlineSpatialIndex> index, std::vector<int> lineOffsets);
+
+	virtual void render(const Camera& cam) override;
+
+	/* Points of a parsed timestamp scaled by posScale and coloured by the
+	 * magnitude of colourField (blue low, red high), a missing field leaves them
+	 * white. With lines only the points they reference are kept (I.E. decimated
+	 * lines), nullptr keeps every point.
+	 */
+	static std::vector<vtkPointVertex> buildVertices(vtkParser::openFoamVtkFileData& data,
+		const vtkParser::vtkPolylineIndex* lines, float posScale, float pointSize, const char* colourField);
+
+protected:
+	MGLvtkPointCloud(WO* parentWO);
+
+	std::vector<vtkPointVertex> vertices;
+	bool dirty;
+	GLuint vao;
+	GLuint vbo;
+	GLsizei uploadedCount;
+	std::vector<int> lineOffsets;
+	std::shared_ptr<const vtkStreamlineSpatialIndex> spatial;
+	std::vector<int> visible; // reused every frame
+
+	// shared by every cloud, compiled on the first render
+	static GLuint program;
+	static GLint mvpLocation;
+	void upload();
+};
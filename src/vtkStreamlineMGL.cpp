@@ -0,0 +1,162 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#include "vtkStreamlineMGL.hpp"
+#include "vtkGLShader.hpp"
+#include "Mat4.h"
+
+using namespace Aftr;
+
+GLuint MGLvtkStreamlineMesh::program = 0;
+GLint MGLvtkStreamlineMesh::mvpLocation = -1;
+
+static const char* streamlineVertexShader =
+	"#version 330 core\n"
+	"layout(location = 0) in vec3 position;\n"
+	"layout(location = 1) in vec3 normal;\n"
+	"layout(location = 2) in vec4 colour;\n"
+	"uniform mat4 mvp;\n"
+	"out vec3 surfaceNormal;\n"
+	"out vec4 surfaceColour;\n"
+	"void main() {\n"
+	"	gl_Position = mvp * vec4(position, 1.0);\n"
+	"	surfaceNormal = normal;\n"
+	"	surfaceColour = colour;\n"
+	"}\n";
+
+// two sided diffuse from a fixed light, line meshes have no normal and stay unlit
+static const char* streamlineFragmentShader =
+	"#version 330 core\n"
+	"in vec3 surfaceNormal;\n"
+	"in vec4 surfaceColour;\n"
+	"out vec4 fragColour;\n"
+	"void main() {\n"
+	"	float light = 1.0;\n"
+	"	if (dot(surfaceNormal, surfaceNormal) > 0.25)\n"
+	"		light = 0.35 + 0.65 * abs(dot(normalize(surfaceNormal), normalize(vec3(0.3, 0.5, 0.8))));\n"
+	"	fragColour = vec4(surfaceColour.rgb * light, surfaceColour.a);\n"
+	"}\n";
+
+MGLvtkStreamlineMesh* MGLvtkStreamlineMesh::New(WO* parentWO) {
+	return new MGLvtkStreamlineMesh(parentWO);
+}
+
+MGLvtkStreamlineMesh::MGLvtkStreamlineMesh(WO* parentWO)
+	: MGL(parentWO), dirty(false), verticesDirty(false), uploadedVertices(0),
+	vao(0), vbo(0), ibo(0), primitive(GL_LINES), uploadedIndices(0) {}
+
+MGLvtkStreamlineMesh::~MGLvtkStreamlineMesh() {
+	if (ibo != 0) glDeleteBuffers(1, &ibo);
+	if (vbo != 0) glDeleteBuffers(1, &vbo);
+	if (vao != 0) glDeleteVertexArrays(1, &vao);
+}
+
+void MGLvtkStreamlineMesh::setMesh(vtkStreamlineMesh&& streamlines) {
+	mesh = std::move(streamlines);
+	dirty = true;
+}
+
+void MGLvtkStreamlineMesh::setVertices(const vtkStreamlineMesh& vertices) {
+	vertexUpdate.positions.assign(vertices.positions.begin(), vertices.positions.end());
+	vertexUpdate.normals.assign(vertices.normals.begin(), vertices.normals.end());
+	vertexUpdate.colours.assign(vertices.colours.begin(), vertices.colours.end());
+	verticesDirty = true;
+}
+
+void MGLvtkStreamlineMesh::setSpatialIndex(std::shared_ptr<const vtkStreamlineSpatialIndex> index) {
+	spatial = index;
+}
+
+void MGLvtkStreamlineMesh::upload() {
+	if (vao == 0) {
+		glGenVertexArrays(1, &vao);
+		glGenBuffers(1, &vbo);
+		glGenBuffers(1, &ibo);
+	}
+
+	// one buffer, positions | normals | colours back to back
+	size_t positionBytes = mesh.positions.size() * sizeof(float);
+	size_t normalBytes = mesh.normals.size() * sizeof(float);
+	size_t colourBytes = mesh.colours.size();
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, positionBytes + normalBytes + colourBytes, nullptr, GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, positionBytes, mesh.positions.data());
+	glBufferSubData(GL_ARRAY_BUFFER, positionBytes, normalBytes, mesh.normals.data());
+	glBufferSubData(GL_ARRAY_BUFFER, positionBytes + normalBytes, colourBytes, mesh.colours.data());
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)positionBytes);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, (void*)(positionBytes + normalBytes));
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+	glBindVertexArray(0);
+
+	primitive = (mesh.primitive == vtkStreamlineMesh::MESH_LINES) ? GL_LINES : GL_TRIANGLES;
+	uploadedIndices = (GLsizei)mesh.indices.size();
+	uploadedVertices = mesh.vertexCount();
+	lineOffsets = std::move(mesh.lineOffsets);
+	// the GPU copy is all that is drawn from now on
+	mesh = vtkStreamlineMesh{};
+	dirty = false;
+}
+
+void MGLvtkStreamlineMesh::uploadVertices() {
+	verticesDirty = false;
+	// the same positions | normals | colours layout upload() made, overwritten in place
+	if (vao == 0 || vertexUpdate.vertexCount() != uploadedVertices) return;
+	size_t positionBytes = vertexUpdate.positions.size() * sizeof(float);
+	size_t normalBytes = vertexUpdate.normals.size() * sizeof(float);
+	if (normalBytes != positionBytes || vertexUpdate.colours.size() != uploadedVertices * 4) return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, positionBytes, vertexUpdate.positions.data());
+	glBufferSubData(GL_ARRAY_BUFFER, positionBytes, normalBytes, vertexUpdate.normals.data());
+	glBufferSubData(GL_ARRAY_BUFFER, positionBytes + normalBytes, vertexUpdate.colours.size(), vertexUpdate.colours.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MGLvtkStreamlineMesh::render(const Camera& cam) {
+	if (program == 0) {
+		program = vtkBuildShaderProgram(streamlineVertexShader, streamlineFragmentShader, "streamline");
+		if (program == 0) return;
+		mvpLocation = glGetUniformLocation(program, "mvp");
+	}
+	if (dirty) upload();
+	if (verticesDirty) uploadVertices();
+	if (uploadedIndices == 0) return;
+
+	Mat4 mvp = cam.getCameraProjectionMatrix() * cam.getCameraViewMatrix();
+
+	GLint prevProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &prevProgram);
+	glUseProgram(program);
+	glUniformMatrix4fv(mvpLocation, 1, GL_FALSE, mvp.getPtr());
+
+	glBindVertexArray(vao);
+	if (spatial == nullptr || spatial->getChunks().empty() ||
+		lineOffsets.size() != spatial->getChunks().back().lastLine + 1) {
+		glDrawElements(primitive, uploadedIndices, GL_UNSIGNED_INT, (void*)0);
+	}
+	else {
+		// chunks hold consecutive lines, so neighbouring visible chunks merge into one draw
+		spatial->visibleChunks(vtkFrustum::fromMatrix(mvp.getPtr()), visible);
+		const std::vector<vtkStreamlineSpatialIndex::chunk>& chunks = spatial->getChunks();
+		size_t i = 0;
+		while (i < visible.size()) {
+			int firstLine = chunks[visible[i]].firstLine, lastLine = chunks[visible[i]].lastLine;
+			for (i++; i < visible.size() && chunks[visible[i]].firstLine == lastLine; i++)
+				lastLine = chunks[visible[i]].lastLine;
+			GLsizei count = (GLsizei)(lineOffsets[lastLine] - lineOffsets[firstLine]);
+			if (count > 0)
+				glDrawElements(primitive, count, GL_UNSIGNED_INT, (void*)(lineOffsets[firstLine] * sizeof(unsigned int)));
+		}
+	}
+	glBindVertexArray(0);
+
+	glUseProgram((GLuint)prevProgram);
+}
@@ -0,0 +1,57 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#pragma once
+
+#include "AftrOpenGLIncludes.h"
+#include "MGL.h"
+#include "Camera.h"
+#include "WO.h"
+
+#include "vtkStreamlineMesh.hpp"
+#include "vtkBVH.hpp"
+
+using namespace Aftr;
+
+/* A whole timestamp's streamline mesh (lines, ribbons or tubes) in one vertex
+ * and one index buffer, drawn with a single glDrawElements. Vertices are in
+ * world space so the owning WO stays at the origin.
+ */
+class MGLvtkStreamlineMesh : public MGL {
+public:
+	static MGLvtkStreamlineMesh* New(WO* parentWO);
+	virtual ~MGLvtkStreamlineMesh();
+
+	// takes the mesh, it is uploaded on the next render and the CPU copy dropped
+	void setMesh(vtkStreamlineMesh&& streamlines);
+	/* New positions, normals and colours for the vertices of the mesh set last,
+	*  only those are uploaded and the index buffer stays. A blend refills its
+	*  model this way every frame, vertices of a different count are ignored.
+	*/
+	void setVertices(const vtkStreamlineMesh& vertices);
+	// with an index of the same lines only the chunks inside the view frustum are drawn
+	void setSpatialIndex(std::shared_ptr<const vtkStreamlineSpatialIndex> index);
+
+	virtual void render(const Camera& cam) override;
+
+protected:
+	MGLvtkStreamlineMesh(WO* parentWO);
+
+	vtkStreamlineMesh mesh;
+	bool dirty;
+	vtkStreamlineMesh vertexUpdate; // from setVertices, its storage is reused frame to frame
+	bool verticesDirty;
+	size_t uploadedVertices;
+	GLuint vao;
+	GLuint vbo;
+	GLuint ibo;
+	GLenum primitive;
+	GLsizei uploadedIndices;
+	std::vector<unsigned int> lineOffsets; // from the mesh, kept past the upload
+	std::shared_ptr<const vtkStreamlineSpatialIndex> spatial;
+	std::vector<int> visible; // reused every frame
+
+	static GLuint program;
+	static GLint mvpLocation;
+	void upload();
+	void uploadVertices();
+};
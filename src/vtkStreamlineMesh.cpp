@@ -0,0 +1,185 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+#include <algorithm>
+#include <cmath>
+
+#include "vtkStreamlineMesh.hpp"
+
+namespace {
+	struct vec3 {
+		float x, y, z;
+	};
+
+	vec3 operator+(vec3 a, vec3 b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	vec3 operator-(vec3 a, vec3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	vec3 operator*(vec3 a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+	float dot(vec3 a, vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	vec3 cross(vec3 a, vec3 b) {
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	// false and v untouched when v has no usable length
+	bool normalize(vec3& v) {
+		float len = std::sqrt(dot(v, v));
+		if (len < 1e-12f) return false;
+		v = v * (1.0f / len);
+		return true;
+	}
+
+	// any unit vector perpendicular to unit t
+	vec3 perpendicular(vec3 t) {
+		vec3 axis = { 1.0f, 0.0f, 0.0f };
+		float ax = std::fabs(t.x), ay = std::fabs(t.y), az = std::fabs(t.z);
+		if (ay <= ax && ay <= az) axis = { 0.0f, 1.0f, 0.0f };
+		else if (az <= ax && az <= ay) axis = { 0.0f, 0.0f, 1.0f };
+		vec3 n = cross(t, axis);
+		normalize(n);
+		return n;
+	}
+}
+
+void vtkFieldColour(float t, uint8_t rgba[4]) {
+	t = std::clamp(t, 0.0f, 1.0f);
+	float r = std::clamp(4.0f * t - 2.0f, 0.0f, 1.0f);
+	float g = std::clamp(t < 0.5f ? 4.0f * t : 4.0f - 4.0f * t, 0.0f, 1.0f);
+	float b = std::clamp(2.0f - 4.0f * t, 0.0f, 1.0f);
+	rgba[0] = (uint8_t)(r * 255.0f);
+	rgba[1] = (uint8_t)(g * 255.0f);
+	rgba[2] = (uint8_t)(b * 255.0f);
+	rgba[3] = 255;
+}
+
+void vtkFieldMagnitudeRange(const vtkParser::vtkDataArray& field, double& lo, double& hi) {
+	lo = hi = 0.0;
+	if (field.numTuples <= 0) return;
+	lo = hi = field.magnitude(0);
+	for (int i = 1; i < field.numTuples; i++) {
+		double m = field.magnitude(i);
+		lo = std::min(lo, m);
+		hi = std::max(hi, m);
+	}
+}
+
+size_t vtkStreamlineMeshBuilder::verticesPerLine(const options& opts, size_t linePoints) {
+	if (linePoints < 2) return 0;
+	if (opts.style == STYLE_LINES) return linePoints;
+	if (opts.style == STYLE_RIBBON) return linePoints * 2;
+	return linePoints * std::max(opts.sides, 3);
+}
+
+size_t vtkStreamlineMeshBuilder::indicesPerLine(const options& opts, size_t linePoints) {
+	if (linePoints < 2) return 0;
+	size_t segments = linePoints - 1;
+	if (opts.style == STYLE_LINES) return segments * 2;
+	if (opts.style == STYLE_RIBBON) return segments * 6;
+	return segments * 6 * std::max(opts.sides, 3);
+}
+
+vtkStreamlineMesh vtkStreamlineMeshBuilder::build(vtkParser::openFoamVtkFileData& data, const options& opts) {
+	VTK_TRACE_ZONE("vtkStreamlineMeshBuilder::build");
+	vtkStreamlineMesh mesh;
+	mesh.primitive = (opts.style == STYLE_LINES) ?
+		vtkStreamlineMesh::MESH_LINES : vtkStreamlineMesh::MESH_TRIANGLES;
+
+	const vtkParser::vtkPolylineIndex& lines = (opts.lines != nullptr) ? *opts.lines : data.lines;
+	if (lines.empty() || data.points.empty()) return mesh;
+
+	// every line's share is known up front, so each array is allocated once
+	size_t vertexTotal = 0, indexTotal = 0;
+	for (vtkParser::vtkLine line : lines) {
+		vertexTotal += verticesPerLine(opts, line.size());
+		indexTotal += indicesPerLine(opts, line.size());
+	}
+	mesh.positions.resize(vertexTotal * 3);
+	mesh.normals.resize(vertexTotal * 3);
+	mesh.colours.resize(vertexTotal * 4);
+	mesh.indices.reserve(indexTotal);
+	mesh.lineOffsets.reserve(lines.size() + 1);
+
+	const vtkParser::vtkDataArray* field = (opts.colourField != nullptr) ?
+		vtkParser::getVtkData(data, vtkParser::POINT_DATA, opts.colourField) : nullptr;
+	if (field != nullptr && field->numTuples != data.points.size) field = nullptr;
+	double lo = opts.colourMin, hi = opts.colourMax;
+	if (field != nullptr && lo == hi) vtkFieldMagnitudeRange(*field, lo, hi);
+	double range = (hi > lo) ? hi - lo : 1.0;
+
+	auto put = [&](size_t v, vec3 pos, vec3 normal, const uint8_t rgba[4]) {
+		mesh.positions[v * 3 + 0] = pos.x;
+		mesh.positions[v * 3 + 1] = pos.y;
+		mesh.positions[v * 3 + 2] = pos.z;
+		mesh.normals[v * 3 + 0] = normal.x;
+		mesh.normals[v * 3 + 1] = normal.y;
+		mesh.normals[v * 3 + 2] = normal.z;
+		std::copy(rgba, rgba + 4, &mesh.colours[v * 4]);
+	};
+	auto position = [&](int pointIndex) {
+		vtkParser::vtkPoint p = data.points.point(pointIndex);
+		return vec3{ p.x * opts.posScale, p.y * opts.posScale, p.z * opts.posScale };
+	};
+
+	const int sides = std::max(opts.sides, 3);
+	const float step = 6.28318530718f / sides;
+	unsigned int base = 0;
+
+	for (vtkParser::vtkLine line : lines) {
+		size_t n = line.size();
+		mesh.lineOffsets.push_back((unsigned int)mesh.indices.size());
+		if (n < 2) continue;
+
+		vec3 tangent = { 1.0f, 0.0f, 0.0f }, normal = { 0.0f, 0.0f, 0.0f };
+		for (size_t i = 0; i < n; i++) {
+			vec3 p = position(line[i]);
+
+			// central difference inside the line, one sided at its ends
+			vec3 t = position(line[std::min(i + 1, n - 1)]) - position(line[i > 0 ? i - 1 : 0]);
+			if (normalize(t)) tangent = t;
+
+			/* Parallel transport: the previous frame's normal with its component
+			 * along the new tangent removed, so tubes and ribbons don't twist.
+			 */
+			vec3 nrm = normal - tangent * dot(normal, tangent);
+			if (i == 0 || !normalize(nrm)) nrm = perpendicular(tangent);
+			normal = nrm;
+			vec3 binormal = cross(tangent, normal);
+
+			uint8_t rgba[4] = { 255, 255, 255, 255 };
+			if (field != nullptr) vtkFieldColour((float)((field->magnitude(line[i]) - lo) / range), rgba);
+
+			if (opts.style == STYLE_LINES) {
+				put(base + i, p, vec3{ 0.0f, 0.0f, 0.0f }, rgba);
+			}
+			else if (opts.style == STYLE_RIBBON) {
+				put(base + i * 2 + 0, p - binormal * opts.radius, normal, rgba);
+				put(base + i * 2 + 1, p + binormal * opts.radius, normal, rgba);
+			}
+			else {
+				for (int k = 0; k < sides; k++) {
+					vec3 out = normal * std::cos(step * k) + binormal * std::sin(step * k);
+					put(base + i * sides + k, p + out * opts.radius, out, rgba);
+				}
+			}
+		}
+
+		for (unsigned int i = 0; i + 1 < n; i++) {
+			if (opts.style == STYLE_LINES) {
+				mesh.indices.push_back(base + i);
+				mesh.indices.push_back(base + i + 1);
+			}
+			else if (opts.style == STYLE_RIBBON) {
+				unsigned int a0 = base + i * 2, a1 = a0 + 1, b0 = a0 + 2, b1 = a0 + 3;
+				mesh.indices.insert(mesh.indices.end(), { a0, a1, b0, a1, b1, b0 });
+			}
+			else {
+				// two outward facing triangles per facet between ring i and ring i + 1
+				for (unsigned int k = 0; k < (unsigned int)sides; k++) {
+					unsigned int a = base + i * sides + k;
+					unsigned int b = base + i * sides + (k + 1) % sides;
+					unsigned int c = a + sides, d = b + sides;
+					mesh.indices.insert(mesh.indices.end(), { a, b, c, b, d, c });
+				}
+			}
+		}
+		base += (unsigned int)verticesPerLine(opts, n);
+	}
+	mesh.lineOffsets.push_back((unsigned int)mesh.indices.size());
+	return mesh;
+}
@@ -0,0 +1,77 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#ifndef VTK_STREAMLINE_MESH_HPP
+#define VTK_STREAMLINE_MESH_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "vtkParser.hpp"
+
+/* Every streamline of a timestamp as one indexed mesh, ready for a single
+ * upload. Attributes are separate flat arrays so each can go straight into
+ * its own range of a vertex buffer.
+ */
+struct vtkStreamlineMesh {
+	enum primitives {
+		MESH_LINES, // indices are segment pairs
+		MESH_TRIANGLES // indices are triangle triples
+	};
+	int primitive = MESH_LINES;
+
+	std::vector<float> positions; // x y z per vertex
+	std::vector<float> normals; // x y z per vertex, zero for line meshes
+	std::vector<uint8_t> colours; // r g b a per vertex
+	std::vector<unsigned int> indices;
+	std::vector<unsigned int> lineOffsets; // first index of every line plus the end, draws runs of whole lines
+
+	size_t vertexCount() const { return positions.size() / 3; }
+	bool empty() const { return indices.empty(); }
+	size_t byteSize() const {
+		return (positions.size() + normals.size()) * sizeof(float) +
+			colours.size() + (indices.size() + lineOffsets.size()) * sizeof(unsigned int);
+	}
+	void clear() {
+		positions.clear();
+		normals.clear();
+		colours.clear();
+		indices.clear();
+		lineOffsets.clear();
+	}
+};
+
+class vtkStreamlineMeshBuilder {
+public:
+	enum styles {
+		STYLE_LINES, // one line strip per streamline
+		STYLE_RIBBON, // flat strip radius wide either side of the line
+		STYLE_TUBE // closed tube of sides facets
+	};
+
+	struct options {
+		int style = STYLE_TUBE;
+		float radius = 0.02f; // world units, after posScale
+		int sides = 6;
+		float posScale = 1.0f; // applied to the parsed positions
+		const char* colourField = "U"; // point data array, coloured by magnitude
+		double colourMin = 0.0, colourMax = 0.0; // equal = the field's own range
+		const vtkParser::vtkPolylineIndex* lines = nullptr; // I.E. decimated lines, nullptr = data.lines
+	};
+
+	/* Builds the mesh for every line of data. Lines with fewer than two points
+	 * add nothing. Engine free so it can run on the parser threads.
+	 */
+	static vtkStreamlineMesh build(vtkParser::openFoamVtkFileData& data, const options& opts);
+
+	// vertices one line adds for a style
+	static size_t verticesPerLine(const options& opts, size_t linePoints);
+	static size_t indicesPerLine(const options& opts, size_t linePoints);
+};
+
+// blue -> cyan -> green -> yellow -> red over t in [0, 1]
+void vtkFieldColour(float t, uint8_t rgba[4]);
+// smallest and largest tuple magnitude of a field
+void vtkFieldMagnitudeRange(const vtkParser::vtkDataArray& field, double& lo, double& hi);
+
+#endif
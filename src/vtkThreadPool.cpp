@@ -0,0 +1,75 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+#include <iostream>
+#include <utility>
+
+#include "vtkThreadPool.hpp"
+#include "vtkTrace.hpp"
+
+vtkThreadPool::vtkThreadPool(unsigned threadCount, size_t memoryBudget)
+	: memoryBudget(memoryBudget), memoryInFlight(0), running(0), stopping(false) {
+
+	if (threadCount == 0) threadCount = defaultThreadCount();
+	workers.reserve(threadCount);
+	for (unsigned i = 0; i < threadCount; i++)
+		workers.emplace_back(&vtkThreadPool::workerLoop, this);
+}
+
+vtkThreadPool::~vtkThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	workReady.notify_all();
+	for (std::thread& worker : workers) worker.join();
+}
+
+unsigned vtkThreadPool::defaultThreadCount() {
+	unsigned n = std::thread::hardware_concurrency();
+	return n > 0 ? n : 4;
+}
+
+void vtkThreadPool::submit(std::function<void()> task, size_t memoryEstimate) {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		queue.push_back({ std::move(task), memoryEstimate });
+	}
+	workReady.notify_one();
+}
+
+void vtkThreadPool::wait() {
+	std::unique_lock<std::mutex> guard(lock);
+	allDone.wait(guard, [this]() { return queue.empty() && running == 0; });
+}
+
+void vtkThreadPool::workerLoop() {
+	VTK_TRACE_THREAD("vtkThreadPool worker");
+	std::unique_lock<std::mutex> guard(lock);
+	for (;;) {
+		// the head of the queue starts when it fits next to what's running,
+		// or when nothing is running so an oversized task can't stall the pool
+		workReady.wait(guard, [this]() {
+			if (queue.empty()) return stopping;
+			return memoryBudget == 0 || running == 0 ||
+				memoryInFlight + queue.front().memory <= memoryBudget;
+		});
+		if (queue.empty()) return; // stopping and drained
+
+		task current = std::move(queue.front());
+		queue.pop_front();
+		memoryInFlight += current.memory;
+		running++;
+
+		guard.unlock();
+		{
+			VTK_TRACE_ZONE("vtkThreadPool::task");
+			current.run();
+		}
+		guard.lock();
+
+		memoryInFlight -= current.memory;
+		running--;
+		// released memory may let a waiting task start
+		workReady.notify_all();
+		if (queue.empty() && running == 0) allDone.notify_all();
+	}
+}
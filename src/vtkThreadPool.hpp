@@ -0,0 +1,73 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#ifndef VTK_THREAD_POOL_HPP
+#define VTK_THREAD_POOL_HPP
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <type_traits>
+
+/* Fixed size worker pool for file parsing.
+ * Tasks run in submit order. Each task carries an estimate of the memory it
+ * holds while running, a task only starts when it fits in the memory budget
+ * next to the tasks already running (a single task larger than the whole
+ * budget still runs, alone).
+ */
+class vtkThreadPool {
+public:
+	// threadCount 0 = hardware_concurrency, memoryBudget 0 = unlimited
+	vtkThreadPool(unsigned threadCount = 0, size_t memoryBudget = 0);
+	// runs whatever is still queued, then joins the workers
+	~vtkThreadPool();
+
+	vtkThreadPool(const vtkThreadPool&) = delete;
+	vtkThreadPool& operator=(const vtkThreadPool&) = delete;
+
+	void submit(std::function<void()> task, size_t memoryEstimate = 0);
+
+	// submit() that hands back the task's result, waiting on it blocks without spinning
+	template<typename F>
+	std::future<std::invoke_result_t<F>> enqueue(F&& fn, size_t memoryEstimate = 0) {
+		using R = std::invoke_result_t<F>;
+		auto task = std::make_shared<std::packaged_task<R()> >(std::forward<F>(fn));
+		std::future<R> result = task->get_future();
+		submit([task]() { (*task)(); }, memoryEstimate);
+		return result;
+	}
+
+	// blocks until the queue is empty and no task is running
+	void wait();
+
+	unsigned size() const { return (unsigned)workers.size(); }
+	size_t getMemoryBudget() const { return memoryBudget; }
+
+	static unsigned defaultThreadCount();
+
+private:
+	struct task {
+		std::function<void()> run;
+		size_t memory;
+	};
+
+	std::vector<std::thread> workers;
+	std::deque<task> queue;
+
+	std::mutex lock;
+	std::condition_variable workReady; // queue changed or memory was released
+	std::condition_variable allDone;
+
+	size_t memoryBudget;
+	size_t memoryInFlight;
+	unsigned running;
+	bool stopping;
+
+	void workerLoop();
+};
+
+#endif
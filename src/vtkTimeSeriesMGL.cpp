@@ -0,0 +1,55 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#include "vtkTimeSeriesMGL.hpp"
+
+using namespace Aftr;
+
+MGLvtkTimeSeries* MGLvtkTimeSeries::New(WO* parentWO, size_t timeStampCount) {
+	return new MGLvtkTimeSeries(parentWO, timeStampCount);
+}
+
+MGLvtkTimeSeries::MGLvtkTimeSeries(WO* parentWO, size_t timeStampCount)
+	: MGL(parentWO), models(timeStampCount, nullptr), shown(-1), blend(nullptr), blendShown(false) {}
+
+MGLvtkTimeSeries::~MGLvtkTimeSeries() {
+	clear();
+	delete blend;
+}
+
+void MGLvtkTimeSeries::setTimeStamp(int index, MGL* model) {
+	if (index < 0 || index >= (int)models.size()) {
+		delete model;
+		return;
+	}
+	delete models.at(index);
+	models.at(index) = model;
+}
+
+bool MGLvtkTimeSeries::hasTimeStamp(int index) const {
+	return index >= 0 && index < (int)models.size() && models.at(index) != nullptr;
+}
+
+void MGLvtkTimeSeries::clear() {
+	for (MGL*& model : models) {
+		delete model;
+		model = nullptr;
+	}
+	shown = -1;
+}
+
+void MGLvtkTimeSeries::setBlend(MGL* model) {
+	if (model != blend) delete blend;
+	blend = model;
+}
+
+void MGLvtkTimeSeries::show(int index) {
+	shown = (index >= 0 && index < (int)models.size()) ? index : -1;
+}
+
+void MGLvtkTimeSeries::render(const Camera& cam) {
+	if (blendShown && blend != nullptr) {
+		blend->render(cam);
+		return;
+	}
+	if (shown >= 0 && models.at(shown) != nullptr) models.at(shown)->render(cam);
+}
@@ -0,0 +1,50 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#pragma once
+
+#include <vector>
+
+#include "MGL.h"
+#include "Camera.h"
+#include "WO.h"
+
+using namespace Aftr;
+
+/* The whole time series as one node in the world list.
+ * Each timestamp's model is attached once, showing a different timestamp only
+ * changes which one renders, so switching is constant time no matter how
+ * much geometry a timestamp holds.
+ */
+class MGLvtkTimeSeries : public MGL {
+public:
+	static MGLvtkTimeSeries* New(WO* parentWO, size_t timeStampCount);
+	virtual ~MGLvtkTimeSeries();
+
+	// takes ownership of model (created with this MGL's WO as parent), deletes the one it replaces
+	void setTimeStamp(int index, MGL* model);
+	bool hasTimeStamp(int index) const;
+	// deletes every attached model, nothing is shown until the next show()
+	void clear();
+
+	// -1 shows nothing
+	void show(int index);
+	int getShown() const { return shown; }
+
+	/* A model blended between two timestamps, drawn instead of the shown one
+	*  while showBlend(true). Taken over like setTimeStamp, clear() keeps it.
+	*/
+	void setBlend(MGL* model);
+	MGL* getBlend() const { return blend; }
+	void showBlend(bool enabled) { blendShown = enabled; }
+	size_t size() const { return models.size(); }
+
+	virtual void render(const Camera& cam) override;
+
+protected:
+	MGLvtkTimeSeries(WO* parentWO, size_t timeStampCount);
+
+	std::vector<MGL*> models; // slot i is timestamp i, nullptr until built
+	int shown;
+	MGL* blend;
+	bool blendShown;
+};
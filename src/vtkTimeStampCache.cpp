@@ -0,0 +1,92 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#include "vtkTimeStampCache.hpp"
+
+vtkTimeStampCache::vtkTimeStampCache(size_t timeStampCount, size_t budget)
+	: usedBytes(0), budget(0) {
+	reset(timeStampCount, budget);
+}
+
+void vtkTimeStampCache::reset(size_t timeStampCount, size_t newBudget) {
+	order.clear();
+	entries.assign(timeStampCount, entry());
+	usedBytes = 0;
+	budget = newBudget;
+}
+
+std::vector<int> vtkTimeStampCache::insert(int index, size_t bytes) {
+	std::vector<int> evicted;
+	if (!valid(index)) return evicted;
+	erase(index);
+
+	entry& e = entries.at(index);
+	order.push_front(index);
+	e.position = order.begin();
+	e.bytes = bytes;
+	e.cached = true;
+	usedBytes += bytes;
+
+	if (budget == 0) return evicted;
+	// walk from the least recently used end, skipping pinned entries and the new one
+	auto it = order.end();
+	while (usedBytes > budget && it != order.begin()) {
+		--it;
+		int victim = *it;
+		if (victim == index || entries.at(victim).pinned) continue;
+		it = order.erase(it);
+		usedBytes -= entries.at(victim).bytes;
+		entries.at(victim).cached = false;
+		entries.at(victim).bytes = 0;
+		evicted.push_back(victim);
+	}
+	return evicted;
+}
+
+void vtkTimeStampCache::touch(int index) {
+	if (!contains(index)) return;
+	entry& e = entries.at(index);
+	order.splice(order.begin(), order, e.position);
+}
+
+void vtkTimeStampCache::erase(int index) {
+	if (!contains(index)) return;
+	entry& e = entries.at(index);
+	order.erase(e.position);
+	usedBytes -= e.bytes;
+	e.bytes = 0;
+	e.cached = false;
+}
+
+void vtkTimeStampCache::clear() {
+	order.clear();
+	for (entry& e : entries) {
+		e.bytes = 0;
+		e.cached = false;
+	}
+	usedBytes = 0;
+}
+
+void vtkTimeStampCache::pin(int index, bool pinned) {
+	if (valid(index)) entries.at(index).pinned = pinned;
+}
+
+bool vtkTimeStampCache::isPinned(int index) const {
+	return valid(index) && entries.at(index).pinned;
+}
+
+void vtkTimeStampCache::clearPins() {
+	for (entry& e : entries) e.pinned = false;
+}
+
+bool vtkTimeStampCache::contains(int index) const {
+	return valid(index) && entries.at(index).cached;
+}
+
+bool vtkTimeStampCache::canFit(size_t bytes) const {
+	if (budget == 0) return true;
+	size_t pinnedBytes = 0;
+	for (int index : order) {
+		if (entries.at(index).pinned) pinnedBytes += entries.at(index).bytes;
+	}
+	return pinnedBytes + bytes <= budget;
+}
@@ -0,0 +1,61 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#ifndef VTK_TIMESTAMP_CACHE_HPP
+#define VTK_TIMESTAMP_CACHE_HPP
+
+#include <list>
+#include <vector>
+#include <cstddef>
+
+/* Bookkeeping for the timestamps that hold render ready geometry.
+ * Each entry is a timestamp index and the bytes its geometry takes. Adding an
+ * entry evicts the least recently used ones until the total fits the budget
+ * again, pinned entries (I.E. the shown timestamp) are never evicted, so the
+ * total can only go over budget while the pinned entries alone exceed it.
+ * Engine free, the owner frees whatever an evicted index held.
+ */
+class vtkTimeStampCache {
+public:
+	// budget 0 = unlimited
+	vtkTimeStampCache(size_t timeStampCount = 0, size_t budget = 0);
+
+	// drops every entry and pin
+	void reset(size_t timeStampCount, size_t budget);
+
+	/* Adds (or resizes) index as the most recently used entry, returns the
+	*  indices evicted to make room, least recently used first.
+	*/
+	std::vector<int> insert(int index, size_t bytes);
+	// marks index as the most recently used
+	void touch(int index);
+	void erase(int index);
+	void clear();
+
+	void pin(int index, bool pinned);
+	bool isPinned(int index) const;
+	void clearPins();
+
+	bool contains(int index) const;
+	// true when bytes more would fit after evicting every unpinned entry
+	bool canFit(size_t bytes) const;
+
+	size_t getUsedBytes() const { return usedBytes; }
+	size_t getBudget() const { return budget; }
+	size_t getCount() const { return order.size(); }
+
+private:
+	struct entry {
+		size_t bytes = 0;
+		bool cached = false;
+		bool pinned = false;
+		std::list<int>::iterator position; // into order, valid while cached
+	};
+	std::vector<entry> entries; // slot i is timestamp i
+	std::list<int> order; // most recently used first
+	size_t usedBytes;
+	size_t budget;
+
+	bool valid(int index) const { return index >= 0 && index < (int)entries.size(); }
+};
+
+#endif
@@ -0,0 +1,333 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+#include <iostream>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <climits>
+#include <fstream>
+#include <filesystem>
+
+#if defined _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VTK_BYTESWAP_SSE2 1
+#endif
+
+#ifdef VTK_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "vtkTokenizer.hpp"
+
+vtkMappedFile::vtkMappedFile() : opened(false), mapped(nullptr), mappedSize(0),
+#if defined _WIN32
+	fileHandle(nullptr), mappingHandle(nullptr)
+#else
+	fd(-1)
+#endif
+{}
+
+vtkMappedFile::~vtkMappedFile() {
+	close();
+}
+
+vtkMappedFile::vtkMappedFile(vtkMappedFile&& other) noexcept : vtkMappedFile() {
+	*this = std::move(other);
+}
+
+vtkMappedFile& vtkMappedFile::operator=(vtkMappedFile&& other) noexcept {
+	if (this == &other) return *this;
+	close();
+	std::swap(opened, other.opened);
+	std::swap(mapped, other.mapped);
+	std::swap(mappedSize, other.mappedSize);
+#if defined _WIN32
+	std::swap(fileHandle, other.fileHandle);
+	std::swap(mappingHandle, other.mappingHandle);
+#else
+	std::swap(fd, other.fd);
+#endif
+	return *this;
+}
+
+int vtkMappedFile::open(const std::string& path) {
+	close();
+#if defined _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) return 0;
+
+	LARGE_INTEGER fsize;
+	if (!GetFileSizeEx(file, &fsize)) {
+		CloseHandle(file);
+		return 0;
+	}
+	fileHandle = file;
+	mappedSize = (size_t)fsize.QuadPart;
+#else
+	fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return 0;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		fd = -1;
+		return 0;
+	}
+	mappedSize = (size_t)st.st_size;
+#endif
+	return mapOpened();
+}
+
+int vtkMappedFile::mapOpened() {
+	opened = true;
+	// empty files can't be mapped, they are just an open file with no data
+	if (mappedSize == 0) return 1;
+#if defined _WIN32
+	mappingHandle = CreateFileMappingA((HANDLE)fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL) {
+		close();
+		return 0;
+	}
+	mapped = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (mapped == nullptr) {
+		close();
+		return 0;
+	}
+#else
+	void* ptr = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (ptr == MAP_FAILED) {
+		close();
+		return 0;
+	}
+	// the whole file is walked front to back once
+	madvise(ptr, mappedSize, MADV_SEQUENTIAL);
+	mapped = (const char*)ptr;
+#endif
+	return 1;
+}
+
+int vtkMappedFile::openInflated(const std::string& path) {
+	close();
+	vtkInflateStream stream;
+	if (!stream.open(path)) return 0;
+
+	/* The temporary file is unlinked as soon as it is open on POSIX and
+	 * delete on close on Windows, nothing is left behind even after a crash.
+	 * The lazy attribute arrays seek back into the mapping later.
+	 */
+	std::error_code err;
+	std::string dir = std::filesystem::temp_directory_path(err).string();
+	if (err) dir = ".";
+#if defined _WIN32
+	char tmpName[MAX_PATH];
+	if (GetTempFileNameA(dir.c_str(), "vtk", 0, tmpName) == 0) return 0;
+	HANDLE file = CreateFileA(tmpName, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		DeleteFileA(tmpName);
+		return 0;
+	}
+	fileHandle = file;
+	auto put = [file](const char* bytes, size_t size) {
+		DWORD wrote = 0;
+		return WriteFile(file, bytes, (DWORD)size, &wrote, NULL) && wrote == size;
+	};
+#else
+	std::string tmpName = dir + "/vtkInflateXXXXXX";
+	fd = mkstemp(tmpName.data());
+	if (fd < 0) return 0;
+	unlink(tmpName.c_str());
+	auto put = [this](const char* bytes, size_t size) {
+		while (size > 0) {
+			ssize_t wrote = ::write(fd, bytes, size);
+			if (wrote <= 0) return false;
+			bytes += wrote;
+			size -= (size_t)wrote;
+		}
+		return true;
+	};
+#endif
+
+	std::vector<char> chunk(INFLATE_CHUNK);
+	size_t used = 0;
+	for (;;) {
+		size_t got = stream.read(chunk.data(), chunk.size());
+		if (got == 0) break;
+		if (!put(chunk.data(), got)) {
+			close();
+			return 0;
+		}
+		used += got;
+	}
+	if (stream.failed()) {
+		close();
+		return 0;
+	}
+	mappedSize = used;
+	return mapOpened();
+}
+
+void vtkMappedFile::close() {
+#if defined _WIN32
+	if (mapped != nullptr) UnmapViewOfFile(mapped);
+	if (mappingHandle != nullptr) CloseHandle((HANDLE)mappingHandle);
+	if (fileHandle != nullptr) CloseHandle((HANDLE)fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (mapped != nullptr) munmap((void*)mapped, mappedSize);
+	if (fd >= 0) ::close(fd);
+	fd = -1;
+#endif
+	mapped = nullptr;
+	mappedSize = 0;
+	opened = false;
+}
+
+vtkInflateStream::vtkInflateStream() : zs(nullptr), fed(0), done(true), error(false) {}
+
+vtkInflateStream::~vtkInflateStream() {
+	close();
+}
+
+void vtkInflateStream::close() {
+#ifdef VTK_HAVE_ZLIB
+	if (zs != nullptr) {
+		inflateEnd((z_stream*)zs);
+		delete (z_stream*)zs;
+	}
+#endif
+	zs = nullptr;
+	file.close();
+	fed = 0;
+	done = true;
+	error = false;
+}
+
+bool vtkInflateStream::available() {
+#ifdef VTK_HAVE_ZLIB
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool vtkInflateStream::isCompressed(const std::string& path) {
+	return path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0;
+}
+
+size_t vtkInflateStream::sizeHint(const std::string& path) {
+	std::error_code err;
+	size_t size = (size_t)std::filesystem::file_size(path, err);
+	if (err) return 0;
+	if (!isCompressed(path) || size < 18) return size;
+	// ISIZE, the last 4 bytes of a gzip member, little endian
+	std::ifstream in(path, std::ios::binary);
+	uint8_t isize[4] = {};
+	in.seekg(-4, std::ios::end);
+	if (!in.read((char*)isize, 4)) return size;
+	size_t trailer = (size_t)isize[0] | ((size_t)isize[1] << 8) | ((size_t)isize[2] << 16) | ((size_t)isize[3] << 24);
+	// the trailer is whatever the last 4 bytes are, deflate never expands more than ~1032:1
+	return std::min(trailer, size * 1032);
+}
+
+int vtkInflateStream::open(const std::string& path) {
+	close();
+#ifdef VTK_HAVE_ZLIB
+	if (!file.open(path)) return 0;
+	z_stream* z = new z_stream{};
+	// 15 window bits + 32: gzip or zlib header, whichever the file has
+	if (inflateInit2(z, 15 + 32) != Z_OK) {
+		delete z;
+		file.close();
+		return 0;
+	}
+	zs = z;
+	done = (file.size() == 0);
+	return 1;
+#else
+	(void)path;
+	std::cerr << "ERROR:: " << path << " is compressed but this build has no zlib" << std::endl;
+	return 0;
+#endif
+}
+
+size_t vtkInflateStream::read(char* out, size_t size) {
+#ifdef VTK_HAVE_ZLIB
+	if (done || zs == nullptr || size == 0) return 0;
+	z_stream* z = (z_stream*)zs;
+	z->next_out = (Bytef*)out;
+	z->avail_out = (uInt)std::min<size_t>(size, UINT_MAX);
+	size_t asked = z->avail_out;
+
+	while (z->avail_out > 0) {
+		if (z->avail_in == 0) {
+			if (fed == file.size()) {
+				// input is gone before the end of the deflate stream
+				error = true;
+				done = true;
+				break;
+			}
+			size_t n = std::min<size_t>(file.size() - fed, 1u << 30);
+			z->next_in = (Bytef*)(file.data() + fed);
+			z->avail_in = (uInt)n;
+			fed += n;
+		}
+		int ret = inflate(z, Z_NO_FLUSH);
+		if (ret == Z_STREAM_END) {
+			// pigz and appended files hold several gzip members back to back
+			if (z->avail_in == 0 && fed == file.size()) {
+				done = true;
+				break;
+			}
+			inflateReset(z);
+		}
+		else if (ret != Z_OK) {
+			error = true;
+			done = true;
+			break;
+		}
+	}
+	return asked - z->avail_out;
+#else
+	(void)out;
+	(void)size;
+	return 0;
+#endif
+}
+
+void vtkByteSwap(void* data, size_t valueSize, size_t count) {
+	uint8_t* bytes = (uint8_t*)data;
+	size_t total = valueSize * count, i = 0;
+	if (valueSize < 2) return;
+#ifdef VTK_BYTESWAP_SSE2
+	if (valueSize == 2 || valueSize == 4 || valueSize == 8) {
+		for (; i + 16 <= total; i += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(bytes + i));
+			// swap the bytes of every 16 bit word, then reverse the words inside each value
+			v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+			if (valueSize == 4) {
+				v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+				v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+			}
+			else if (valueSize == 8) {
+				v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+				v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+			}
+			_mm_storeu_si128((__m128i*)(bytes + i), v);
+		}
+	}
+#endif
+	for (; i + valueSize <= total; i += valueSize) std::reverse(bytes + i, bytes + i + valueSize);
+}
@@ -0,0 +1,264 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#ifndef VTK_TOKENIZER_HPP
+#define VTK_TOKENIZER_HPP
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+/* Read-only memory mapping of a whole file.
+ * The parser tokenizes straight out of the mapping so a file is opened once,
+ * never copied into a line buffer and has no line count/length limits.
+ */
+class vtkMappedFile {
+public:
+	vtkMappedFile();
+	~vtkMappedFile();
+
+	vtkMappedFile(const vtkMappedFile&) = delete;
+	vtkMappedFile& operator=(const vtkMappedFile&) = delete;
+	vtkMappedFile(vtkMappedFile&& other) noexcept;
+	vtkMappedFile& operator=(vtkMappedFile&& other) noexcept;
+
+	int open(const std::string& path);
+	/* Inflates a gzip/zlib file (I.E. tracks.vtk.gz) a chunk at a time into an
+	 * unnamed temporary file and maps that, data() is then the decompressed
+	 * bytes. Only a chunk is ever held on the heap, the pages of the mapping
+	 * are file backed and the file is gone once this is closed.
+	 */
+	int openInflated(const std::string& path);
+	void close();
+
+	bool isOpen() const { return opened; }
+	const char* data() const { return mapped; }
+	size_t size() const { return mappedSize; }
+
+private:
+	bool opened;
+	const char* mapped;
+	size_t mappedSize;
+#if defined _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fd;
+#endif
+
+	static constexpr size_t INFLATE_CHUNK = 1 << 20;
+
+	// maps the mappedSize bytes of the file already open in fileHandle / fd
+	int mapOpened();
+};
+
+/* Decompresses a gzip or zlib file a chunk at a time out of its mapping,
+ * only what read() is handed is ever held decompressed. Concatenated gzip
+ * members are read as one stream. Needs the module built with zlib
+ * (VTK_HAVE_ZLIB), open() fails otherwise.
+ */
+class vtkInflateStream {
+public:
+	vtkInflateStream();
+	~vtkInflateStream();
+
+	vtkInflateStream(const vtkInflateStream&) = delete;
+	vtkInflateStream& operator=(const vtkInflateStream&) = delete;
+
+	int open(const std::string& path);
+	// up to size decompressed bytes into out, 0 once the stream is over or broken
+	size_t read(char* out, size_t size);
+	// the data was corrupt or ended early
+	bool failed() const { return error; }
+
+	// I.E. U.gz, tracks.vtk.gz
+	static bool isCompressed(const std::string& path);
+	static bool available();
+	/* Decompressed size from the gzip trailer (modulo 4 GiB), capped at what
+	 * deflate can expand the file to, the file size for anything else.
+	 */
+	static size_t sizeHint(const std::string& path);
+
+private:
+	vtkMappedFile file;
+	void* zs; // z_stream, kept out of this header
+	size_t fed; // bytes of the mapping handed to zlib so far
+	bool done;
+	bool error;
+
+	void close();
+};
+
+/* Reverses the byte order of count values of valueSize (2, 4 or 8) bytes in
+ * place, binary vtk is big endian and .vtp files may come from either kind of
+ * machine. Whole SSE2 registers at a time where available.
+ */
+void vtkByteSwap(void* data, size_t valueSize, size_t count);
+
+/* Whitespace tokenizer working in place over a byte range.
+ * Tokens are string_views into the range, numbers are decoded with
+ * std::from_chars directly from the bytes without building strings.
+ */
+class vtkTokenizer {
+public:
+	vtkTokenizer() : begin(nullptr), cur(nullptr), end(nullptr) {}
+	vtkTokenizer(const char* first, const char* last) : begin(first), cur(first), end(last) {}
+
+	static bool isSpace(char c) {
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+	}
+
+	void skipSpace() {
+		while (cur < end && isSpace(*cur)) cur++;
+	}
+
+	bool eof() {
+		skipSpace();
+		return cur >= end;
+	}
+
+	// next whitespace delimited token, empty at end of data
+	std::string_view next() {
+		skipSpace();
+		const char* start = cur;
+		while (cur < end && !isSpace(*cur)) cur++;
+		return std::string_view(start, cur - start);
+	}
+
+	std::string_view peek() {
+		const char* save = cur;
+		std::string_view tok = next();
+		cur = save;
+		return tok;
+	}
+
+	// rest of the current line without the line ending, moves to the next line
+	std::string_view line() {
+		const char* start = cur;
+		while (cur < end && *cur != '\n') cur++;
+		const char* stop = cur;
+		if (stop > start && *(stop - 1) == '\r') stop--;
+		if (cur < end) cur++;
+		return std::string_view(start, stop - start);
+	}
+
+	void skipLine() { line(); }
+
+	/* Decodes the next token as a number in place.
+	 * Fails (without consuming) if the token is not entirely numeric.
+	 */
+	template<typename T>
+	bool nextNumber(T& out) {
+		skipSpace();
+		if (cur >= end) return false;
+		const char* start = cur;
+		// from_chars does not accept a leading '+'
+		if (*start == '+' && start + 1 < end) start++;
+		const char* stop = parseNumber(start, end, out);
+		if (stop == nullptr || (stop < end && !isSpace(*stop))) return false;
+		cur = stop;
+		return true;
+	}
+
+	/* Streams up to count numbers into out, stops early at the first
+	 * non numeric token (the next section keyword) or at the end of data.
+	 * Returns how many values were written.
+	 */
+	template<typename T>
+	size_t readBlock(T* out, size_t count) {
+		size_t n = 0;
+		while (n < count) {
+			while (cur < end && isSpace(*cur)) cur++;
+			if (cur >= end) break;
+			const char* first = (*cur == '+' && cur + 1 < end) ? cur + 1 : cur;
+			const char* stop = parseNumber(first, end, out[n]);
+			if (stop == nullptr || (stop < end && !isSpace(*stop))) break;
+			cur = stop;
+			n++;
+		}
+		return n;
+	}
+
+	/* Skips up to count numeric tokens without decoding them, stops early at
+	 * the first token that can't start a number. Returns how many were skipped.
+	 */
+	size_t skipNumbers(size_t count) {
+		size_t n = 0;
+		while (n < count) {
+			while (cur < end && isSpace(*cur)) cur++;
+			if (cur >= end) break;
+			const char* start = cur;
+			char c = *cur;
+			while (cur < end && !isSpace(*cur)) cur++;
+			if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.')) {
+				std::string_view tok(start, cur - start);
+				if (tok != "nan" && tok != "inf") {
+					cur = start;
+					break;
+				}
+			}
+			n++;
+		}
+		return n;
+	}
+
+	template<typename T>
+	static bool toNumber(std::string_view tok, T& out) {
+		if (tok.empty()) return false;
+		const char* first = tok.data();
+		if (*first == '+' && tok.size() > 1) first++;
+		return parseNumber(first, tok.data() + tok.size(), out) == tok.data() + tok.size();
+	}
+
+	const char* position() const { return cur; }
+	size_t offset() const { return cur - begin; }
+	size_t size() const { return end - begin; }
+	void seek(size_t off) { cur = begin + (off < size() ? off : size()); }
+
+	// 1 based line number of a position, only meant for error messages
+	size_t lineAt(const char* pos) const {
+		size_t ln = 1;
+		for (const char* p = begin; p < pos && p < end; p++) if (*p == '\n') ln++;
+		return ln;
+	}
+	size_t currentLine() const { return lineAt(cur); }
+
+private:
+	const char* begin;
+	const char* cur;
+	const char* end;
+
+	template<typename T>
+	static const char* parseNumber(const char* first, const char* last, T& out) {
+#if defined __cpp_lib_to_chars
+		auto res = std::from_chars(first, last, out);
+		return res.ec == std::errc() ? res.ptr : nullptr;
+#else
+		if constexpr (std::is_integral_v<T>) {
+			auto res = std::from_chars(first, last, out);
+			return res.ec == std::errc() ? res.ptr : nullptr;
+		}
+		else {
+			// floating point from_chars is missing on some standard libraries,
+			// strtod needs a terminated copy since the mapping has no '\0'
+			char tmp[64];
+			size_t len = 0;
+			while (first + len < last && len < sizeof(tmp) - 1 && !isSpace(first[len])) {
+				tmp[len] = first[len];
+				len++;
+			}
+			tmp[len] = '\0';
+			char* stop = nullptr;
+			double v = std::strtod(tmp, &stop);
+			if (stop == tmp) return nullptr;
+			out = (T)v;
+			return first + (stop - tmp);
+		}
+#endif
+	}
+};
+
+#endif
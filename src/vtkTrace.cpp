@@ -0,0 +1,181 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+#include "vtkTrace.hpp"
+#include "vtkParser.hpp"
+
+namespace {
+	struct traceEvent {
+		const char* name;
+		int64_t start, end;
+	};
+
+	/* One per thread that ever recorded, only that thread appends so its lock
+	 * is uncontended unless a frame summary or an export is reading it.
+	 */
+	struct threadBuffer {
+		std::mutex lock;
+		std::vector<traceEvent> events; // in the order zones closed
+		std::string name;
+		int id = 0;
+		size_t dropped = 0;
+	};
+
+	struct traceState {
+		std::mutex lock; // guards threads, frames and summary
+		std::vector<std::shared_ptr<threadBuffer> > threads; // kept after their thread exits (pool workers)
+		std::vector<int64_t> frames;
+		vtkTrace::frameSummary summary;
+		std::atomic<bool> enabled{ true };
+		std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	};
+
+	traceState& state() {
+		static traceState s;
+		return s;
+	}
+
+	threadBuffer& localBuffer() {
+		thread_local std::shared_ptr<threadBuffer> buffer;
+		if (buffer == nullptr) {
+			buffer = std::make_shared<threadBuffer>();
+			traceState& s = state();
+			std::lock_guard<std::mutex> guard(s.lock);
+			buffer->id = (int)s.threads.size() + 1;
+			s.threads.push_back(buffer);
+		}
+		return *buffer;
+	}
+
+	std::string jsonString(const char* text) {
+		std::string out = "\"";
+		for (const char* c = text; *c != '\0'; c++) {
+			if (*c == '"' || *c == '\\') out += '\\';
+			out += ((unsigned char)*c < ' ') ? ' ' : *c;
+		}
+		return out + "\"";
+	}
+}
+
+int64_t vtkTrace::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - state().epoch).count();
+}
+
+void vtkTrace::record(const char* name, int64_t start, int64_t end) {
+	threadBuffer& buffer = localBuffer();
+	std::lock_guard<std::mutex> guard(buffer.lock);
+	if (buffer.events.size() >= MAX_EVENTS) buffer.dropped++;
+	else buffer.events.push_back({ name, start, end });
+}
+
+void vtkTrace::setEnabled(bool enabled) {
+	state().enabled = enabled;
+}
+
+bool vtkTrace::isEnabled() {
+	return state().enabled.load(std::memory_order_relaxed);
+}
+
+void vtkTrace::clear() {
+	traceState& s = state();
+	std::lock_guard<std::mutex> guard(s.lock);
+	for (const std::shared_ptr<threadBuffer>& buffer : s.threads) {
+		std::lock_guard<std::mutex> bufferGuard(buffer->lock);
+		buffer->events.clear();
+		buffer->dropped = 0;
+	}
+	s.frames.clear();
+	s.summary = frameSummary();
+}
+
+size_t vtkTrace::droppedEvents() {
+	traceState& s = state();
+	std::lock_guard<std::mutex> guard(s.lock);
+	size_t dropped = 0;
+	for (const std::shared_ptr<threadBuffer>& buffer : s.threads) {
+		std::lock_guard<std::mutex> bufferGuard(buffer->lock);
+		dropped += buffer->dropped;
+	}
+	return dropped;
+}
+
+void vtkTrace::setThreadName(const char* name) {
+	threadBuffer& buffer = localBuffer();
+	std::lock_guard<std::mutex> guard(buffer.lock);
+	buffer.name = name;
+}
+
+void vtkTrace::frameMark() {
+	if (!isEnabled()) return;
+	int64_t end = now();
+	traceState& s = state();
+	std::lock_guard<std::mutex> guard(s.lock);
+	int64_t begin = s.frames.empty() ? 0 : s.frames.back();
+	s.frames.push_back(end);
+
+	// zones that closed during the frame, each thread's newest are at its back
+	frameSummary summary;
+	summary.frameMs = (end - begin) * 1e-6;
+	for (const std::shared_ptr<threadBuffer>& buffer : s.threads) {
+		std::lock_guard<std::mutex> bufferGuard(buffer->lock);
+		for (auto e = buffer->events.rbegin(); e != buffer->events.rend() && e->end >= begin; ++e) {
+			if (e->end > end) continue;
+			auto stat = std::find_if(summary.zones.begin(), summary.zones.end(),
+				[e](const zoneStat& z) { return z.name == e->name; });
+			if (stat == summary.zones.end()) {
+				summary.zones.push_back({ e->name });
+				stat = summary.zones.end() - 1;
+			}
+			double ms = (e->end - e->start) * 1e-6;
+			stat->calls++;
+			stat->totalMs += ms;
+			stat->maxMs = std::max(stat->maxMs, ms);
+		}
+	}
+	std::sort(summary.zones.begin(), summary.zones.end(),
+		[](const zoneStat& a, const zoneStat& b) { return a.totalMs > b.totalMs; });
+	s.summary = std::move(summary);
+}
+
+vtkTrace::frameSummary vtkTrace::lastFrame() {
+	traceState& s = state();
+	std::lock_guard<std::mutex> guard(s.lock);
+	return s.summary;
+}
+
+int vtkTrace::writeChromeTrace(const std::string& path) {
+	FILE* out = std::fopen(path.c_str(), "wb");
+	if (out == nullptr) {
+		VTKLOG("ERROR:: Failed to create trace file {}", path);
+		return 0;
+	}
+	traceState& s = state();
+	std::lock_guard<std::mutex> guard(s.lock);
+
+	// timestamps are microseconds in the trace event format
+	fmt::print(out, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fmt::print(out, "{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{{\"name\":\"vtkOFRenderer\"}}}}");
+	size_t events = 0;
+	for (const std::shared_ptr<threadBuffer>& buffer : s.threads) {
+		std::lock_guard<std::mutex> bufferGuard(buffer->lock);
+		std::string name = buffer->name.empty() ? fmt::format("thread {}", buffer->id) : buffer->name;
+		fmt::print(out, ",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":{}}}}}",
+			buffer->id, jsonString(name.c_str()));
+		for (const traceEvent& e : buffer->events) {
+			fmt::print(out, ",\n{{\"name\":{},\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+				jsonString(e.name), buffer->id, e.start * 1e-3, (e.end - e.start) * 1e-3);
+		}
+		events += buffer->events.size();
+	}
+	for (int64_t frame : s.frames)
+		fmt::print(out, ",\n{{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":{:.3f}}}", frame * 1e-3);
+	fmt::print(out, "\n]}}\n");
+	if (std::fclose(out) != 0) return 0;
+	VTKLOG("INFO:: Wrote {} trace zones to {}", events, path);
+	return 1;
+}
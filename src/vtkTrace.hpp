@@ -0,0 +1,92 @@
+/*Copyright (c) 2024 Tristan Wellman*/
+
+#ifndef VTK_TRACE_HPP
+#define VTK_TRACE_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/* Scoped zone tracing of the load and render paths.
+ * VTK_TRACE_ZONE("name") records how long the rest of the enclosing scope
+ * takes on the calling thread. The macros are empty unless the module is
+ * built with VTK_TRACE (cmake -DVTK_ENABLE_TRACE=ON), the recorder below is
+ * always there so a trace can still be made by hand (I.E. from the gtests).
+ * Zone names must be string literals, only the pointer is kept.
+ */
+#ifdef VTK_TRACE
+#define VTK_TRACE_CONCAT_(a, b) a##b
+#define VTK_TRACE_CONCAT(a, b) VTK_TRACE_CONCAT_(a, b)
+#define VTK_TRACE_ZONE(name) vtkTraceZone VTK_TRACE_CONCAT(vtkTraceZone_, __LINE__)(name)
+// once per rendered frame on the render thread, closes the frame the summary shows
+#define VTK_TRACE_FRAME() vtkTrace::frameMark()
+// names the calling thread in the exported trace
+#define VTK_TRACE_THREAD(name) vtkTrace::setThreadName(name)
+#else
+#define VTK_TRACE_ZONE(name) ((void)0)
+#define VTK_TRACE_FRAME() ((void)0)
+#define VTK_TRACE_THREAD(name) ((void)0)
+#endif
+
+class vtkTrace {
+public:
+	// true when the VTK_TRACE_* macros record, false when they are compiled out
+	static constexpr bool compiledIn =
+#ifdef VTK_TRACE
+		true;
+#else
+		false;
+#endif
+
+	// one zone of the last frame, summed over its calls on every thread
+	struct zoneStat {
+		const char* name;
+		int calls = 0;
+		double totalMs = 0.0;
+		double maxMs = 0.0;
+	};
+
+	struct frameSummary {
+		double frameMs = 0.0; // between the last two frameMark calls
+		std::vector<zoneStat> zones; // most total time first
+	};
+
+	/* Zones are kept per thread until clear(), at most MAX_EVENTS each, later
+	 * ones are counted as dropped. Recording can be paused at run time.
+	 */
+	static constexpr size_t MAX_EVENTS = 1 << 20;
+	static void setEnabled(bool enabled);
+	static bool isEnabled();
+	static void clear();
+	static size_t droppedEvents();
+
+	static void setThreadName(const char* name);
+	static void frameMark();
+	static frameSummary lastFrame();
+
+	/* Chrome trace event JSON (chrome://tracing, ui.perfetto.dev): every zone
+	 * as a complete event on its thread, frame marks as instant events.
+	 */
+	static int writeChromeTrace(const std::string& path);
+
+	// nanoseconds since the first use of the recorder
+	static int64_t now();
+	static void record(const char* name, int64_t start, int64_t end);
+};
+
+class vtkTraceZone {
+public:
+	explicit vtkTraceZone(const char* name) : name(name), start(vtkTrace::isEnabled() ? vtkTrace::now() : -1) {}
+	~vtkTraceZone() {
+		if (start >= 0) vtkTrace::record(name, start, vtkTrace::now());
+	}
+
+	vtkTraceZone(const vtkTraceZone&) = delete;
+	vtkTraceZone& operator=(const vtkTraceZone&) = delete;
+
+private:
+	const char* name;
+	int64_t start; // -1 when recording was off as the zone opened
+};
+
+#endif